@@ -2,11 +2,13 @@
 * reference : https://github.com/nvpro-samples/nvpro_core/blob/master/nvh/gltfscene.cpp
 */
 
+#include <algorithm>
 #include <set>
 #include <iostream>
 #include <sstream>
 #include <glm/gtc/quaternion.hpp>
 #include "gltf_scene.h"
+#include "vulkan_thread_pool.h"
 
 #define EXTENSION_ATTRIB_IRAY "NV_attributes_iray"
 
@@ -204,43 +206,125 @@ void GltfScene::importDrawableNodes(const tinygltf::Model& tmodel, GltfAttribute
 {
     checkRequiredExtensions(tmodel);
 
-    // Find the number of vertex(attributes) and index
-    //uint32_t nbVert{0};
-    uint32_t nbIndex{ 0 };
+    // First pass: output ranges of every primitive, prefix sum of the index / vertex counts.
+    // A primitive with the same attributes as a previous one re-uses its vertices, decided here
+    // in model order so the result doesn't depend on the thread scheduling.
+    uint32_t nbIndex{ static_cast<uint32_t>(m_indices.size()) };
+    uint32_t nbVert{ static_cast<uint32_t>(m_positions.size()) };
     uint32_t meshCnt{ 0 };  // use for mesh to new meshes
-    uint32_t primCnt{ 0 };  //  "   "  "  "
+    uint32_t primCnt{ static_cast<uint32_t>(m_primMeshes.size()) };  //  "   "  "  "
+    const size_t firstPrimMesh = m_primMeshes.size();
+    std::vector<const tinygltf::Primitive*> tprimitives;
+    std::vector<bool>                       ownsVertices;
     for (const auto& mesh : tmodel.meshes)
     {
         std::vector<uint32_t> vprim;
         for (const auto& primitive : mesh.primitives)
         {
-            if (primitive.mode != 4)  // Triangle
+            // Only triangles are supported
+            // 0:point, 1:lines, 2:line_loop, 3:line_strip, 4:triangles, 5:triangle_strip, 6:triangle_fan
+            if (primitive.mode != 4)
                 continue;
+
+            GltfPrimMesh resultMesh;
+            resultMesh.name = mesh.name;
+            resultMesh.materialIndex = std::max(0, primitive.material);
+            resultMesh.firstIndex = nbIndex;
+
             const auto& posAccessor = tmodel.accessors[primitive.attributes.find("POSITION")->second];
-            //nbVert += static_cast<uint32_t>(posAccessor.count);
             if (primitive.indices > -1)
             {
                 const auto& indexAccessor = tmodel.accessors[primitive.indices];
-                nbIndex += static_cast<uint32_t>(indexAccessor.count);
+                if (indexAccessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT
+                    && indexAccessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT
+                    && indexAccessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE)
+                {
+                    std::cerr << "Index component type " << indexAccessor.componentType << " not supported!" << std::endl;
+                    continue;
+                }
+                resultMesh.indexCount = static_cast<uint32_t>(indexAccessor.count);
             }
             else
             {
-                nbIndex += static_cast<uint32_t>(posAccessor.count);
+                resultMesh.indexCount = static_cast<uint32_t>(posAccessor.count);
             }
+
+            // Create a key made of the attributes, to see if the primitive was already
+            // processed. If it is, we will re-use the cache, but allow the material and
+            // indices to be different.
+            std::stringstream o;
+            for (auto& a : primitive.attributes)
+            {
+                o << a.first << a.second;
+            }
+            std::string key = o.str();
+
+            auto it = m_cachePrimMesh.find(key);
+            bool primMeshCached = it != m_cachePrimMesh.end();
+            if (primMeshCached)
+            {
+                // Found a cache - will not need to append vertex
+                resultMesh.vertexCount = it->second.vertexCount;
+                resultMesh.vertexOffset = it->second.vertexOffset;
+                resultMesh.posMin = it->second.posMin;
+                resultMesh.posMax = it->second.posMax;
+            }
+            else
+            {
+                // Keeping the size of this primitive (Spec says this is required information)
+                resultMesh.vertexCount = static_cast<uint32_t>(posAccessor.count);
+                resultMesh.vertexOffset = nbVert;
+                if (!posAccessor.minValues.empty())
+                    resultMesh.posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
+                if (!posAccessor.maxValues.empty())
+                    resultMesh.posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
+                nbVert += resultMesh.vertexCount;
+
+                // Keep result in cache
+                m_cachePrimMesh[key] = resultMesh;
+            }
+            nbIndex += resultMesh.indexCount;
+
+            // Append prim mesh to the list of all primitive meshes
+            ownsVertices.push_back(!primMeshCached);
+            tprimitives.push_back(&primitive);
+            m_primMeshes.emplace_back(resultMesh);
             vprim.emplace_back(primCnt++);
         }
         m_meshToPrimMeshes[meshCnt++] = std::move(vprim);  // mesh-id = { prim0, prim1, ... }
     }
 
-    // Reserving memory
-    m_indices.reserve(nbIndex);
-
-    // Convert all mesh/primitives+ to a single primitive per mesh
-    for (const auto& tmesh : tmodel.meshes)
+    // Reserving memory - every primitive writes to its own range
+    m_indices.resize(nbIndex);
+    m_positions.resize(nbVert);
+    if ((attributes & GltfAttributes::Normal) == GltfAttributes::Normal)
+        m_normals.resize(nbVert);
+    if ((attributes & GltfAttributes::Texcoord_0) == GltfAttributes::Texcoord_0)
+        m_texcoords0.resize(nbVert);
+    if ((attributes & GltfAttributes::Tangent) == GltfAttributes::Tangent)
+        m_tangents.resize(nbVert);
+    if ((attributes & GltfAttributes::Color_0) == GltfAttributes::Color_0)
+        m_colors0.resize(nbVert);
+
+    // Second pass: convert all mesh/primitives+ to a single primitive per mesh, concurrently
+    if (tprimitives.size() > 1 && m_importThreadCount != 1)
+    {
+        ThreadPool threadPool;
+        threadPool.init(std::min(m_importThreadCount > 0 ? m_importThreadCount : std::thread::hardware_concurrency(),
+            static_cast<uint32_t>(tprimitives.size())));
+        for (size_t i = 0; i < tprimitives.size(); i++)
+        {
+            threadPool.submit([&, i]() {
+                processMesh(tmodel, *tprimitives[i], attributes, m_primMeshes[firstPrimMesh + i], ownsVertices[i]);
+            });
+        }
+        threadPool.wait();
+    }
+    else
     {
-        for (const auto& tprimitive : tmesh.primitives)
+        for (size_t i = 0; i < tprimitives.size(); i++)
         {
-            processMesh(tmodel, tprimitive, attributes, tmesh.name);
+            processMesh(tmodel, *tprimitives[i], attributes, m_primMeshes[firstPrimMesh + i], ownsVertices[i]);
         }
     }
 
@@ -256,9 +340,6 @@ void GltfScene::importDrawableNodes(const tinygltf::Model& tmodel, GltfAttribute
     //computeCamera();
 
     m_meshToPrimMeshes.clear();
-    primitiveIndices32u.clear();
-    primitiveIndices16u.clear();
-    primitiveIndices8u.clear();
 }
 
 void GltfScene::processNode(const tinygltf::Model& tmodel, int& nodeIdx, const glm::mat4& parentMatrix)
@@ -327,115 +408,63 @@ void GltfScene::processNode(const tinygltf::Model& tmodel, int& nodeIdx, const g
     }
 }
 
-void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primitive& tmesh, GltfAttributes attributes, const std::string& name)
+void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primitive& tmesh, GltfAttributes attributes,
+    const GltfPrimMesh& resultMesh, bool ownsVertices)
 {
-    // Only triangles are supported
-    // 0:point, 1:lines, 2:line_loop, 3:line_strip, 4:triangles, 5:triangle_strip, 6:triangle_fan
-    if (tmesh.mode != 4)
-        return;
-
-    GltfPrimMesh resultMesh;
-    resultMesh.name = name;
-    resultMesh.materialIndex = std::max(0, tmesh.material);
-    resultMesh.vertexOffset = static_cast<uint32_t>(m_positions.size());
-    resultMesh.firstIndex = static_cast<uint32_t>(m_indices.size());
-
-    // Create a key made of the attributes, to see if the primitive was already
-    // processed. If it is, we will re-use the cache, but allow the material and
-    // indices to be different.
-    std::stringstream o;
-    for (auto& a : tmesh.attributes)
-    {
-        o << a.first << a.second;
-    }
-    std::string key = o.str();
-    bool        primMeshCached = false;
-
-    // Found a cache - will not need to append vertex
-    auto it = m_cachePrimMesh.find(key);
-    if (it != m_cachePrimMesh.end())
-    {
-        primMeshCached = true;
-        GltfPrimMesh cacheMesh = it->second;
-        resultMesh.vertexCount = cacheMesh.vertexCount;
-        resultMesh.vertexOffset = cacheMesh.vertexOffset;
-    }
-
-
-    // INDICES
+    // INDICES - local to the primitive, widened to 32 bits
+    uint32_t* indices = m_indices.data() + resultMesh.firstIndex;
     if (tmesh.indices > -1)
     {
         const tinygltf::Accessor& indexAccessor = tmodel.accessors[tmesh.indices];
         const tinygltf::BufferView& bufferView = tmodel.bufferViews[indexAccessor.bufferView];
         const tinygltf::Buffer& buffer = tmodel.buffers[bufferView.buffer];
-
-        resultMesh.indexCount = static_cast<uint32_t>(indexAccessor.count);
+        const unsigned char* indexData = &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset];
 
         switch (indexAccessor.componentType)
         {
         case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-            primitiveIndices32u.resize(indexAccessor.count);
-            memcpy(primitiveIndices32u.data(), &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset],
-                indexAccessor.count * sizeof(uint32_t));
-            m_indices.insert(m_indices.end(), primitiveIndices32u.begin(), primitiveIndices32u.end());
+            memcpy(indices, indexData, indexAccessor.count * sizeof(uint32_t));
             break;
         }
         case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-            primitiveIndices16u.resize(indexAccessor.count);
-            memcpy(primitiveIndices16u.data(), &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset],
-                indexAccessor.count * sizeof(uint16_t));
-            m_indices.insert(m_indices.end(), primitiveIndices16u.begin(), primitiveIndices16u.end());
+            const uint16_t* indices16u = reinterpret_cast<const uint16_t*>(indexData);
+            std::copy(indices16u, indices16u + indexAccessor.count, indices);
             break;
         }
         case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-            primitiveIndices8u.resize(indexAccessor.count);
-            memcpy(primitiveIndices8u.data(), &buffer.data[indexAccessor.byteOffset + bufferView.byteOffset],
-                indexAccessor.count * sizeof(uint8_t));
-            m_indices.insert(m_indices.end(), primitiveIndices8u.begin(), primitiveIndices8u.end());
+            std::copy(indexData, indexData + indexAccessor.count, indices);
             break;
         }
         default:
-            std::cerr << "Index component type " << indexAccessor.componentType << " not supported!" << std::endl;
-            return;
+            // rejected by importDrawableNodes
+            break;
         }
     }
     else
     {
         // Primitive without indices, creating them
-        const auto& accessor = tmodel.accessors[tmesh.attributes.find("POSITION")->second];
-        for (auto i = 0; i < accessor.count; i++)
-            m_indices.push_back(i);
-        resultMesh.indexCount = static_cast<uint32_t>(accessor.count);
+        for (uint32_t i = 0; i < resultMesh.indexCount; i++)
+            indices[i] = i;
     }
 
-    if (primMeshCached == false)  // Need to add this primitive
+    if (ownsVertices)  // Need to add this primitive
     {
 
         // POSITION
-        {
-            bool result = getAttribute<glm::vec3>(tmodel, tmesh, m_positions, "POSITION");
-
-            // Keeping the size of this primitive (Spec says this is required information)
-            const auto& accessor = tmodel.accessors[tmesh.attributes.find("POSITION")->second];
-            resultMesh.vertexCount = static_cast<uint32_t>(accessor.count);
-            if (!accessor.minValues.empty())
-                resultMesh.posMin = glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]);
-            if (!accessor.maxValues.empty())
-                resultMesh.posMax = glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]);
-        }
+        getAttribute<glm::vec3>(tmodel, tmesh, &m_positions[resultMesh.vertexOffset], "POSITION");
 
         // NORMAL
         if ((attributes & GltfAttributes::Normal) == GltfAttributes::Normal)
         {
-            if (!getAttribute<glm::vec3>(tmodel, tmesh, m_normals, "NORMAL"))
+            if (!getAttribute<glm::vec3>(tmodel, tmesh, &m_normals[resultMesh.vertexOffset], "NORMAL"))
             {
                 // Need to compute the normals
-                std::vector<glm::vec3> geonormal(resultMesh.vertexCount);
+                glm::vec3* geonormal = &m_normals[resultMesh.vertexOffset];
                 for (size_t i = 0; i < resultMesh.indexCount; i += 3)
                 {
-                    uint32_t    ind0 = m_indices[resultMesh.firstIndex + i + 0];
-                    uint32_t    ind1 = m_indices[resultMesh.firstIndex + i + 1];
-                    uint32_t    ind2 = m_indices[resultMesh.firstIndex + i + 2];
+                    uint32_t    ind0 = indices[i + 0];
+                    uint32_t    ind1 = indices[i + 1];
+                    uint32_t    ind2 = indices[i + 2];
                     const auto& pos0 = m_positions[ind0 + resultMesh.vertexOffset];
                     const auto& pos1 = m_positions[ind1 + resultMesh.vertexOffset];
                     const auto& pos2 = m_positions[ind2 + resultMesh.vertexOffset];
@@ -446,16 +475,15 @@ void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primi
                     geonormal[ind1] += n;
                     geonormal[ind2] += n;
                 }
-                for (auto& n : geonormal)
-                    n = glm::normalize(n);
-                m_normals.insert(m_normals.end(), geonormal.begin(), geonormal.end());
+                for (uint32_t i = 0; i < resultMesh.vertexCount; i++)
+                    geonormal[i] = glm::normalize(geonormal[i]);
             }
         }
 
         // TEXCOORD_0
         if ((attributes & GltfAttributes::Texcoord_0) == GltfAttributes::Texcoord_0)
         {
-            if (!getAttribute<glm::vec2>(tmodel, tmesh, m_texcoords0, "TEXCOORD_0"))
+            if (!getAttribute<glm::vec2>(tmodel, tmesh, &m_texcoords0[resultMesh.vertexOffset], "TEXCOORD_0"))
             {
                 // Set them all to zero
                 //      m_texcoords0.insert(m_texcoords0.end(), resultMesh.vertexCount, glm::vec2(0, 0));
@@ -533,7 +561,7 @@ void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primi
                     float u = 0.5f * (uc / maxAxis + 1.0f);
                     float v = 0.5f * (vc / maxAxis + 1.0f);
 
-                    m_texcoords0.emplace_back(u, v);
+                    m_texcoords0[resultMesh.vertexOffset + i] = glm::vec2(u, v);
                 }
             }
         }
@@ -542,7 +570,7 @@ void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primi
         // TANGENT
         if ((attributes & GltfAttributes::Tangent) == GltfAttributes::Tangent)
         {
-            if (!getAttribute<glm::vec4>(tmodel, tmesh, m_tangents, "TANGENT"))
+            if (!getAttribute<glm::vec4>(tmodel, tmesh, &m_tangents[resultMesh.vertexOffset], "TANGENT"))
             {
                 std::vector<glm::vec3> tangent(resultMesh.vertexCount);
                 std::vector<glm::vec3> bitangent(resultMesh.vertexCount);
@@ -552,9 +580,9 @@ void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primi
                 for (size_t i = 0; i < resultMesh.indexCount; i += 3)
                 {
                     // local index
-                    uint32_t i0 = m_indices[resultMesh.firstIndex + i + 0];
-                    uint32_t i1 = m_indices[resultMesh.firstIndex + i + 1];
-                    uint32_t i2 = m_indices[resultMesh.firstIndex + i + 2];
+                    uint32_t i0 = indices[i + 0];
+                    uint32_t i1 = indices[i + 1];
+                    uint32_t i2 = indices[i + 2];
                     assert(i0 < resultMesh.vertexCount);
                     assert(i1 < resultMesh.vertexCount);
                     assert(i2 < resultMesh.vertexCount);
@@ -609,7 +637,7 @@ void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primi
 
                     // Calculate handedness
                     float handedness = (glm::dot(glm::cross(n, t), b) < 0.0F) ? -1.0F : 1.0F;
-                    m_tangents.emplace_back(tangent.x, tangent.y, tangent.z, handedness);
+                    m_tangents[resultMesh.vertexOffset + a] = glm::vec4(tangent, handedness);
                 }
             }
         }
@@ -617,19 +645,13 @@ void GltfScene::processMesh(const tinygltf::Model& tmodel, const tinygltf::Primi
         // COLOR_0
         if ((attributes & GltfAttributes::Color_0) == GltfAttributes::Color_0)
         {
-            if (!getAttribute<glm::vec4>(tmodel, tmesh, m_colors0, "COLOR_0"))
+            if (!getAttribute<glm::vec4>(tmodel, tmesh, &m_colors0[resultMesh.vertexOffset], "COLOR_0"))
             {
                 // Set them all to one
-                m_colors0.insert(m_colors0.end(), resultMesh.vertexCount, glm::vec4(1, 1, 1, 1));
+                std::fill_n(&m_colors0[resultMesh.vertexOffset], resultMesh.vertexCount, glm::vec4(1, 1, 1, 1));
             }
         }
     }
-
-    // Keep result in cache
-    m_cachePrimMesh[key] = resultMesh;
-
-    // Append prim mesh to the list of all primitive meshes
-    m_primMeshes.emplace_back(resultMesh);
 }
 
 void GltfScene::checkRequiredExtensions(const tinygltf::Model& tmodel)
@@ -643,6 +665,7 @@ void GltfScene::checkRequiredExtensions(const tinygltf::Model& tmodel)
         KHR_MATERIALS_IOR_EXTENSION_NAME,
         KHR_MATERIALS_VOLUME_EXTENSION_NAME,
         KHR_MATERIALS_TRANSMISSION_EXTENSION_NAME,
+        KHR_MESH_QUANTIZATION_EXTENSION_NAME,
     };
 
     for (auto& e : tmodel.extensionsRequired)
@@ -94,6 +94,9 @@ struct KHR_materials_volume
 	glm::vec3 attenuationColor{ 1.f, 1.f, 1.f };
 };
 
+// https://github.com/KhronosGroup/glTF/tree/master/extensions/2.0/Khronos/KHR_mesh_quantization
+#define KHR_MESH_QUANTIZATION_EXTENSION_NAME "KHR_mesh_quantization"
+
 // https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/README.md#reference-material
 struct GltfMaterial
 {
@@ -224,6 +227,9 @@ struct GltfScene {
 	std::vector<glm::vec2> m_texcoords1;
 	std::vector<glm::vec4> m_colors0;
 
+	// Worker threads processing the primitives of importDrawableNodes, 0 uses the number of hardware threads
+	uint32_t m_importThreadCount{ 0 };
+
 	struct Dimensions
 	{
 		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
@@ -235,13 +241,12 @@ struct GltfScene {
 
 private:
 	void processNode(const tinygltf::Model& tmodel, int& nodeIdx, const glm::mat4& parentMatrix);
-	void processMesh(const tinygltf::Model& tmodel, const tinygltf::Primitive& tmesh, GltfAttributes attributes, const std::string& name);
+	// Fills the preallocated index / vertex ranges of resultMesh - may run concurrently for different primitives
+	void processMesh(const tinygltf::Model& tmodel, const tinygltf::Primitive& tmesh, GltfAttributes attributes,
+		const GltfPrimMesh& resultMesh, bool ownsVertices);
 
 	// Temporary data
 	std::unordered_map<int, std::vector<uint32_t>> m_meshToPrimMeshes;
-	std::vector<uint32_t>                          primitiveIndices32u;
-	std::vector<uint16_t>                          primitiveIndices16u;
-	std::vector<uint8_t>                           primitiveIndices8u;
 
 	std::unordered_map<std::string, GltfPrimMesh> m_cachePrimMesh;
 
@@ -315,8 +320,50 @@ static inline void getTexId(const tinygltf::Value & value, const std::string & n
 	}
 }
 
+// Reads one component of an attribute, dequantizing the integer types of KHR_mesh_quantization
+inline float getAttributeComponent(const uint8_t* data, int componentType, bool normalized)
+{
+	switch (componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+	{
+		float value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+	{
+		int8_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? std::max(value / 127.f, -1.f) : float(value);
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+	{
+		uint8_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? value / 255.f : float(value);
+	}
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+	{
+		int16_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? std::max(value / 32767.f, -1.f) : float(value);
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+	{
+		uint16_t value;
+		memcpy(&value, data, sizeof(value));
+		return normalized ? value / 65535.f : float(value);
+	}
+	default:
+		assert(!"KHR_mesh_quantization unsupported format");
+		return 0.f;
+	}
+}
+
+// Writes the accessor.count elements of the attribute to attribData
 template <typename T>
-static bool getAttribute(const tinygltf::Model& tmodel, const tinygltf::Primitive& primitive, std::vector<T>& attribVec, const std::string& attribName)
+static bool getAttribute(const tinygltf::Model& tmodel, const tinygltf::Primitive& primitive, T* attribData, const std::string& attribName)
 {
 	if (primitive.attributes.find(attribName) == primitive.attributes.end())
 		return false;
@@ -325,75 +372,39 @@ static bool getAttribute(const tinygltf::Model& tmodel, const tinygltf::Primitiv
 	const auto& accessor = tmodel.accessors[primitive.attributes.find(attribName)->second];
 	const auto& bufView = tmodel.bufferViews[accessor.bufferView];
 	const auto& buffer = tmodel.buffers[bufView.buffer];
-	const auto  bufData = reinterpret_cast<const T*>(&(buffer.data[accessor.byteOffset + bufView.byteOffset]));
+	const auto  bufData = &(buffer.data[accessor.byteOffset + bufView.byteOffset]);
 	const auto  nbElems = accessor.count;
 
-	// Supporting KHR_mesh_quantization
-	assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+	const int    nbComponents = tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	const size_t strideComponent = size_t(tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType)));
+	const size_t byteStride = size_t(accessor.ByteStride(bufView));
+	assert(nbComponents > 0 && nbComponents <= T::length() && byteStride > 0);
 
 	// Copying the attributes
-	if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+	if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && nbComponents == T::length() && byteStride == sizeof(T))
 	{
-		if (bufView.byteStride == 0)
-		{
-			attribVec.insert(attribVec.end(), bufData, bufData + nbElems);
-		}
-		else
-		{
-			// With stride, need to add one by one the element
-			auto bufferByte = reinterpret_cast<const uint8_t*>(bufData);
-			for (size_t i = 0; i < nbElems; i++)
-			{
-				attribVec.push_back(*reinterpret_cast<const T*>(bufferByte));
-				bufferByte += bufView.byteStride;
-			}
-		}
+		memcpy(attribData, bufData, nbElems * sizeof(T));
 	}
 	else
 	{
-		// The component is smaller than float and need to be converted
-
-		// VEC3 or VEC4
-		int nbComponents = accessor.type == TINYGLTF_TYPE_VEC2 ? 2 : (accessor.type == TINYGLTF_TYPE_VEC3) ? 3 : 4;
-		// UNSIGNED_BYTE or UNSIGNED_SHORT
-		size_t strideComponent = accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ? 1 : 2;
-
-		size_t byteStride = bufView.byteStride > 0 ? bufView.byteStride : size_t(nbComponents) * strideComponent;
-		auto   bufferByte = reinterpret_cast<const uint8_t*>(bufData);
+		// Interleaved, quantized (KHR_mesh_quantization) or fewer components than T (VEC3 colors):
+		// converted component by component, missing components are 1
+		const uint8_t* bufferByte = bufData;
 		for (size_t i = 0; i < nbElems; i++)
 		{
-			T vecValue;
+			T vecValue(1.f);
 
-			auto bufferByteData = bufferByte;
+			const uint8_t* bufferByteData = bufferByte;
 			for (int c = 0; c < nbComponents; c++)
 			{
-				float value = *reinterpret_cast<const float*>(bufferByteData);
-				switch (accessor.componentType)
-				{
-				case TINYGLTF_COMPONENT_TYPE_BYTE:
-					vecValue[c] = std::max(value / 127.f, -1.f);
-					break;
-				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-					vecValue[c] = value / 255.f;
-					break;
-				case TINYGLTF_COMPONENT_TYPE_SHORT:
-					vecValue[c] = std::max(value / 32767.f, -1.f);
-					break;
-				case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-					vecValue[c] = value / 65535.f;
-					break;
-				default:
-					assert(!"KHR_mesh_quantization unsupported format");
-					break;
-				}
+				vecValue[c] = getAttributeComponent(bufferByteData, accessor.componentType, accessor.normalized);
 				bufferByteData += strideComponent;
 			}
 			bufferByte += byteStride;
-			attribVec.push_back(vecValue);
+			attribData[i] = vecValue;
 		}
 	}
 
-
 	return true;
 }
 
@@ -39,6 +39,11 @@ VulkanAppBase::~VulkanAppBase() {
 
 	destroyMultisampleColorBuffer();
 	destroyDepthStencilImage();
+	frameRingBuffer.cleanup();
+	devices.deletionQueue.cleanup();
+	devices.asyncUploadQueue.cleanup();
+	devices.samplerCache.cleanup();
+	devices.stagingBufferPool.cleanup();
 	devices.memoryAllocator.cleanup();
 
 	if (!presentCompleteSemaphores.empty()) {
@@ -47,6 +52,7 @@ VulkanAppBase::~VulkanAppBase() {
 			vkDestroySemaphore(devices.device, renderCompleteSemaphores[i], nullptr);
 			vkDestroyFence(devices.device, frameLimitFences[i], nullptr);
 		}
+		vkDestroyFence(devices.device, defragmentationFence, nullptr);
 	}
 
 	swapchain.cleanup();
@@ -63,6 +69,22 @@ VulkanAppBase::~VulkanAppBase() {
 	glfwTerminate();
 }
 
+/*
+* read launch options - must be called before init
+* --memory-trace <path> : record every device memory allocation & free for allocator_replay
+*
+* @param argc
+* @param argv
+*/
+void VulkanAppBase::parseCommandLine(int argc, char** argv) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--memory-trace" && i + 1 < argc) {
+			memoryTracePath = argv[++i];
+		}
+	}
+}
+
 /*
 * init program - window & vulkan & application
 */
@@ -82,6 +104,13 @@ void VulkanAppBase::init() {
 void VulkanAppBase::run() {
 	while (!glfwWindowShouldClose(window) && !terminate) {
 		glfwPollEvents();
+		//per-frame resources are reusable once the last submission of this frame is finished
+		vkWaitForFences(devices.device, 1, &frameLimitFences[currentFrame], VK_TRUE, UINT64_MAX);
+		frameRingBuffer.beginFrame(currentFrame);
+		devices.deletionQueue.beginFrame();
+		if (devices.memoryAllocator.isDefragmenting()) {
+			defragmentMemory();
+		}
 		update();
 		draw();
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -132,6 +161,15 @@ void VulkanAppBase::initVulkan() {
 	devices.createLogicalDevice();
 	devices.createCommandPool(commandPoolFlags);
 	vkdebug::marker::init(devices.device); //debug utils function pointers
+	if (!memoryTracePath.empty()) {
+		devices.memoryAllocator.startTrace(memoryTracePath);
+	}
+	devices.stagingBufferPool.init(&devices, stagingBufferSize, stagingBufferCount);
+	devices.deletionQueue.init(&devices, MAX_FRAMES_IN_FLIGHT);
+	devices.samplerCache.init(&devices);
+	if (devices.timelineSemaphoreSupported) {
+		devices.asyncUploadQueue.init(&devices);
+	}
 
 	swapchain.init(&devices, window);
 	swapchain.create();
@@ -211,6 +249,14 @@ void VulkanAppBase::initApp() {
 	createCommandBuffers();
 	createSyncObjects();
 	createPipelineCache();
+	//tlas instances are read by the acceleration structure build straight from the ring buffer
+	VkBufferUsageFlags frameRingBufferUsage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	if (devices.accelerationStructureSupported) {
+		frameRingBufferUsage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+	}
+	frameRingBuffer.init(&devices, MAX_FRAMES_IN_FLIGHT, frameRingBufferSize, frameRingBufferUsage);
 	createDepthStencilImage(sampleCount);
 	createMultisampleColorBuffer(sampleCount);
 }
@@ -257,6 +303,16 @@ void VulkanAppBase::update() {
 		oldPrintKeyState = GLFW_RELEASE;
 	}
 
+	//memory statistics window
+	static int oldMemoryStatisticsKeyState = GLFW_RELEASE;
+	if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_PRESS && oldMemoryStatisticsKeyState == GLFW_RELEASE) {
+		oldMemoryStatisticsKeyState = GLFW_PRESS;
+		imguiBase->showMemoryStatistics = !imguiBase->showMemoryStatistics;
+	}
+	if (glfwGetKey(window, GLFW_KEY_F6) == GLFW_RELEASE && oldMemoryStatisticsKeyState == GLFW_PRESS) {
+		oldMemoryStatisticsKeyState = GLFW_RELEASE;
+	}
+
 	if (captureMouse == true) {
 		updateCamera();
 	}
@@ -292,6 +348,7 @@ uint32_t VulkanAppBase::prepareFrame() {
 	VkResult result = swapchain.acquireImage(presentCompleteSemaphores[currentFrame], imageIndex);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
 		resizeWindow(sampleCount);
+		devices.memoryAllocator.releaseEmptyChunks(MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT);
 	}
 	else {
 		VK_CHECK_RESULT(result);
@@ -317,6 +374,8 @@ void VulkanAppBase::submitFrame(uint32_t imageIndex) {
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || windowResized) {
 		windowResized = false;
 		resizeWindow(sampleCount);
+		//resized resources reused the old chunks in place - give back the ones the new extent doesn't need
+		devices.memoryAllocator.releaseEmptyChunks(MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT);
 	}
 	else {
 		VK_CHECK_RESULT(result);
@@ -335,8 +394,10 @@ void VulkanAppBase::resizeWindow(bool recordCmdBuf) {
 		glfwWaitEvents();
 	}
 
-	//finish all command before destroy vk resources
-	vkDeviceWaitIdle(devices.device);
+	//finish frames in flight before destroy vk resources - async uploads keep running,
+	//the old swapchain is retired to the deletion queue as it may still be presented
+	vkWaitForFences(devices.device, static_cast<uint32_t>(frameLimitFences.size()), frameLimitFences.data(),
+		VK_TRUE, UINT64_MAX);
 
 	//swapchain
 	swapchain.create();
@@ -376,10 +437,60 @@ void VulkanAppBase::windowResizeCallbck(GLFWwindow* window, int width, int heigh
 	app->windowResized = true;
 }
 
+/*
+* copy one budget of planned memory moves & hand the new resources to their owners
+* the pass is submitted to the graphics queue with its own fence (the queue isn't waited),
+* a later frame finishes it once the fence is signaled & the frames using the old resources are finished
+*/
+void VulkanAppBase::defragmentMemory() {
+	if (defragmentationCommandBuffer != VK_NULL_HANDLE) {
+		//copies still running - frames keep using the old resources
+		if (vkGetFenceStatus(devices.device, defragmentationFence) != VK_SUCCESS) {
+			return;
+		}
+		vkFreeCommandBuffers(devices.device, devices.commandPool, 1, &defragmentationCommandBuffer);
+		defragmentationCommandBuffer = VK_NULL_HANDLE;
+
+		//old resources are destroyed & owners rewrite descriptors in the callbacks - frames in flight may use them
+		vkWaitForFences(devices.device, static_cast<uint32_t>(frameLimitFences.size()), frameLimitFences.data(),
+			VK_TRUE, UINT64_MAX);
+		//recorded command buffers are invalidated
+		if (devices.memoryAllocator.endDefragmentationPass() > 0 && !buildCommandBuffersEveryFrame) {
+			resetCommandBuffer();
+			recordCommandBuffer();
+		}
+		if (!devices.memoryAllocator.isDefragmenting()) {
+			return;
+		}
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = devices.commandPool;
+	allocInfo.commandBufferCount = 1;
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(devices.device, &allocInfo, &defragmentationCommandBuffer));
+
+	VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK_RESULT(vkBeginCommandBuffer(defragmentationCommandBuffer, &beginInfo));
+	devices.memoryAllocator.recordDefragmentationPass(defragmentationCommandBuffer, defragmentationBytesPerFrame);
+	VK_CHECK_RESULT(vkEndCommandBuffer(defragmentationCommandBuffer));
+
+	//ordered with the frames by the barriers of the pass
+	VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &defragmentationCommandBuffer;
+	VK_CHECK_RESULT(vkResetFences(devices.device, 1, &defragmentationFence));
+	VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, defragmentationFence));
+}
+
 /*
 * destroy & recreate command buffer
 */
 void VulkanAppBase::resetCommandBuffer() {
+	//pre-recorded command buffers of the other frames in flight may still be pending
+	vkWaitForFences(devices.device, static_cast<uint32_t>(frameLimitFences.size()), frameLimitFences.data(),
+		VK_TRUE, UINT64_MAX);
 	destroyCommandBuffers();
 	createCommandBuffers();
 }
@@ -496,8 +607,9 @@ void VulkanAppBase::createInstance() {
 * allocate empty command buffers
 */
 void VulkanAppBase::createCommandBuffers() {
-	commandBuffers.resize(buildCommandBuffersEveryFrame ? 
-		swapchain.imageCount  : swapchain.imageCount * MAX_FRAMES_IN_FLIGHT);
+	//re-recorded: one per frame in flight, pre-recorded: one per swapchain image & frame in flight
+	commandBuffers.resize(buildCommandBuffersEveryFrame ?
+		MAX_FRAMES_IN_FLIGHT : swapchain.imageCount * MAX_FRAMES_IN_FLIGHT);
 
 	VkCommandBufferAllocateInfo commandBufferInfo{};
 	commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -540,6 +652,7 @@ void VulkanAppBase::createSyncObjects() {
 		VK_CHECK_RESULT(vkCreateSemaphore(devices.device, &semaphoreInfo, nullptr, &renderCompleteSemaphores[i]));
 		VK_CHECK_RESULT(vkCreateFence(devices.device, &fenceInfo, nullptr, &frameLimitFences[i]));
 	}
+	VK_CHECK_RESULT(vkCreateFence(devices.device, &fenceInfo, nullptr, &defragmentationFence));
 	LOG("created:\tsync objects");
 }
 
@@ -571,7 +684,8 @@ void VulkanAppBase::createDepthStencilImage(VkSampleCountFlagBits sampleCount) {
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 1,
 		devices.lazilyAllocatedMemoryTypeExist ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		sampleCount
+		sampleCount,
+		MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT
 	);
 
 	VkImageAspectFlags aspectMask = 0;
@@ -601,8 +715,7 @@ void VulkanAppBase::destroyDepthStencilImage() {
 		return;
 
 	vkDestroyImageView(devices.device, depthImageView, nullptr);
-	devices.memoryAllocator.freeImageMemory(depthImage,
-		devices.lazilyAllocatedMemoryTypeExist ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices.memoryAllocator.freeImageMemory(depthImage);
 	vkDestroyImage(devices.device, depthImage, nullptr);
 }
 
@@ -621,7 +734,8 @@ void VulkanAppBase::createMultisampleColorBuffer(VkSampleCountFlagBits sampleCou
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 1, 
 		devices.lazilyAllocatedMemoryTypeExist ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		sampleCount
+		sampleCount,
+		MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT
 	);
 
 	multisampleColorImageView = vktools::createImageView(devices.device,
@@ -638,8 +752,7 @@ void VulkanAppBase::createMultisampleColorBuffer(VkSampleCountFlagBits sampleCou
 */
 void VulkanAppBase::destroyMultisampleColorBuffer() {
 	vkDestroyImageView(devices.device, multisampleColorImageView, nullptr);
-	devices.memoryAllocator.freeImageMemory(multisampleColorImage,
-		devices.lazilyAllocatedMemoryTypeExist ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices.memoryAllocator.freeImageMemory(multisampleColorImage);
 	vkDestroyImage(devices.device, multisampleColorImage, nullptr);
 
 	multisampleColorImageView = VK_NULL_HANDLE;
@@ -800,8 +913,9 @@ void VulkanAppBase::saveScreenshot(const std::string& filename) {
 	VkSubresourceLayout subresourceLayout;
 	vkGetImageSubresourceLayout(devices.device, dstImage, &subresource, &subresourceLayout);
 
-	//map image memory
-	const uint8_t* data = reinterpret_cast<const uint8_t*>(imageMemory.getHandle(devices.device));
+	//image memory is persistently mapped - invalidate in case it is not coherent
+	imageMemory.invalidate(devices.device);
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(imageMemory.getHandle());
 	data += subresourceLayout.offset;
 
 	if (!blitSupport) {
@@ -830,8 +944,7 @@ void VulkanAppBase::saveScreenshot(const std::string& filename) {
 	}
 
 	//cleanup
-	imageMemory.unmap(devices.device);
-	devices.memoryAllocator.freeImageMemory(dstImage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	devices.memoryAllocator.freeImageMemory(dstImage);
 	vkDestroyImage(devices.device, dstImage, nullptr);
 	LOG("save image file: " + filename);
 }
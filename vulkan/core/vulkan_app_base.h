@@ -3,6 +3,7 @@
 #include "vulkan_swapchain.h"
 #include "GLFW/glfw3.h"
 #include "vulkan_imgui.h"
+#include "vulkan_frame_ring_buffer.h"
 
 class VulkanAppBase {
 public:
@@ -10,6 +11,7 @@ public:
 		VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT);
 	virtual ~VulkanAppBase();
 
+	void parseCommandLine(int argc, char** argv);
 	void init();
 	void run();
 
@@ -37,6 +39,8 @@ protected:
 
 	/** @brief copy & save image from last swapchain image */
 	void saveScreenshot(const std::string& filename);
+	/** @brief submit one budget of planned memory moves / finish the submitted one */
+	void defragmentMemory();
 
 	/** glfw window handle */
 	GLFWwindow* window;
@@ -64,7 +68,7 @@ protected:
 	VulkanDevice devices;
 	/** abstracted swapchain object - contains swapchain image views */
 	VulkanSwapchain swapchain;
-	/** command buffers - per swapchain */
+	/** command buffers - per frame in flight (re-recorded every frame) or per swapchain image & frame in flight */
 	std::vector<VkCommandBuffer> commandBuffers;
 	/** sync image acquisition */
 	std::vector<VkSemaphore> presentCompleteSemaphores;
@@ -72,6 +76,9 @@ protected:
 	std::vector<VkSemaphore> renderCompleteSemaphores;
 	/** limits maximum frames in flight */
 	std::vector<VkFence> frameLimitFences;
+	/** memory defragmentation pass in flight & its fence - VK_NULL_HANDLE if no pass is submitted */
+	VkCommandBuffer defragmentationCommandBuffer = VK_NULL_HANDLE;
+	VkFence defragmentationFence = VK_NULL_HANDLE;
 	/** tracks all swapchain images if they are being used */
 	std::vector<VkFence> inFlightImageFences;
 	/** pipeline cache */
@@ -80,6 +87,17 @@ protected:
 	int MAX_FRAMES_IN_FLIGHT = 2;
 	/** current frame - index for MAX_FRAMES_IN_FLIGHT */
 	size_t currentFrame = 0;
+	/** per-frame transient allocations (ui geometry, uniforms, copy sources) */
+	FrameRingBuffer frameRingBuffer;
+	/** byte size of each frame of frameRingBuffer */
+	VkDeviceSize frameRingBufferSize = 4 * 1024 * 1024; //4 MiB
+	/** byte size & number of staging buffers shared by all uploads */
+	VkDeviceSize stagingBufferSize = 32 * 1024 * 1024; //32 MiB
+	uint32_t stagingBufferCount = 2;
+	/** bytes copied per frame while a memory defragmentation is running */
+	VkDeviceSize defragmentationBytesPerFrame = 32 * 1024 * 1024; //32 MiB
+	/** allocation trace file (--memory-trace <path>) - empty if not recorded */
+	std::string memoryTracePath;
 	/** number of elapsed frames */
 	size_t elapsedFrames = 0;
 	/** window resize check */
@@ -98,7 +116,7 @@ protected:
 	VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
 	/** command pool flags */
 	VkCommandPoolCreateFlags commandPoolFlags = 0;
-	/** indicate app using pre-recoreded command buffers or re-reocrd every frame */
+	/** indicate app using pre-recoreded command buffers or re-reocrd every frame (commandBuffers[currentFrame] after prepareFrame) */
 	bool buildCommandBuffersEveryFrame = false;
 	/** set default depth buffer */
 	bool createDefaultDepthBuffer = true;
@@ -142,9 +160,10 @@ private:
 * entry point
 */
 #define RUN_APPLICATION_MAIN(Application, WIDTH, HEIGHT, appName)	\
-int main(void) {													\
+int main(int argc, char** argv) {								\
 	try {															\
 		Application app(WIDTH, HEIGHT, appName);					\
+		app.parseCommandLine(argc, argv);							\
 		app.init();													\
 		app.run();													\
 	}										\
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include "vulkan_async_upload_queue.h"
+#include "vulkan_device.h"
+
+/*
+* create transfer command pool & timeline semaphore
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+*/
+void AsyncUploadQueue::init(VulkanDevice* devices) {
+	if (!devices->timelineSemaphoreSupported) {
+		throw std::runtime_error("AsyncUploadQueue::init(): timeline semaphores are not supported");
+	}
+	this->devices = devices;
+	graphicsFamily = devices->indices.graphicsFamily.value();
+	transferFamily = devices->indices.transferFamily.value_or(graphicsFamily);
+	timelineValue = 0;
+
+	VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.queueFamilyIndex = transferFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	VK_CHECK_RESULT(vkCreateCommandPool(devices->device, &poolInfo, nullptr, &commandPool));
+
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO };
+	semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeInfo.initialValue = 0;
+	VkSemaphoreCreateInfo semaphoreInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+	semaphoreInfo.pNext = &semaphoreTypeInfo;
+	VK_CHECK_RESULT(vkCreateSemaphore(devices->device, &semaphoreInfo, nullptr, &timelineSemaphore));
+
+	LOG("created:\tasync upload queue (queue family " + std::to_string(transferFamily) +
+		(hasDedicatedQueue() ? ", dedicated)" : ", shared with graphics)"));
+}
+
+/*
+* wait for pending uploads & destroy vulkan objects
+*/
+void AsyncUploadQueue::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+
+	//recorded but never submitted - staging ranges weren't read
+	if (commandBuffer != VK_NULL_HANDLE) {
+		vkEndCommandBuffer(commandBuffer);
+		vkFreeCommandBuffers(devices->device, commandPool, 1, &commandBuffer);
+		commandBuffer = VK_NULL_HANDLE;
+		for (const auto& stagingRange : stagingRanges) {
+			devices->stagingBufferPool.free(stagingRange);
+		}
+		stagingRanges.clear();
+	}
+
+	wait(timelineValue);
+	collect();
+
+	pendingAcquires.clear();
+	vkDestroySemaphore(devices->device, timelineSemaphore, nullptr);
+	vkDestroyCommandPool(devices->device, commandPool, nullptr);
+	timelineSemaphore = VK_NULL_HANDLE;
+	commandPool = VK_NULL_HANDLE;
+	devices = nullptr;
+}
+
+/*
+* create device local buffer & record copy of data to it
+* the buffer can't be used before recordAcquireBarriers() returns the value of its submission
+*
+* @param buffer - return buffer handle
+* @param data - data to be copied
+* @param size - byte size of data
+* @param usage - buffer usage (TRANSFER_DST is added)
+*/
+void AsyncUploadQueue::uploadBuffer(VkBuffer& buffer, const void* data, VkDeviceSize size, VkBufferUsageFlags usage) {
+	VkCommandBuffer cmdBuf = getCommandBuffer();
+	StagingBufferPool::Allocation staging = devices->stagingBufferPool.upload(data, size);
+	stagingRanges.push_back(staging);
+
+	devices->createBuffer(buffer, size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	VkBufferCopy bufferCopyRegion{};
+	bufferCopyRegion.srcOffset = staging.offset;
+	bufferCopyRegion.dstOffset = 0;
+	bufferCopyRegion.size = size;
+	vkCmdCopyBuffer(cmdBuf, staging.buffer, buffer, 1, &bufferCopyRegion);
+
+	//release ownership to the graphics queue family
+	if (hasDedicatedQueue()) {
+		VkBufferMemoryBarrier barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	PendingAcquire pendingAcquire{};
+	pendingAcquire.buffer = buffer;
+	pendingAcquires.push_back(pendingAcquire);
+}
+
+/*
+* record copy of data to an image - the image must be in undefined layout & not used until acquired
+*
+* @param image - destination image created with TRANSFER_DST usage
+* @param data - data to be copied
+* @param size - byte size of data
+* @param regions - copy regions, bufferOffset is relative to data
+* @param range - subresources written by the regions
+* @param finalLayout - layout of the image after the upload
+*/
+void AsyncUploadQueue::uploadImage(VkImage image, const void* data, VkDeviceSize size,
+	const std::vector<VkBufferImageCopy>& regions, const VkImageSubresourceRange& range,
+	VkImageLayout finalLayout) {
+	VkCommandBuffer cmdBuf = getCommandBuffer();
+	StagingBufferPool::Allocation staging = devices->stagingBufferPool.upload(data, size);
+	stagingRanges.push_back(staging);
+
+	//undefined -> transfer dst optimal
+	VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+	vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> stagingRegions = regions;
+	for (auto& region : stagingRegions) {
+		region.bufferOffset += staging.offset;
+	}
+	vkCmdCopyBufferToImage(cmdBuf, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(stagingRegions.size()), stagingRegions.data());
+
+	//transfer dst optimal -> final layout (+ release ownership to the graphics queue family)
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	if (hasDedicatedQueue()) {
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+	}
+	vkCmdPipelineBarrier(cmdBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	PendingAcquire pendingAcquire{};
+	pendingAcquire.image = image;
+	pendingAcquire.range = range;
+	pendingAcquire.finalLayout = finalLayout;
+	pendingAcquires.push_back(pendingAcquire);
+}
+
+/*
+* submit recorded copies - doesn't wait
+*
+* @return uint64_t - timeline value signaled when the copies are finished (last value if nothing was recorded)
+*/
+uint64_t AsyncUploadQueue::submit() {
+	if (commandBuffer == VK_NULL_HANDLE) {
+		return timelineValue;
+	}
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+	uint64_t signalValue = timelineValue + 1;
+	VkTimelineSemaphoreSubmitInfo timelineInfo{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timelineSemaphore;
+
+	VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	Submission submission{};
+	VK_CHECK_RESULT(vkCreateFence(devices->device, &fenceInfo, nullptr, &submission.fence));
+	VK_CHECK_RESULT(vkQueueSubmit(devices->transferQueue, 1, &submitInfo, submission.fence));
+	timelineValue = signalValue;
+
+	for (const auto& stagingRange : stagingRanges) {
+		devices->stagingBufferPool.free(stagingRange, submission.fence);
+	}
+	stagingRanges.clear();
+	for (auto& pendingAcquire : pendingAcquires) {
+		if (pendingAcquire.value == 0) {
+			pendingAcquire.value = signalValue;
+		}
+	}
+
+	submission.value = signalValue;
+	submission.commandBuffer = commandBuffer;
+	submissions.push_back(submission);
+	commandBuffer = VK_NULL_HANDLE;
+	return signalValue;
+}
+
+/*
+* record acquire barriers (ownership transfer to the graphics queue family) of every submitted upload
+* the submission of commandBuffer must wait on the timeline semaphore with the returned value
+*
+* @param commandBuffer - graphics command buffer executed before the first use of the uploads
+*
+* @return uint64_t - timeline value to wait, 0 if there is nothing to acquire
+*/
+uint64_t AsyncUploadQueue::recordAcquireBarriers(VkCommandBuffer commandBuffer) {
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	uint64_t waitValue = 0;
+
+	for (const auto& pendingAcquire : pendingAcquires) {
+		if (pendingAcquire.value == 0) {
+			continue;
+		}
+		waitValue = std::max(waitValue, pendingAcquire.value);
+		if (!hasDedicatedQueue()) {
+			continue;
+		}
+
+		if (pendingAcquire.buffer != VK_NULL_HANDLE) {
+			VkBufferMemoryBarrier barrier{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.buffer = pendingAcquire.buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(barrier);
+		}
+		else {
+			//layouts must match the release barrier
+			VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = pendingAcquire.finalLayout;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.image = pendingAcquire.image;
+			barrier.subresourceRange = pendingAcquire.range;
+			imageBarriers.push_back(barrier);
+		}
+	}
+
+	if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+	pendingAcquires.erase(std::remove_if(pendingAcquires.begin(), pendingAcquires.end(),
+		[](const PendingAcquire& pendingAcquire) { return pendingAcquire.value != 0; }), pendingAcquires.end());
+	return waitValue;
+}
+
+/*
+* check if the submission returning value is finished
+*
+* @param value - timeline value returned by submit()
+*
+* @return bool - true if finished
+*/
+bool AsyncUploadQueue::isComplete(uint64_t value) const {
+	uint64_t counter = 0;
+	VK_CHECK_RESULT(vkGetSemaphoreCounterValue(devices->device, timelineSemaphore, &counter));
+	return counter >= value;
+}
+
+/*
+* block until the submission returning value is finished
+*
+* @param value - timeline value returned by submit()
+*/
+void AsyncUploadQueue::wait(uint64_t value) const {
+	if (value == 0) {
+		return;
+	}
+	VkSemaphoreWaitInfo waitInfo{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO };
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timelineSemaphore;
+	waitInfo.pValues = &value;
+	VK_CHECK_RESULT(vkWaitSemaphores(devices->device, &waitInfo, UINT64_MAX));
+}
+
+/*
+* free command buffers & staging ranges of finished submissions
+*/
+void AsyncUploadQueue::collect() {
+	//finished fences are picked first so that the staging buffer pool recycles every range using them
+	auto finishedEnd = std::stable_partition(submissions.begin(), submissions.end(),
+		[this](const Submission& submission) {
+			return vkGetFenceStatus(devices->device, submission.fence) == VK_SUCCESS;
+		});
+	if (finishedEnd == submissions.begin()) {
+		return;
+	}
+	devices->stagingBufferPool.collect();
+
+	for (auto it = submissions.begin(); it != finishedEnd; ++it) {
+		vkFreeCommandBuffers(devices->device, commandPool, 1, &it->commandBuffer);
+		vkDestroyFence(devices->device, it->fence, nullptr);
+	}
+	submissions.erase(submissions.begin(), finishedEnd);
+}
+
+/*
+* begin a command buffer if nothing is being recorded
+*
+* @return VkCommandBuffer - command buffer of the next submission
+*/
+VkCommandBuffer AsyncUploadQueue::getCommandBuffer() {
+	if (commandBuffer != VK_NULL_HANDLE) {
+		return commandBuffer;
+	}
+	collect();
+
+	VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(devices->device, &allocInfo, &commandBuffer));
+
+	VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+	return commandBuffer;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "vulkan_staging_buffer_pool.h"
+
+struct VulkanDevice;
+
+/*
+* asynchronous uploads on the transfer queue
+* copies are submitted to the dedicated transfer queue family (graphics queue if there is none) &
+* signal a timeline semaphore - the renderer records the acquire barriers of the finished uploads into
+* its own command buffer & waits on the returned timeline value only in the submission first using the data
+*
+* frame submission using the uploads :
+*	uint64_t waitValue = devices.asyncUploadQueue.recordAcquireBarriers(cmdBuf);
+*	if (waitValue > 0) -> add getTimelineSemaphore() / waitValue (VkTimelineSemaphoreSubmitInfo)
+*		to the wait semaphores of the submit with VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+*/
+class AsyncUploadQueue {
+public:
+	/** @brief create transfer command pool & timeline semaphore */
+	void init(VulkanDevice* devices);
+	/** @brief wait for pending uploads & destroy vulkan objects */
+	void cleanup();
+
+	/** @brief create device local buffer & record copy of data to it */
+	void uploadBuffer(VkBuffer& buffer, const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
+	/** @brief record copy of data to an image in undefined layout, the image ends in finalLayout */
+	void uploadImage(VkImage image, const void* data, VkDeviceSize size,
+		const std::vector<VkBufferImageCopy>& regions, const VkImageSubresourceRange& range,
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	/** @brief submit recorded copies - returns timeline value signaled when they are finished */
+	uint64_t submit();
+
+	/** @brief record acquire barriers of submitted uploads - returns timeline value to wait, 0 if none */
+	uint64_t recordAcquireBarriers(VkCommandBuffer commandBuffer);
+	/** @brief true if every upload of the submission returning value is finished */
+	bool isComplete(uint64_t value) const;
+	/** @brief block until the submission returning value is finished */
+	void wait(uint64_t value) const;
+	/** @brief free command buffers & staging ranges of finished submissions */
+	void collect();
+
+	/** @brief timeline semaphore signaled by submit() */
+	VkSemaphore getTimelineSemaphore() const { return timelineSemaphore; }
+	/** @brief true if uploads run on a queue family other than graphics (ownership transfer needed) */
+	bool hasDedicatedQueue() const { return transferFamily != graphicsFamily; }
+
+private:
+	/** resource waiting for its acquire barrier on the graphics queue */
+	struct PendingAcquire {
+		/** timeline value of the submission - 0 while recording */
+		uint64_t value = 0;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageSubresourceRange range{};
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+	/** submitted command buffer */
+	struct Submission {
+		uint64_t value = 0;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		/** handed to the staging buffer pool with the ranges of the submission */
+		VkFence fence = VK_NULL_HANDLE;
+	};
+
+	/** @brief begin a command buffer if nothing is being recorded */
+	VkCommandBuffer getCommandBuffer();
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	/** queue family indices of the upload & the graphics queues */
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+	/** command pool - transfer family */
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	/** signaled with an increasing value by each submission */
+	VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+	/** last signaled (submitted) timeline value */
+	uint64_t timelineValue = 0;
+	/** command buffer being recorded */
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	/** staging ranges used by the command buffer being recorded */
+	std::vector<StagingBufferPool::Allocation> stagingRanges;
+	/** in-flight submissions in submission order */
+	std::vector<Submission> submissions;
+	/** resources not acquired by the graphics queue yet */
+	std::vector<PendingAcquire> pendingAcquires;
+};
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include "vulkan_deletion_queue.h"
+#include "vulkan_device.h"
+
+/*
+* set the number of frames in flight
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+* @param frameCount - number of frames in flight, a resource is destroyed frameCount frames after its retirement
+*/
+void DeletionQueue::init(VulkanDevice* devices, uint32_t frameCount) {
+	this->devices = devices;
+	this->frameCount = std::max(frameCount, 1u);
+	currentFrame = 0;
+}
+
+/*
+* destroy every retired resource - the device must be idle
+*/
+void DeletionQueue::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	flush();
+	devices = nullptr;
+}
+
+/*
+* start a new frame & destroy resources retired frameCount frames ago
+* called after waiting for the fence of the new frame - every frame before (currentFrame - frameCount) is finished
+*/
+void DeletionQueue::beginFrame() {
+	currentFrame++;
+
+	//resources are sorted by frame
+	auto finishedEnd = std::find_if(retiredResources.begin(), retiredResources.end(),
+		[this](const RetiredResource& resource) {
+			return resource.frame + frameCount > currentFrame;
+		});
+	for (auto it = retiredResources.begin(); it != finishedEnd; ++it) {
+		it->destroy();
+	}
+	retiredResources.erase(retiredResources.begin(), finishedEnd);
+}
+
+/*
+* destroy every retired resource now - pending frames must be finished
+*/
+void DeletionQueue::flush() {
+	for (auto& resource : retiredResources) {
+		resource.destroy();
+	}
+	retiredResources.clear();
+}
+
+/*
+* destroy buffer & free its memory
+*
+* @param buffer - buffer created with VulkanDevice::createBuffer or allocated with memoryAllocator
+*/
+void DeletionQueue::retireBuffer(VkBuffer buffer) {
+	if (buffer == VK_NULL_HANDLE) {
+		return;
+	}
+	VulkanDevice* devices = this->devices;
+	retire([devices, buffer]() {
+		devices->memoryAllocator.freeBufferMemory(buffer);
+		vkDestroyBuffer(devices->device, buffer, nullptr);
+	});
+}
+
+/*
+* destroy image & free its memory
+*
+* @param image - image created with VulkanDevice::createImage or allocated with memoryAllocator
+*/
+void DeletionQueue::retireImage(VkImage image) {
+	if (image == VK_NULL_HANDLE) {
+		return;
+	}
+	VulkanDevice* devices = this->devices;
+	retire([devices, image]() {
+		devices->memoryAllocator.freeImageMemory(image);
+		vkDestroyImage(devices->device, image, nullptr);
+	});
+}
+
+/*
+* destroy image view
+*
+* @param imageView - image view to destroy
+*/
+void DeletionQueue::retireImageView(VkImageView imageView) {
+	if (imageView == VK_NULL_HANDLE) {
+		return;
+	}
+	VkDevice device = devices->device;
+	retire([device, imageView]() {
+		vkDestroyImageView(device, imageView, nullptr);
+	});
+}
+
+/*
+* destroy framebuffer
+*
+* @param framebuffer - framebuffer to destroy
+*/
+void DeletionQueue::retireFramebuffer(VkFramebuffer framebuffer) {
+	if (framebuffer == VK_NULL_HANDLE) {
+		return;
+	}
+	VkDevice device = devices->device;
+	retire([device, framebuffer]() {
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	});
+}
+
+/*
+* destroy acceleration structure & free the buffer it is stored in
+*
+* @param accel - acceleration structure to destroy
+* @param buffer - backing buffer of accel
+*/
+void DeletionQueue::retireAccelerationStructure(VkAccelerationStructureKHR accel, VkBuffer buffer) {
+	VkDevice device = devices->device;
+	retire([device, accel]() {
+		vkfp::vkDestroyAccelerationStructureKHR(device, accel, nullptr);
+	});
+	retireBuffer(buffer);
+}
+
+/*
+* free command buffers - they must not be reset or re-recorded after this call
+*
+* @param commandPool - pool the command buffers are allocated from
+* @param commandBuffers - command buffers to free
+*/
+void DeletionQueue::retireCommandBuffers(VkCommandPool commandPool, const std::vector<VkCommandBuffer>& commandBuffers) {
+	if (commandBuffers.empty()) {
+		return;
+	}
+	VkDevice device = devices->device;
+	retire([device, commandPool, commandBuffers]() {
+		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	});
+}
+
+/*
+* destroy swapchain - passed as oldSwapchain to its replacement, its images may still be presented
+*
+* @param swapchain - retired swapchain
+*/
+void DeletionQueue::retireSwapchain(VkSwapchainKHR swapchain) {
+	if (swapchain == VK_NULL_HANDLE) {
+		return;
+	}
+	VkDevice device = devices->device;
+	retire([device, swapchain]() {
+		vkDestroySwapchainKHR(device, swapchain, nullptr);
+	});
+}
+
+/*
+* custom destruction - called once the current frame is finished
+*
+* @param destroy - destroys the resource
+*/
+void DeletionQueue::retire(std::function<void()>&& destroy) {
+	retiredResources.push_back({ currentFrame, std::move(destroy) });
+}
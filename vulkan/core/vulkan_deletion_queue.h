@@ -0,0 +1,61 @@
+#pragma once
+#include <functional>
+#include "vulkan_utils.h"
+
+struct VulkanDevice;
+
+/*
+* deferred destruction of resources which may still be used by frames in flight
+* each resource is tagged with the frame it was retired in & destroyed once that frame's fence is signaled
+* (frameCount frames later) - replaces vkDeviceWaitIdle before destroying a resource
+*/
+class DeletionQueue {
+public:
+	/** @brief set the number of frames in flight */
+	void init(VulkanDevice* devices, uint32_t frameCount);
+	/** @brief destroy every retired resource - the device must be idle */
+	void cleanup();
+	/** @brief start a new frame & destroy resources whose frame is finished - the frame's fence must be signaled */
+	void beginFrame();
+	/** @brief destroy every retired resource now - pending frames must be finished */
+	void flush();
+
+	/** @brief destroy buffer & free its memory */
+	void retireBuffer(VkBuffer buffer);
+	/** @brief destroy image & free its memory */
+	void retireImage(VkImage image);
+	/** @brief destroy image view */
+	void retireImageView(VkImageView imageView);
+	/** @brief destroy framebuffer */
+	void retireFramebuffer(VkFramebuffer framebuffer);
+	/** @brief destroy acceleration structure & free its buffer */
+	void retireAccelerationStructure(VkAccelerationStructureKHR accel, VkBuffer buffer);
+	/** @brief free command buffers */
+	void retireCommandBuffers(VkCommandPool commandPool, const std::vector<VkCommandBuffer>& commandBuffers);
+	/** @brief destroy (retired) swapchain */
+	void retireSwapchain(VkSwapchainKHR swapchain);
+	/** @brief custom destruction */
+	void retire(std::function<void()>&& destroy);
+
+	/** @brief number of frames started with beginFrame() */
+	uint64_t getCurrentFrame() const { return currentFrame; }
+	/** @brief number of resources waiting for their frame */
+	size_t getPendingCount() const { return retiredResources.size(); }
+
+private:
+	/** resource waiting for its frame */
+	struct RetiredResource {
+		/** frame the resource was retired in */
+		uint64_t frame = 0;
+		std::function<void()> destroy;
+	};
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	/** number of frames in flight */
+	uint32_t frameCount = 1;
+	/** frame being recorded */
+	uint64_t currentFrame = 0;
+	/** retired resources in retirement order */
+	std::vector<RetiredResource> retiredResources;
+};
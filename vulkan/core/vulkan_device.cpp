@@ -103,6 +103,9 @@ void VulkanDevice::createLogicalDevice() {
 		indices.presentFamily.value(),
 		indices.computeFamily.value()
 	};
+	if (indices.transferFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	}
 
 	std::vector<VkDeviceQueueCreateInfo> queueInfos;
 	float queuePriority = 1.f;
@@ -127,6 +130,10 @@ void VulkanDevice::createLogicalDevice() {
 	if (availableFeatures.features.sampleRateShading == VK_TRUE) {
 		deviceFeatures.features.sampleRateShading = VK_TRUE;
 	}
+	if (availableFeatures.features.textureCompressionBC == VK_TRUE) {
+		deviceFeatures.features.textureCompressionBC = VK_TRUE;
+		textureCompressionBCSupported = true;
+	}
 	deviceInfo.pNext = &deviceFeatures;
 
 		//add device features
@@ -149,6 +156,7 @@ void VulkanDevice::createLogicalDevice() {
 			deviceFeatures.pNext = &device12Features;
 			device12Features.pNext = &deviceAsFeatures;
 			memflags |= VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+			accelerationStructureSupported = true;
 		}
 	}
 
@@ -180,6 +188,31 @@ void VulkanDevice::createLogicalDevice() {
 		}
 	}
 
+	//timeline semaphore for async uploads - core in vulkan 1.2
+	if (vk12Features.timelineSemaphore == VK_TRUE) {
+		device12Features.timelineSemaphore = VK_TRUE;
+		if (deviceFeatures.pNext != &device12Features) {
+			device12Features.pNext = deviceFeatures.pNext;
+			deviceFeatures.pNext = &device12Features;
+		}
+		timelineSemaphoreSupported = true;
+	}
+
+	//heap budget for memory statistics - optional
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	bool memoryBudgetSupported = std::find_if(availableExtensions.begin(), availableExtensions.end(),
+		[](const VkExtensionProperties& extension) {
+			return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+		}) != availableExtensions.end();
+	if (memoryBudgetSupported && std::find_if(requiredExtensions.begin(), requiredExtensions.end(),
+		[](const char* extension) { return strcmp(extension, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; })
+		== requiredExtensions.end()) {
+		requiredExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
 	//deviceInfo.pEnabledFeatures = &deviceFeatures;
 	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
 	deviceInfo.ppEnabledExtensionNames = requiredExtensions.data();
@@ -192,11 +225,21 @@ void VulkanDevice::createLogicalDevice() {
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
 	vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+	if (indices.transferFamily.has_value()) {
+		vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+	}
+	else {
+		transferQueue = graphicsQueue;
+	}
 
 	LOG("created:\tlogical device");
 
 	//custom memory allocator
-	memoryAllocator.init(device, properties.limits.bufferImageGranularity, memProperties, memflags);
+	memoryAllocator.init(device, properties.limits.bufferImageGranularity,
+		properties.limits.nonCoherentAtomSize, memProperties, memflags);
+	if (memoryBudgetSupported) {
+		memoryAllocator.enableMemoryBudget(physicalDevice);
+	}
 }
 
 /*
@@ -291,6 +334,16 @@ VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilyIndices(VkPhysical
 		i++;
 	}
 
+	//dedicated transfer family (DMA engine) - not required
+	for (uint32_t family = 0; family < queueFamilyCount; ++family) {
+		VkQueueFlags flags = queueFamilies[family].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+			!(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+			indices.transferFamily = family;
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -368,6 +421,7 @@ void VulkanDevice::copyBuffer(VkCommandPool commandPool, VkBuffer srcBuffer, VkB
 * @param tiling - image tiling mode
 * @param usage - image usage bits
 * @param properties - image memory property bits
+* @param lifetime - RESOLUTION_DEPENDENT for swapchain-sized images, keeps them out of static chunks
 * @param image - return image handle
 * @param imageMemory - return image memory handle
 */
@@ -378,12 +432,13 @@ MemoryAllocator::HostVisibleMemory VulkanDevice::createImage(VkImage& image,
 	VkImageUsageFlags usage,
 	uint32_t mipLevels,
 	VkMemoryPropertyFlags properties,
-	VkSampleCountFlagBits numSamples) {
+	VkSampleCountFlagBits numSamples,
+	MemoryAllocator::MemoryLifetime lifetime) {
 	//image creation
 	VkImageCreateInfo imageInfo = 
 		vktools::initializers::imageCreateInfo(extent, format, tiling, usage, mipLevels, numSamples);
 	VK_CHECK_RESULT(vkCreateImage(device, &imageInfo, nullptr, &image));
-	return memoryAllocator.allocateImageMemory(image, properties);
+	return memoryAllocator.allocateImageMemory(image, properties, lifetime, tiling);
 }
 
 void VulkanDevice::copyBufferToImage(VkBuffer buffer, VkImage image,
@@ -2,6 +2,10 @@
 #include <optional>
 #include "vulkan_utils.h"
 #include "vulkan_memory_allocator.h"
+#include "vulkan_staging_buffer_pool.h"
+#include "vulkan_async_upload_queue.h"
+#include "vulkan_deletion_queue.h"
+#include "vulkan_sampler_cache.h"
 
 struct VulkanDevice {
 	VulkanDevice() {}
@@ -22,7 +26,8 @@ struct VulkanDevice {
 	MemoryAllocator::HostVisibleMemory createImage(VkImage& image, VkExtent3D extent, VkFormat format,
 		VkImageTiling tiling, VkImageUsageFlags usage, uint32_t mipLevels,
 		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		VkSampleCountFlagBits numSamples = VK_SAMPLE_COUNT_1_BIT);
+		VkSampleCountFlagBits numSamples = VK_SAMPLE_COUNT_1_BIT,
+		MemoryAllocator::MemoryLifetime lifetime = MemoryAllocator::MemoryLifetime::STATIC);
 	/** @brief copy data to an image */
 	void copyBufferToImage(VkBuffer buffer, VkImage image, VkOffset3D offset, VkExtent3D extent) const;
 	/** @brief create & start one-time submit command buffer */
@@ -43,6 +48,8 @@ struct VulkanDevice {
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
 		std::optional<uint32_t> computeFamily;
+		/** transfer-only family (no graphics / compute) if the device has one - optional */
+		std::optional<uint32_t> transferFamily;
 
 		bool isComplete() const {
 			return graphicsFamily.has_value() && 
@@ -56,6 +63,8 @@ struct VulkanDevice {
 	VkQueue presentQueue;
 	/** handle to the compute queue */
 	VkQueue computeQueue;
+	/** handle to the transfer queue (graphics queue if there is no transfer family) */
+	VkQueue transferQueue;
 	/** memory properties of the current physical device */
 	VkPhysicalDeviceMemoryProperties memProperties;
 	/** current physical device properties */
@@ -68,10 +77,24 @@ struct VulkanDevice {
 	VkCommandPool commandPool = VK_NULL_HANDLE;
 	/** custom memory allocator */
 	MemoryAllocator memoryAllocator;
+	/** reusable copy sources for uploads */
+	StagingBufferPool stagingBufferPool;
+	/** uploads overlapping rendering on the transfer queue */
+	AsyncUploadQueue asyncUploadQueue;
+	/** resources destroyed once the frames using them are finished */
+	DeletionQueue deletionQueue;
+	/** samplers shared by textures */
+	SamplerCache samplerCache;
 	/** max sample count */
 	uint32_t maxSampleCount;
 	/** VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT support */
 	bool lazilyAllocatedMemoryTypeExist = false;
+	/** timeline semaphore feature enabled */
+	bool timelineSemaphoreSupported = false;
+	/** textureCompressionBC feature enabled - BC textures are decoded to rgba8 otherwise */
+	bool textureCompressionBCSupported = false;
+	/** accelerationStructure & bufferDeviceAddress features enabled */
+	bool accelerationStructureSupported = false;
 
 	/** ray tracing features */
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR };
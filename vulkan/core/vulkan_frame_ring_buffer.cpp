@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <string>
+#include "vulkan_frame_ring_buffer.h"
+#include "vulkan_device.h"
+
+/*
+* create persistently mapped buffer with a region for each frame in flight
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+* @param frameCount - number of frames in flight
+* @param frameSize - byte size of each frame region
+* @param usage - buffer usage
+*/
+void FrameRingBuffer::init(VulkanDevice* devices, uint32_t frameCount, VkDeviceSize frameSize,
+	VkBufferUsageFlags usage) {
+	this->devices = devices;
+	currentFrame = 0;
+
+	//every allocation can be bound as a dynamic uniform / storage buffer
+	const VkPhysicalDeviceLimits& limits = devices->properties.limits;
+	defaultAlignment = std::max<VkDeviceSize>({ limits.minUniformBufferOffsetAlignment,
+		limits.minStorageBufferOffsetAlignment, 1 });
+	//frame regions start aligned as well
+	this->frameSize = (frameSize + defaultAlignment - 1) / defaultAlignment * defaultAlignment;
+
+	memory = devices->createBuffer(buffer, this->frameSize * frameCount, usage,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	heads.assign(frameCount, 0);
+}
+
+/*
+* destroy the buffer
+*/
+void FrameRingBuffer::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	devices->memoryAllocator.freeBufferMemory(buffer);
+	vkDestroyBuffer(devices->device, buffer, nullptr);
+	buffer = VK_NULL_HANDLE;
+	heads.clear();
+	devices = nullptr;
+}
+
+/*
+* reclaim all allocations of the frame
+* the caller must have waited for the fence of the last submission using this frame
+*
+* @param frameIndex - index of the frame in flight (0 <= frameIndex < frameCount)
+*/
+void FrameRingBuffer::beginFrame(size_t frameIndex) {
+	currentFrame = frameIndex;
+	heads[currentFrame] = 0;
+}
+
+/*
+* bump-allocate memory from the region of the current frame
+*
+* @param size - byte size to allocate
+* @param alignment - offset alignment, 0 to use max(minUniformBufferOffsetAlignment, minStorageBufferOffsetAlignment)
+*
+* @return Allocation - buffer, offset & mapped pointer of the allocated range
+*/
+FrameRingBuffer::Allocation FrameRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+	if (alignment == 0) {
+		alignment = defaultAlignment;
+	}
+
+	//frame regions are aligned to defaultAlignment, larger alignments are applied to the absolute offset
+	VkDeviceSize& head = heads[currentFrame];
+	VkDeviceSize frameOffset = getFrameOffset(currentFrame);
+	VkDeviceSize offset = (frameOffset + head + alignment - 1) / alignment * alignment;
+	if (offset + size > frameOffset + frameSize) {
+		throw std::runtime_error("FrameRingBuffer::allocate(): out of frame memory (" +
+			std::to_string(offset + size - frameOffset) + " / " + std::to_string(frameSize) + " bytes)");
+	}
+	head = offset + size - frameOffset;
+
+	Allocation allocation{};
+	allocation.buffer = buffer;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.data = static_cast<uint8_t*>(memory.mappedData) + offset;
+	return allocation;
+}
+
+/*
+* allocate & memcpy data
+*
+* @param data - data to be copied
+* @param size - byte size of data
+* @param alignment - offset alignment, 0 to use the default alignment
+*
+* @return Allocation - buffer, offset & mapped pointer of the allocated range
+*/
+FrameRingBuffer::Allocation FrameRingBuffer::upload(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+	Allocation allocation = allocate(size, alignment);
+	memcpy(allocation.data, data, static_cast<size_t>(size));
+	return allocation;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "vulkan_memory_allocator.h"
+
+struct VulkanDevice;
+
+/*
+* per-frame linear allocator for transient host -> device data (uniforms, ui geometry, copy sources)
+* each frame in flight owns a region of one persistently mapped buffer - allocation only bumps an offset and
+* the whole region is reclaimed at once when the frame's fence is signaled
+* a single buffer lets one dynamic uniform / storage descriptor serve every frame
+*/
+class FrameRingBuffer {
+public:
+	/** sub-range of the current frame buffer */
+	struct Allocation {
+		/** buffer handle - usable for dynamic uniform / storage offsets, vertex / index binding, copy source */
+		VkBuffer buffer = VK_NULL_HANDLE;
+		/** byte offset in buffer - dynamic offset of a descriptor written with getBuffer() */
+		VkDeviceSize offset = 0;
+		/** requested size */
+		VkDeviceSize size = 0;
+		/** mapped pointer to the beginning of this range */
+		void* data = nullptr;
+	};
+
+	/** @brief create persistently mapped buffer with a region for each frame in flight */
+	void init(VulkanDevice* devices, uint32_t frameCount, VkDeviceSize frameSize,
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	/** @brief destroy the buffer */
+	void cleanup();
+	/** @brief reclaim all allocations of the frame - the frame's fence must be signaled */
+	void beginFrame(size_t frameIndex);
+	/** @brief bump-allocate memory from the region of the current frame */
+	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+	/** @brief allocate & copy data */
+	Allocation upload(const void* data, VkDeviceSize size, VkDeviceSize alignment = 0);
+
+	/** @brief frame index passed to the last beginFrame() */
+	size_t getCurrentFrame() const { return currentFrame; }
+	/** @brief buffer shared by all frames - for dynamic uniform / storage descriptors */
+	VkBuffer getBuffer() const { return buffer; }
+	/** @brief byte offset of the region of a frame - offset of its first allocation */
+	VkDeviceSize getFrameOffset(size_t frameIndex) const { return frameIndex * frameSize; }
+
+private:
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	/** frameCount * frameSize bytes */
+	VkBuffer buffer = VK_NULL_HANDLE;
+	/** persistently mapped memory of buffer */
+	MemoryAllocator::HostVisibleMemory memory;
+	/** bump pointer of each frame - next free byte relative to the frame region */
+	std::vector<VkDeviceSize> heads;
+	/** index of the frame being recorded */
+	size_t currentFrame = 0;
+	/** size of each frame region - multiple of defaultAlignment */
+	VkDeviceSize frameSize = 0;
+	/** max(minUniformBufferOffsetAlignment, minStorageBufferOffsetAlignment) */
+	VkDeviceSize defaultAlignment = 1;
+};
@@ -11,7 +11,7 @@ void Framebuffer::cleanup() {
 
 	//images
 	for (auto& attachment : attachments) {
-		devices->memoryAllocator.freeImageMemory(attachment.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices->memoryAllocator.freeImageMemory(attachment.image);
 		vkDestroyImage(devices->device, attachment.image, nullptr);
 		vkDestroyImageView(devices->device, attachment.imageView, nullptr);
 	}
@@ -23,6 +23,7 @@ void Framebuffer::cleanup() {
 
 /*
 * create image & image view, and fill attachment description based on the input info
+* attachments are recreated with the framebuffer extent, so they live in resolution dependent pools
 * 
 * @param imageCreateInfo - info needed to create VkImage
 * @param memoryProperties - needed for allocateImageMemory()
@@ -41,7 +42,8 @@ void Framebuffer::addAttachment(VkImageCreateInfo imageCreateInfo,
 		imageCreateInfo.usage,
 		1,
 		memoryProperties,
-		imageCreateInfo.samples);
+		imageCreateInfo.samples,
+		MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT);
 
 	//check image aspect
 	VkImageAspectFlags imageAspect = 0;
@@ -3,70 +3,113 @@
 https://github.com/SaschaWillems/Vulkan/blob/master/examples/gltfscenerendering/gltfscenerendering.cpp
 https://github.com/nvpro-samples/nvpro_core/blob/master/nvh/gltfscene.cpp
 */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <limits>
+#include <stb_image.h>
+#include <json.hpp>
 #include "vulkan_gltf.h"
 #include "glm/gtc/type_ptr.hpp"
+#include "vulkan_thread_pool.h"
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /*
-* upload vertex / index data to device memory
+* tinygltf image loader callback - keeps the encoded bytes (file / data uri / bufferView) in image->image
+* so that each image is decoded only once, by VulkanGLTF::loadImages
 */
-void uploadBufferToDeviceMemory(VulkanDevice* devices, VkBuffer& buffer, const void* data,
-	VkDeviceSize bufferSize, VkBufferUsageFlags usage) {
-	//staging buffers
-	VkBuffer stagingBuffer;
-	MemoryAllocator::HostVisibleMemory stagingMemory = devices->createBuffer(stagingBuffer, bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-	);
-	stagingMemory.mapData(devices->device, data);
-
-	//create buffer
-	devices->createBuffer(buffer, bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-	);
-
-	//copy buffer
-	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
-	VkBufferCopy bufferCopyRegion{};
-	bufferCopyRegion.srcOffset = 0;
-	bufferCopyRegion.dstOffset = 0;
-	bufferCopyRegion.size = bufferSize;
-	vkCmdCopyBuffer(cmdBuf, stagingBuffer, buffer, 1, &bufferCopyRegion);
-	devices->endCommandBuffer(cmdBuf);
-
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
+static bool storeEncodedImage(tinygltf::Image* image, const int /*imageIndex*/, std::string* /*err*/,
+	std::string* /*warn*/, int /*reqWidth*/, int /*reqHeight*/, const unsigned char* bytes, int size, void* /*userData*/) {
+	image->image.assign(bytes, bytes + size);
+	image->as_is = true;
+	return true;
+}
+
+/*
+* sections of the scene cache (<model path>.vkcache)
+*/
+enum SceneCacheSection : uint32_t {
+	SCENE_CACHE_INDICES,
+	SCENE_CACHE_POSITIONS,
+	SCENE_CACHE_NORMALS,
+	SCENE_CACHE_TEXCOORD0S,
+	SCENE_CACHE_COLORS,
+	SCENE_CACHE_TANGENTS,
+	SCENE_CACHE_MATERIAL_INDICES,
+	SCENE_CACHE_PRIMITIVES,
+	SCENE_CACHE_PRIMITIVE_BOUNDS,
+	SCENE_CACHE_NODES
+};
+/** version of the geometry processing - bump when loadGeometry() output changes to invalidate every cache */
+static const uint32_t SCENE_CACHE_VERSION = 2;
+
+/*
+* content key of a file which isn't hashed - size & last write time
+*
+* @param path - path to the file
+* @param seed - key of the previous files
+*
+* @return uint64_t - combined key
+*/
+static uint64_t hashFileStamp(const std::string& path, uint64_t seed) {
+	std::error_code error;
+	uint64_t stamp[2] = { static_cast<uint64_t>(std::filesystem::file_size(path, error)), 0 };
+	stamp[1] = static_cast<uint64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	return vktools::hashBytes(stamp, sizeof(stamp), seed);
+}
+
+/*
+* decode percent-encoded characters of a relative uri
+*
+* @param uri - uri of an external file
+*
+* @return std::string - file path relative to the model
+*/
+static std::string decodeUri(const std::string& uri) {
+	auto hexValue = [](char c) {
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	};
+	std::string decoded;
+	decoded.reserve(uri.size());
+	for (size_t i = 0; i < uri.size(); ++i) {
+		if (uri[i] == '%' && i + 2 < uri.size() && hexValue(uri[i + 1]) >= 0 && hexValue(uri[i + 2]) >= 0) {
+			decoded.push_back(static_cast<char>(hexValue(uri[i + 1]) * 16 + hexValue(uri[i + 2])));
+			i += 2;
+		}
+		else {
+			decoded.push_back(uri[i]);
+		}
+	}
+	return decoded;
 }
 
 /*
 * load gltf scene and assign resources 
+* every buffer & texture upload is recorded to a single upload batch
 */
 void VulkanGLTF::loadScene(VulkanDevice* devices, const std::string& path, VkBufferUsageFlags usage) {
 	//init
 	this->devices = devices;
-
-	tinygltf::Model model;
-	tinygltf::TinyGLTF loader;
-	std::string err, warn;
-
-	//load gltf file
-	bool result = loader.LoadASCIIFromFile(&model, &err, &warn, path);
-	std::string str = "Mesh::loadGltf(): ";
-	if (!warn.empty()) {
-		throw std::runtime_error(str + warn);
-	}
-	if (!err.empty()) {
-		throw std::runtime_error(str + err);
-	}
-	if (!result) {
-		throw std::runtime_error("failed to parse glTF\n");
-	}
+	auto startTime = std::chrono::high_resolution_clock::now();
 
 	//extract path to the model
 	this->path = path.substr(0, path.find_last_of('/') + 1);
-	
-	loadImages(model);
+
+	//load gltf / glb file - images are decoded later in loadImages(), vertices are read from the mapped buffers
+	tinygltf::Model model;
+	parseModel(model, path);
+
+	UploadBatch batch;
+	batch.begin(devices);
+	loadImages(model, batch);
 	loadMaterials(model);
 	loadTextures(model);
 
@@ -81,40 +124,42 @@ void VulkanGLTF::loadScene(VulkanDevice* devices, const std::string& path, VkBuf
 		meshToPrimitives[meshCount++] = std::move(primitiveIndices);
 	}
 
-	//get all primitives
-	for (const tinygltf::Mesh& mesh : model.meshes) {
-		for (const tinygltf::Primitive& primitive : mesh.primitives) {
-			addPrimitive(primitive, model);
+	//geometry - mapped from the scene cache if it matches the source, processed from the accessors otherwise
+	const std::string cachePath = path + ".vkcache";
+	const uint64_t cacheKey = vktools::hashBytes(&SCENE_CACHE_VERSION, sizeof(SCENE_CACHE_VERSION), sourceKey);
+	if (useSceneCache && readSceneCache(cachePath, cacheKey, primitiveCount)) {
+		LOG("scene cache:\t" + cachePath);
+	}
+	else {
+		loadGeometry(model, primitiveCount);
+		if (useSceneCache && !writeSceneCache(cachePath, cacheKey)) {
+			LOG("scene cache:\tfailed to write " + cachePath);
 		}
 	}
 
-	//convert the scene hierarchy to a flat list
-	const tinygltf::Scene& scene = model.scenes[0];
-	for (int nodeIndex : scene.nodes) {
-		loadNode(model, nodeIndex, glm::mat4(1.f));
-	}
-	
-	//create vertex & index buffer
-	size_t indexBufferSize			= bufferData.indices.size() * sizeof(uint32_t);
-	size_t positionBufferSize		= bufferData.positions.size() * sizeof(glm::vec3);
-	size_t normalBufferSize			= bufferData.normals.size() * sizeof(glm::vec3);
-	size_t uvBufferSize				= bufferData.texCoord0s.size() * sizeof(glm::vec2);
-	size_t colorBufferSize			= bufferData.colors.size() * sizeof(glm::vec3);
-	size_t tangentBufferSize		= bufferData.tangents.size() * sizeof(glm::vec4);
-	size_t materialIndicesSize		= bufferData.materialIndices.size() * sizeof(int32_t);
-	uploadBufferToDeviceMemory(devices, indexBuffer, bufferData.indices.data(), indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | usage);
-	uploadBufferToDeviceMemory(devices, vertexBuffer, bufferData.positions.data(), positionBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
-	uploadBufferToDeviceMemory(devices, normalBuffer, bufferData.normals.data(), normalBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
-	uploadBufferToDeviceMemory(devices, uvBuffer, bufferData.texCoord0s.data(), uvBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
-	uploadBufferToDeviceMemory(devices, colorBuffer, bufferData.colors.data(), colorBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
-	uploadBufferToDeviceMemory(devices, tangentBuffer, bufferData.tangents.data(), tangentBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
-	uploadBufferToDeviceMemory(devices, materialIndicesBuffer, bufferData.materialIndices.data(), materialIndicesSize,
+	//create vertex & index buffer - from the cache mapping or bufferData
+	auto uploadArray = [&](VkBuffer& buffer, uint32_t section, const auto& array, VkBufferUsageFlags bufferUsage) {
+		using Element = typename std::decay_t<decltype(array)>::value_type;
+		const void* data = array.data();
+		uint64_t count = array.size();
+		if (sceneCache.isOpen()) {
+			data = sceneCache.getSection(section, sizeof(Element), count);
+		}
+		uploadBuffer(batch, buffer, data, count * sizeof(Element), bufferUsage);
+	};
+	uploadArray(indexBuffer, SCENE_CACHE_INDICES, bufferData.indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | usage);
+	uploadArray(vertexBuffer, SCENE_CACHE_POSITIONS, bufferData.positions, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
+	uploadArray(normalBuffer, SCENE_CACHE_NORMALS, bufferData.normals, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
+	uploadArray(uvBuffer, SCENE_CACHE_TEXCOORD0S, bufferData.texCoord0s, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
+	uploadArray(colorBuffer, SCENE_CACHE_COLORS, bufferData.colors, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
+	uploadArray(tangentBuffer, SCENE_CACHE_TANGENTS, bufferData.tangents, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | usage);
+	uploadArray(materialIndicesBuffer, SCENE_CACHE_MATERIAL_INDICES, bufferData.materialIndices,
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
 		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 	
 	//create primitive buffer
 	size_t primitiveBufferSize = primitives.size() * sizeof(Primitive);
-	uploadBufferToDeviceMemory(devices, primitiveBuffer, primitives.data(), primitiveBufferSize,
+	uploadBuffer(batch, primitiveBuffer, primitives.data(), primitiveBufferSize,
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
 		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 
@@ -124,22 +169,407 @@ void VulkanGLTF::loadScene(VulkanDevice* devices, const std::string& path, VkBuf
 		ShadeMaterial shadeMaterial{};
 		shadeMaterial.baseColorFactor = material.baseColorFactor;
 		shadeMaterial.emissiveFactor = material.emissiveFactor;
-		shadeMaterial.baseColorTextureIndex = material.baseColorTextureIndex;
+		//index in the image descriptor array - shared by textures of identical images
+		int32_t textureIndex = material.baseColorTextureIndex;
+		shadeMaterial.baseColorTextureIndex = (textureIndex >= 0 && textureIndex < static_cast<int32_t>(textures.size()) &&
+			textures[textureIndex] < images.size()) ? static_cast<int32_t>(textures[textureIndex]) : -1;
 		shadeMaterialsData.push_back(shadeMaterial);
 	}
 	size_t shadeMaterialsSize = shadeMaterialsData.size() * sizeof(ShadeMaterial);
-	uploadBufferToDeviceMemory(devices, materialBuffer, shadeMaterialsData.data(), shadeMaterialsSize,
+	uploadBuffer(batch, materialBuffer, shadeMaterialsData.data(), shadeMaterialsSize,
 		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
 		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
 
+	//single wait for every upload of the scene
+	batch.end();
+
+	//streamed images are replaced by textureStreamer & may still be acquired from the async upload queue
+	if (!streamTextures) {
+		for (Texture2D& image : images) {
+			if (image.image != VK_NULL_HANDLE) {
+				image.registerMovable([this]() { resourceVersion++; });
+			}
+		}
+	}
+
+	float loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	LOG("loaded:\t" + path + " (" + std::to_string(loadTime) + " ms, " + std::to_string(batch.submitCount) + " submits)");
+
 	//free all temporary data
-	bufferData.colors.clear();
-	bufferData.indices.clear();
-	bufferData.materialIndices.clear();
-	bufferData.normals.clear();
-	bufferData.positions.clear();
-	bufferData.tangents.clear();
-	bufferData.texCoord0s.clear();
+	bufferSpans.clear();
+	mappedFiles.clear();
+	sceneCache.close();
+	bufferData = BufferData();
+}
+
+/*
+* upload a read-only buffer of the scene & allow the defragmenter to move it
+* the moved buffer is written back to the member & resourceVersion is incremented (descriptors, device addresses)
+*
+* @param batch - upload batch of loadScene
+* @param buffer - member buffer handle of the scene
+* @param data - buffer content
+* @param size - buffer size
+* @param usage - buffer usage, TRANSFER_SRC is added for the defragmenter
+*/
+void VulkanGLTF::uploadBuffer(UploadBatch& batch, VkBuffer& buffer, const void* data, VkDeviceSize size,
+	VkBufferUsageFlags usage) {
+	usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	batch.uploadBuffer(buffer, data, size, usage);
+	devices->memoryAllocator.registerMovableBuffer(buffer,
+		vktools::initializers::bufferCreateInfo(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage),
+		[this, &buffer](VkBuffer newBuffer) {
+			buffer = newBuffer;
+			resourceVersion++;
+		});
+}
+
+/*
+* process vertices / indices of every primitive on importThreadCount threads & flatten the node hierarchy
+*
+* @param model - parsed model
+* @param primitiveCount - number of primitives of every mesh
+*/
+void VulkanGLTF::loadGeometry(const tinygltf::Model& model, uint32_t primitiveCount) {
+	/*
+	* serial pass - index / vertex ranges of every primitive by prefix sum in model order
+	*/
+	std::vector<const tinygltf::Primitive*> inputPrimitives;
+	inputPrimitives.reserve(primitiveCount);
+	primitives.reserve(primitiveCount);
+	size_t vertexTotal = 0;
+	size_t indexTotal = 0;
+	for (const tinygltf::Mesh& mesh : model.meshes) {
+		for (const tinygltf::Primitive& inputPrimitive : mesh.primitives) {
+			auto posIt = inputPrimitive.attributes.find("POSITION");
+			size_t vertexCount = posIt != inputPrimitive.attributes.end() ? model.accessors[posIt->second].count : 0;
+			size_t indexCount = vertexCount;
+			if (inputPrimitive.indices >= 0) {
+				const tinygltf::Accessor& accessor = model.accessors[inputPrimitive.indices];
+				if (accessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT &&
+					accessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT &&
+					accessor.componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE) {
+					throw std::runtime_error("VulkanGLTF::loadGeometry(): index component type" +
+						std::to_string(accessor.componentType) + " not supported");
+				}
+				indexCount = accessor.count;
+			}
+
+			Primitive primitive{};
+			primitive.firstIndex = static_cast<uint32_t>(indexTotal);
+			primitive.indexCount = static_cast<uint32_t>(indexCount);
+			primitive.vertexOffset = static_cast<uint32_t>(vertexTotal);
+			primitive.vertexCount = static_cast<uint32_t>(vertexCount);
+			primitive.materialIndex = inputPrimitive.material;
+			primitives.push_back(primitive);
+			inputPrimitives.push_back(&inputPrimitive);
+			vertexTotal += vertexCount;
+			indexTotal += indexCount;
+		}
+	}
+
+	//size every array once - missing attributes keep their default value
+	bufferData.positions.resize(vertexTotal);
+	bufferData.normals.resize(vertexTotal, glm::vec3(0.f));
+	bufferData.texCoord0s.resize(vertexTotal, glm::vec2(0.f));
+	bufferData.colors.resize(vertexTotal, glm::vec3(1.f));
+	bufferData.tangents.resize(vertexTotal, glm::vec4(0.f));
+	bufferData.indices.resize(indexTotal);
+	bufferData.materialIndices.resize(primitives.size());
+	primitiveBounds.resize(primitives.size());
+
+	/*
+	* parallel pass - each primitive writes only into its own ranges
+	*/
+	const uint32_t threadCount = std::min(importThreadCount > 0 ? importThreadCount : std::thread::hardware_concurrency(),
+		static_cast<uint32_t>(primitives.size()));
+	if (threadCount <= 1) {
+		for (uint32_t i = 0; i < static_cast<uint32_t>(primitives.size()); ++i) {
+			addPrimitive(*inputPrimitives[i], model, i);
+		}
+	}
+	else {
+		//first error in model order is rethrown once every task is finished
+		std::vector<std::exception_ptr> errors(primitives.size());
+		ThreadPool threadPool;
+		threadPool.init(threadCount);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(primitives.size()); ++i) {
+			threadPool.submit([&, i]() {
+				try {
+					addPrimitive(*inputPrimitives[i], model, i);
+				}
+				catch (...) {
+					errors[i] = std::current_exception();
+				}
+			});
+		}
+		threadPool.wait();
+		for (const std::exception_ptr& error : errors) {
+			if (error) {
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+	//convert the scene hierarchy to a flat list
+	const tinygltf::Scene& scene = model.scenes[0];
+	for (int nodeIndex : scene.nodes) {
+		loadNode(model, nodeIndex, glm::mat4(1.f));
+	}
+}
+
+/*
+* parse a .gltf / .glb file without copying its binary buffers to the heap
+* the file itself, the glb binary chunk & external .bin files are memory mapped -
+* tinygltf only parses the json, in which every mapped buffer is replaced by a 1 byte data uri,
+* images stored in mapped buffers are replaced by placeholder data uris & read from the mapping afterwards
+* data uri buffers are still decoded by tinygltf (their bytes are referenced from the model)
+*
+* @param model - model to parse into
+* @param path - path to the .gltf / .glb file
+*/
+void VulkanGLTF::parseModel(tinygltf::Model& model, const std::string& path) {
+	const std::string str = "VulkanGLTF::parseModel(): ";
+	bufferSpans.clear();
+	mappedFiles.clear();
+
+	MappedFile sceneFile;
+	sceneFile.open(path);
+	auto readUint32 = [&sceneFile](size_t offset) {
+		uint32_t value;
+		memcpy(&value, sceneFile.data() + offset, sizeof(value));
+		return value;
+	};
+
+	//glb: 12 byte header followed by 4 byte aligned chunks - json first, then an optional binary chunk
+	const uint32_t GLB_MAGIC = 0x46546C67; //"glTF"
+	const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+	const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+	const unsigned char* json = sceneFile.data();
+	size_t jsonSize = sceneFile.size();
+	BufferSpan binChunk{};
+	if (sceneFile.size() >= 12 && readUint32(0) == GLB_MAGIC) {
+		if (readUint32(4) != 2) {
+			throw std::runtime_error(str + "unsupported glb version " + std::to_string(readUint32(4)) + " - " + path);
+		}
+		const size_t glbSize = std::min<size_t>(readUint32(8), sceneFile.size());
+		json = nullptr;
+		for (size_t offset = 12; offset + 8 <= glbSize;) {
+			const uint32_t chunkSize = readUint32(offset);
+			const uint32_t chunkType = readUint32(offset + 4);
+			offset += 8;
+			if (chunkSize > glbSize - offset) {
+				throw std::runtime_error(str + "truncated glb chunk - " + path);
+			}
+			if (offset == 20 && chunkType == GLB_CHUNK_JSON) {
+				json = sceneFile.data() + offset;
+				jsonSize = chunkSize;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && binChunk.data == nullptr) {
+				binChunk = { sceneFile.data() + offset, chunkSize };
+			}
+			offset += (static_cast<size_t>(chunkSize) + 3) & ~static_cast<size_t>(3);
+		}
+		if (json == nullptr) {
+			throw std::runtime_error(str + "first glb chunk isn't json - " + path);
+		}
+	}
+
+	//key of the scene cache - content of the json, size & write time of the binary files
+	sourceKey = hashFileStamp(path, vktools::hashBytes(json, jsonSize));
+
+	nlohmann::json document;
+	try {
+		document = nlohmann::json::parse(json, json + jsonSize);
+	}
+	catch (const nlohmann::json::exception& error) {
+		throw std::runtime_error(str + "invalid json - " + path + ": " + error.what());
+	}
+
+	//replace buffers which can be mapped
+	const std::string bufferPlaceholder = "data:application/octet-stream;base64,AA==";
+	std::vector<bool> mappedBuffers;
+	std::vector<std::string> bufferUris;
+	if (document.count("buffers") != 0 && document["buffers"].is_array()) {
+		nlohmann::json& buffers = document["buffers"];
+		bufferSpans.resize(buffers.size());
+		mappedBuffers.resize(buffers.size(), false);
+		bufferUris.resize(buffers.size());
+		for (size_t i = 0; i < buffers.size(); ++i) {
+			nlohmann::json& buffer = buffers[i];
+			if (!buffer.is_object()) {
+				continue;
+			}
+			const size_t byteLength = buffer.value("byteLength", size_t(0));
+			const std::string uri = buffer.value("uri", std::string());
+			if (uri.empty()) {
+				//glb binary chunk
+				if (binChunk.data == nullptr || byteLength > binChunk.size) {
+					throw std::runtime_error(str + "buffer[" + std::to_string(i) + "] exceeds the glb binary chunk - " + path);
+				}
+				bufferSpans[i] = { binChunk.data, byteLength };
+			}
+			else if (tinygltf::IsDataURI(uri)) {
+				continue;
+			}
+			else {
+				MappedFile binFile;
+				binFile.open(this->path + decodeUri(uri));
+				if (binFile.size() < byteLength) {
+					throw std::runtime_error(str + "buffer[" + std::to_string(i) + "] exceeds " + uri);
+				}
+				bufferSpans[i] = { binFile.data(), byteLength };
+				mappedFiles.push_back(std::move(binFile));
+				sourceKey = hashFileStamp(this->path + decodeUri(uri), sourceKey);
+			}
+			mappedBuffers[i] = true;
+			bufferUris[i] = uri;
+			buffer["uri"] = bufferPlaceholder;
+			buffer["byteLength"] = 1;
+		}
+	}
+
+	//images in mapped buffers - tinygltf would read them from the placeholders
+	struct MappedImage {
+		size_t imageIndex;
+		int bufferView;
+		std::string mimeType;
+	};
+	std::vector<MappedImage> mappedImages;
+	if (document.count("images") != 0 && document["images"].is_array() && document.count("bufferViews") != 0) {
+		const nlohmann::json& bufferViews = document["bufferViews"];
+		nlohmann::json& images = document["images"];
+		for (size_t i = 0; i < images.size(); ++i) {
+			nlohmann::json& image = images[i];
+			if (!image.is_object() || image.count("bufferView") == 0 || !image["bufferView"].is_number_integer()) {
+				continue;
+			}
+			const int bufferView = image["bufferView"].get<int>();
+			if (bufferView < 0 || static_cast<size_t>(bufferView) >= bufferViews.size() ||
+				!bufferViews[bufferView].is_object()) {
+				continue;
+			}
+			const int buffer = bufferViews[bufferView].value("buffer", -1);
+			if (buffer < 0 || static_cast<size_t>(buffer) >= mappedBuffers.size() || !mappedBuffers[buffer]) {
+				continue;
+			}
+			mappedImages.push_back({ i, bufferView, image.value("mimeType", std::string()) });
+			image.erase("bufferView");
+			image["uri"] = "data:image/png;base64,AA==";
+		}
+	}
+
+	//every mapped byte of the json is copied to the document - the json chunk isn't needed anymore
+	const std::string text = document.dump();
+	document = nlohmann::json();
+
+	tinygltf::TinyGLTF loader;
+	std::string err, warn;
+	loader.SetImageLoader(storeEncodedImage, nullptr);
+	bool result = loader.LoadASCIIFromString(&model, &err, &warn, text.c_str(),
+		static_cast<unsigned int>(text.size()), this->path);
+	if (!warn.empty()) {
+		throw std::runtime_error(str + warn);
+	}
+	if (!err.empty()) {
+		throw std::runtime_error(str + err);
+	}
+	if (!result) {
+		throw std::runtime_error(str + "failed to parse glTF - " + path);
+	}
+
+	//restore mapped buffers & point the spans of data uri buffers to the decoded bytes
+	for (size_t i = 0; i < model.buffers.size() && i < bufferSpans.size(); ++i) {
+		tinygltf::Buffer& buffer = model.buffers[i];
+		if (mappedBuffers[i]) {
+			buffer.data.clear();
+			buffer.uri = bufferUris[i];
+		}
+		else {
+			bufferSpans[i] = { buffer.data.data(), buffer.data.size() };
+		}
+	}
+	for (const MappedImage& mappedImage : mappedImages) {
+		tinygltf::Image& image = model.images[mappedImage.imageIndex];
+		const tinygltf::BufferView& view = model.bufferViews[mappedImage.bufferView];
+		const BufferSpan& span = bufferSpans[view.buffer];
+		if (view.byteOffset + view.byteLength > span.size) {
+			throw std::runtime_error(str + "image[" + std::to_string(mappedImage.imageIndex) + "] exceeds its buffer - " + path);
+		}
+		storeEncodedImage(&image, static_cast<int>(mappedImage.imageIndex), &err, &warn, 0, 0,
+			span.data + view.byteOffset, static_cast<int>(view.byteLength), nullptr);
+		image.uri.clear();
+		image.mimeType = mappedImage.mimeType;
+		image.bufferView = mappedImage.bufferView;
+	}
+
+	//the binary chunk of a glb is read from the mapping of the scene file
+	if (binChunk.data != nullptr) {
+		mappedFiles.push_back(std::move(sceneFile));
+	}
+}
+
+/*
+* read processed geometry from the scene cache
+* the cache stays mapped until the scene is uploaded - vertex & index sections are uploaded from the mapping
+*
+* @param cachePath - path to the cache file
+* @param key - content key of the source & processing version
+* @param primitiveCount - number of primitives of the model (consistency check)
+*
+* @return bool - false if the cache is missing or doesn't match (nothing is loaded)
+*/
+bool VulkanGLTF::readSceneCache(const std::string& cachePath, uint64_t key, uint32_t primitiveCount) {
+	if (!sceneCache.open(cachePath, key)) {
+		return false;
+	}
+
+	//every vertex attribute has one element per position
+	uint64_t vertexCount = 0, count = 0;
+	bool valid = sceneCache.getSection(SCENE_CACHE_INDICES, sizeof(uint32_t), count) != nullptr &&
+		sceneCache.getSection(SCENE_CACHE_POSITIONS, sizeof(glm::vec3), vertexCount) != nullptr &&
+		sceneCache.getSection(SCENE_CACHE_NORMALS, sizeof(glm::vec3), count) != nullptr && count == vertexCount &&
+		sceneCache.getSection(SCENE_CACHE_TEXCOORD0S, sizeof(glm::vec2), count) != nullptr && count == vertexCount &&
+		sceneCache.getSection(SCENE_CACHE_COLORS, sizeof(glm::vec3), count) != nullptr && count == vertexCount &&
+		sceneCache.getSection(SCENE_CACHE_TANGENTS, sizeof(glm::vec4), count) != nullptr && count == vertexCount &&
+		sceneCache.getSection(SCENE_CACHE_MATERIAL_INDICES, sizeof(int32_t), count) != nullptr && count == primitiveCount &&
+		sceneCache.readSection(SCENE_CACHE_PRIMITIVES, primitives) && primitives.size() == primitiveCount &&
+		sceneCache.readSection(SCENE_CACHE_PRIMITIVE_BOUNDS, primitiveBounds) && primitiveBounds.size() == primitiveCount &&
+		sceneCache.readSection(SCENE_CACHE_NODES, nodes);
+	if (!valid) {
+		sceneCache.close();
+		primitives.clear();
+		primitiveBounds.clear();
+		nodes.clear();
+	}
+	return valid;
+}
+
+/*
+* write the processed geometry of loadGeometry() to the scene cache
+*
+* @param cachePath - path to the cache file
+* @param key - content key of the source & processing version
+*
+* @return bool - false if the cache couldn't be written
+*/
+bool VulkanGLTF::writeSceneCache(const std::string& cachePath, uint64_t key) const {
+	auto section = [](uint32_t id, const auto& array) {
+		using Element = typename std::decay_t<decltype(array)>::value_type;
+		return SceneCache::Section{ id, sizeof(Element), array.data(), array.size() };
+	};
+	return SceneCache::write(cachePath, key, {
+		section(SCENE_CACHE_INDICES, bufferData.indices),
+		section(SCENE_CACHE_POSITIONS, bufferData.positions),
+		section(SCENE_CACHE_NORMALS, bufferData.normals),
+		section(SCENE_CACHE_TEXCOORD0S, bufferData.texCoord0s),
+		section(SCENE_CACHE_COLORS, bufferData.colors),
+		section(SCENE_CACHE_TANGENTS, bufferData.tangents),
+		section(SCENE_CACHE_MATERIAL_INDICES, bufferData.materialIndices),
+		section(SCENE_CACHE_PRIMITIVES, primitives),
+		section(SCENE_CACHE_PRIMITIVE_BOUNDS, primitiveBounds),
+		section(SCENE_CACHE_NODES, nodes)
+	});
 }
 
 /*
@@ -151,6 +581,7 @@ void VulkanGLTF::cleanup() {
 	}
 
 	//images
+	textureStreamer.cleanup();
 	for (Texture2D& image : images) {
 		image.cleanup();
 	}
@@ -161,45 +592,319 @@ void VulkanGLTF::cleanup() {
 	}
 
 	//buffers
-	devices->memoryAllocator.freeBufferMemory(vertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(vertexBuffer);
 	vkDestroyBuffer(devices->device, vertexBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(indexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(indexBuffer);
 	vkDestroyBuffer(devices->device, indexBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(normalBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(normalBuffer);
 	vkDestroyBuffer(devices->device, normalBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(uvBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(uvBuffer);
 	vkDestroyBuffer(devices->device, uvBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(colorBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(colorBuffer);
 	vkDestroyBuffer(devices->device, colorBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(tangentBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(tangentBuffer);
 	vkDestroyBuffer(devices->device, tangentBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(materialIndicesBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(materialIndicesBuffer);
 	vkDestroyBuffer(devices->device, materialIndicesBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(materialBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(materialBuffer);
 	vkDestroyBuffer(devices->device, materialBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(primitiveBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(primitiveBuffer);
 	vkDestroyBuffer(devices->device, primitiveBuffer, nullptr);
 }
 
 /*
 * load images from the model 
+* images are decoded by a thread pool & uploaded in completion order on this thread
+* encoded bytes come from the image loader callback (uri, data uri or bufferView)
+* KTX2 / DDS images keep their stored format & mip levels, other images are BC encoded if compressTextures is set
 * 
 * @param input - loaded gltf model
+* @param batch - upload batch recording the image uploads
 */
-void VulkanGLTF::loadImages(tinygltf::Model& input) {
+void VulkanGLTF::loadImages(tinygltf::Model& input, UploadBatch& batch) {
 	if (input.images.empty()) {
 		//add dummy texture
 		images.resize(1);
 		unsigned char pixel = 255;
-		images[0].load(devices, &pixel, 1, 1, 1, VK_FORMAT_R8_SRGB);
+		images[0].load(devices, &pixel, 1, 1, 1, VK_FORMAT_R8_SRGB, VK_FILTER_LINEAR,
+			VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, &batch);
 		return;
 	}
 
-	images.resize(input.images.size());
-	for (int i = 0; i < input.images.size(); ++i) {
-		tinygltf::Image& srcImage = input.images[i];
-		images[i].load(devices, path + srcImage.uri, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+	/*
+	* content deduplication - glTF images with identical bytes share one texture
+	* matching hashes are confirmed by comparing the bytes
+	*/
+	imageIndices.resize(input.images.size());
+	std::vector<size_t> uniqueSources;
+	std::unordered_multimap<uint64_t, uint32_t> imageHashes;
+	for (size_t i = 0; i < input.images.size(); ++i) {
+		const tinygltf::Image& srcImage = input.images[i];
+		const int layout[5] = { srcImage.width, srcImage.height, srcImage.component, srcImage.bits, srcImage.as_is };
+		uint64_t hash = vktools::hashBytes(srcImage.image.data(), srcImage.image.size(),
+			vktools::hashBytes(layout, sizeof(layout)));
+
+		uint32_t imageIndex = static_cast<uint32_t>(uniqueSources.size());
+		auto range = imageHashes.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			const tinygltf::Image& uniqueImage = input.images[uniqueSources[it->second]];
+			if (uniqueImage.width == srcImage.width && uniqueImage.height == srcImage.height &&
+				uniqueImage.component == srcImage.component && uniqueImage.bits == srcImage.bits &&
+				uniqueImage.as_is == srcImage.as_is && uniqueImage.image == srcImage.image) {
+				imageIndex = it->second;
+				break;
+			}
+		}
+		if (imageIndex == uniqueSources.size()) {
+			imageHashes.emplace(hash, imageIndex);
+			uniqueSources.push_back(i);
+		}
+		imageIndices[i] = imageIndex;
+	}
+
+	images.resize(uniqueSources.size());
+	if (streamTextures) {
+		textureStreamer.init(devices);
+		imageStreamIndices.resize(uniqueSources.size());
+	}
+
+	/*
+	* sampling role of each image - BC format of the encoder
+	* images without a role (metallic roughness) or with conflicting roles stay rgba8
+	*/
+	const int NO_ROLE = -1, CONFLICTING_ROLES = -2;
+	std::vector<int> imageRoles(uniqueSources.size(), NO_ROLE);
+	auto assignRole = [&](int textureIndex, TextureRole role) {
+		if (textureIndex < 0 || textureIndex >= static_cast<int>(input.textures.size())) {
+			return;
+		}
+		int source = input.textures[textureIndex].source;
+		if (source < 0 || source >= static_cast<int>(imageIndices.size())) {
+			return;
+		}
+		int& imageRole = imageRoles[imageIndices[source]];
+		imageRole = (imageRole == NO_ROLE || imageRole == static_cast<int>(role)) ? static_cast<int>(role) : CONFLICTING_ROLES;
+	};
+	for (const tinygltf::Material& material : input.materials) {
+		assignRole(material.pbrMetallicRoughness.baseColorTexture.index, TextureRole::COLOR);
+		assignRole(material.emissiveTexture.index, TextureRole::COLOR);
+		assignRole(material.normalTexture.index, TextureRole::NORMAL);
+		assignRole(material.occlusionTexture.index, TextureRole::MASK);
+		//linear data in green & blue - no matching role
+		assignRole(material.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureRole::COLOR);
+		assignRole(material.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureRole::MASK);
+	}
+	const bool encodeImages = compressTextures && devices->textureCompressionBCSupported;
+
+	/*
+	* decode - workers wait for a free slot so that at most maxInFlightDecodedImages images are held in memory
+	*/
+	struct DecodedImage {
+		size_t index = 0;
+		stbi_uc* pixels = nullptr;
+		int width = 0;
+		int height = 0;
+		/** false if pixels were already decoded by tinygltf */
+		bool ownsPixels = true;
+		/** KTX2 / DDS or encoded image - uploaded instead of pixels */
+		CompressedImage compressedImage;
+	};
+	std::mutex mutex;
+	std::condition_variable slotReleased, imageDecoded;
+	std::deque<DecodedImage> decodedImages;
+	uint32_t inFlightImageCount = 0;
+	const uint32_t maxInFlightImageCount = std::max(maxInFlightDecodedImages, 1u);
+	bool cancelled = false;
+
+	ThreadPool threadPool;
+	threadPool.init(std::min(decodeThreadCount > 0 ? decodeThreadCount : std::thread::hardware_concurrency(),
+		static_cast<uint32_t>(uniqueSources.size())));
+	for (size_t i = 0; i < uniqueSources.size(); ++i) {
+		tinygltf::Image* srcImage = &input.images[uniqueSources[i]];
+		threadPool.submit([&, i, srcImage]() {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				slotReleased.wait(lock, [&]() { return cancelled || inFlightImageCount < maxInFlightImageCount; });
+				if (cancelled) {
+					return;
+				}
+				inFlightImageCount++;
+			}
+
+			DecodedImage decodedImage{};
+			decodedImage.index = i;
+			int role = imageRoles[i];
+			if (srcImage->as_is && vktools::compression::isContainer(srcImage->image.data(), srcImage->image.size())) {
+				//normal & mask containers without color space info are linear
+				try {
+					decodedImage.compressedImage = vktools::compression::loadContainer(srcImage->image.data(),
+						srcImage->image.size(), role != static_cast<int>(TextureRole::NORMAL) &&
+						role != static_cast<int>(TextureRole::MASK));
+				}
+				catch (const std::runtime_error&) {
+					//reported as a failed image
+				}
+				std::vector<unsigned char>().swap(srcImage->image);
+			}
+			else if (srcImage->as_is) {
+				int channels = 0;
+				decodedImage.pixels = stbi_load_from_memory(srcImage->image.data(),
+					static_cast<int>(srcImage->image.size()), &decodedImage.width, &decodedImage.height,
+					&channels, STBI_rgb_alpha);
+				//encoded bytes aren't needed anymore
+				std::vector<unsigned char>().swap(srcImage->image);
+			}
+			else if (srcImage->component == 4 && srcImage->bits == 8) {
+				//loaded with the default tinygltf image loader
+				decodedImage.pixels = srcImage->image.data();
+				decodedImage.width = srcImage->width;
+				decodedImage.height = srcImage->height;
+				decodedImage.ownsPixels = false;
+			}
+
+			//block compression on the worker
+			if (encodeImages && decodedImage.pixels != nullptr && role >= 0) {
+				decodedImage.compressedImage = vktools::compression::encode(decodedImage.pixels,
+					decodedImage.width, decodedImage.height, static_cast<TextureRole>(role));
+				if (decodedImage.ownsPixels) {
+					stbi_image_free(decodedImage.pixels);
+				}
+				decodedImage.pixels = nullptr;
+			}
+			//whole rgba8 mip chain is kept on the cpu for streaming
+			else if (streamTextures && decodedImage.pixels != nullptr) {
+				decodedImage.compressedImage = vktools::compression::buildMipChain(decodedImage.pixels,
+					decodedImage.width, decodedImage.height, true);
+				if (decodedImage.ownsPixels) {
+					stbi_image_free(decodedImage.pixels);
+				}
+				decodedImage.pixels = nullptr;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				decodedImages.push_back(std::move(decodedImage));
+			}
+			imageDecoded.notify_one();
+		});
+	}
+
+	/*
+	* upload in completion order - same format & sampler as Texture2D::load(path)
+	*/
+	std::string failedPath;
+	//image being uploaded - outside of the try block to free its pixels if the upload throws
+	DecodedImage decodedImage{};
+	try {
+		for (size_t uploadedCount = 0; uploadedCount < uniqueSources.size(); ++uploadedCount) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				imageDecoded.wait(lock, [&]() { return !decodedImages.empty(); });
+				decodedImage = std::move(decodedImages.front());
+				decodedImages.pop_front();
+			}
+
+			if (!decodedImage.compressedImage.levels.empty() && streamTextures) {
+				imageStreamIndices[decodedImage.index] = textureStreamer.addTexture(&images[decodedImage.index],
+					std::move(decodedImage.compressedImage), VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, batch);
+			}
+			else if (!decodedImage.compressedImage.levels.empty()) {
+				images[decodedImage.index].load(devices, decodedImage.compressedImage, VK_FILTER_LINEAR,
+					VK_SAMPLER_ADDRESS_MODE_REPEAT, &batch);
+			}
+			else if (decodedImage.pixels == nullptr) {
+				//keep draining the workers, report the first failure afterwards
+				if (failedPath.empty()) {
+					size_t sourceIndex = uniqueSources[decodedImage.index];
+					const tinygltf::Image& srcImage = input.images[sourceIndex];
+					failedPath = srcImage.uri.empty() ?
+						"image[" + std::to_string(sourceIndex) + "] (embedded)" : path + srcImage.uri;
+				}
+			}
+			else {
+				VkDeviceSize imageSize = static_cast<VkDeviceSize>(decodedImage.width) * decodedImage.height * 4;
+				images[decodedImage.index].load(devices, decodedImage.pixels, decodedImage.width, decodedImage.height,
+					imageSize, VK_FORMAT_R8G8B8A8_SRGB, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, &batch);
+				if (decodedImage.ownsPixels) {
+					stbi_image_free(decodedImage.pixels);
+				}
+			}
+			decodedImage = DecodedImage{};
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				inFlightImageCount--;
+			}
+			slotReleased.notify_one();
+		}
+	}
+	catch (...) {
+		//stop waiting workers & free pixels of the images which won't be uploaded
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cancelled = true;
+		}
+		slotReleased.notify_all();
+		threadPool.cleanup();
+		if (decodedImage.ownsPixels) {
+			stbi_image_free(decodedImage.pixels);
+		}
+		for (auto& queuedImage : decodedImages) {
+			if (queuedImage.ownsPixels) {
+				stbi_image_free(queuedImage.pixels);
+			}
+		}
+		throw;
+	}
+	threadPool.cleanup();
+
+	if (!failedPath.empty()) {
+		throw std::runtime_error("failed to load texture: " + failedPath);
+	}
+}
+
+/*
+* request mip levels of the images by the screen size of the primitives sampling them & stream them
+* the uv range of a primitive is assumed to span its bounding sphere once - a texel per pixel at the sphere's distance
+* must be called after the fence of the current frame is waited, image descriptors are rewritten if it returns true
+*
+* @param viewPos - camera position
+* @param proj - projection matrix of the camera
+* @param viewportHeight - height of the render target in pixels
+*
+* @return bool - true if the image of any texture was replaced
+*/
+bool VulkanGLTF::updateTextureStreaming(const glm::vec3& viewPos, const glm::mat4& proj, uint32_t viewportHeight) {
+	if (!streamTextures || textureStreamer.getTextureCount() == 0) {
+		return false;
+	}
+
+	//pixels covered by a unit length at unit distance
+	const float pixelScale = std::abs(proj[1][1]) * 0.5f * static_cast<float>(viewportHeight);
+	for (const Node& node : nodes) {
+		int32_t materialIndex = primitives[node.primitiveIndex].materialIndex;
+		if (materialIndex < 0 || materialIndex >= static_cast<int32_t>(materialImages.size())) {
+			continue;
+		}
+
+		const glm::vec4& bounds = primitiveBounds[node.primitiveIndex];
+		glm::vec3 center = glm::vec3(node.matrix * glm::vec4(glm::vec3(bounds), 1.f));
+		float scale = std::max({ glm::length(glm::vec3(node.matrix[0])), glm::length(glm::vec3(node.matrix[1])),
+			glm::length(glm::vec3(node.matrix[2])) });
+		float radius = bounds.w * scale;
+		//camera inside the sphere - finest level
+		float distance = std::max(glm::length(center - viewPos) - radius, 1e-3f);
+		float screenSize = 2.f * radius * pixelScale / distance;
+
+		for (uint32_t imageIndex : materialImages[materialIndex]) {
+			uint32_t streamIndex = imageStreamIndices[imageIndex];
+			VkExtent2D extent = textureStreamer.getExtent(streamIndex);
+			float textureSize = static_cast<float>(std::max(extent.width, extent.height));
+			float level = screenSize >= textureSize ? 0.f : std::log2(textureSize / std::max(screenSize, 1.f));
+			textureStreamer.requestLevel(streamIndex, static_cast<uint32_t>(std::min(level, 31.f)));
+		}
 	}
+	return textureStreamer.update();
 }
 
 /*
@@ -210,7 +915,32 @@ void VulkanGLTF::loadImages(tinygltf::Model& input) {
 void VulkanGLTF::loadTextures(tinygltf::Model& input) {
 	textures.resize(input.textures.size());
 	for (int i = 0; i < input.textures.size(); ++i) {
-		textures[i] = input.textures[i].source;
+		int source = input.textures[i].source;
+
+		//MSFT_texture_dds - prefer the DDS image if the device can sample BC formats
+		auto dds = input.textures[i].extensions.find("MSFT_texture_dds");
+		if (devices->textureCompressionBCSupported && dds != input.textures[i].extensions.end() &&
+			dds->second.Has("source")) {
+			source = dds->second.Get("source").Get<int>();
+		}
+
+		//duplicate images share the texture of the first one
+		textures[i] = (source >= 0 && source < static_cast<int>(imageIndices.size())) ?
+			imageIndices[source] : static_cast<uint32_t>(source);
+	}
+
+	//images sampled by each material - mip level requests of texture streaming
+	materialImages.assign(input.materials.size(), {});
+	for (size_t i = 0; i < input.materials.size(); ++i) {
+		const tinygltf::Material& material = input.materials[i];
+		for (int textureIndex : { material.pbrMetallicRoughness.baseColorTexture.index,
+			material.pbrMetallicRoughness.metallicRoughnessTexture.index, material.normalTexture.index,
+			material.occlusionTexture.index, material.emissiveTexture.index }) {
+			if (textureIndex >= 0 && textureIndex < static_cast<int>(textures.size()) &&
+				textures[textureIndex] < images.size()) {
+				materialImages[i].push_back(textures[textureIndex]);
+			}
+		}
 	}
 }
 
@@ -297,101 +1027,244 @@ glm::mat4 VulkanGLTF::getLocalMatrix(const tinygltf::Node& inputNode) const {
 }
 
 /*
-* get vertex / index info from the input primitive 
+* widen indices to uint32 & add the vertex offset of the primitive
+* tightly packed indices are rebased 4 at a time with sse2, the tail (& strided indices) one by one
+*
+* @param dst - first of count rebased indices
+* @param src - first index of the accessor
+* @param stride - byte distance between two indices
+* @param count - number of indices
+* @param vertexOffset - first vertex of the primitive in bufferData
+*/
+template<typename T>
+static void rebaseIndices(uint32_t* dst, const unsigned char* src, size_t stride, size_t count, uint32_t vertexOffset) {
+	size_t i = 0;
+#if defined(_M_X64) || defined(__SSE2__)
+	if (stride == sizeof(T)) {
+		const __m128i offset = _mm_set1_epi32(static_cast<int>(vertexOffset));
+		const __m128i zero = _mm_setzero_si128();
+		const size_t indicesPerLoad = 16 / sizeof(T);
+		for (; i + indicesPerLoad <= count; i += indicesPerLoad) {
+			__m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(T)));
+			__m128i* out = reinterpret_cast<__m128i*>(dst + i);
+			if constexpr (sizeof(T) == 4) {
+				_mm_storeu_si128(out, _mm_add_epi32(indices, offset));
+			}
+			else if constexpr (sizeof(T) == 2) {
+				_mm_storeu_si128(out, _mm_add_epi32(_mm_unpacklo_epi16(indices, zero), offset));
+				_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_unpackhi_epi16(indices, zero), offset));
+			}
+			else {
+				__m128i low = _mm_unpacklo_epi8(indices, zero);
+				__m128i high = _mm_unpackhi_epi8(indices, zero);
+				_mm_storeu_si128(out, _mm_add_epi32(_mm_unpacklo_epi16(low, zero), offset));
+				_mm_storeu_si128(out + 1, _mm_add_epi32(_mm_unpackhi_epi16(low, zero), offset));
+				_mm_storeu_si128(out + 2, _mm_add_epi32(_mm_unpacklo_epi16(high, zero), offset));
+				_mm_storeu_si128(out + 3, _mm_add_epi32(_mm_unpackhi_epi16(high, zero), offset));
+			}
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		T index;
+		memcpy(&index, src + i * stride, sizeof(T));
+		dst[i] = static_cast<uint32_t>(index) + vertexOffset;
+	}
+}
+
+/*
+* copy vertices / indices of the input primitive into its ranges assigned by loadGeometry()
+* writes nothing outside of the ranges - primitives are processed concurrently
 * 
 * @param inputPrimitive - input primitive to parse data
-* @param input - the whole model
-* @param indexBuffer - buffer to store indices
-* @param vertexBuffer - buffer to store vertices
+* @param model - the whole model
+* @param primitiveIndex - index in primitives with firstIndex / vertexOffset / counts set
 */
-void VulkanGLTF::addPrimitive(const tinygltf::Primitive& inputPrimitive, const tinygltf::Model& model) {
-	Primitive primitive{};
-	primitive.vertexOffset = static_cast<uint32_t>(bufferData.positions.size());
-	primitive.firstIndex = static_cast<uint32_t>(bufferData.indices.size());
+void VulkanGLTF::addPrimitive(const tinygltf::Primitive& inputPrimitive, const tinygltf::Model& model,
+	uint32_t primitiveIndex) {
+	const Primitive& primitive = primitives[primitiveIndex];
 
 	/*
-	* vertices
+	* vertices - copied straight from the mapped buffers
 	*/
-	const float* positionBuffer = nullptr;
-	const float* normalsBuffer = nullptr;
-	const float* texCoordsBuffer = nullptr;
-	const float* tangentsBuffer = nullptr;
-	size_t vertexCount = 0;
-
-	//get positions
-	if (auto posIt = inputPrimitive.attributes.find("POSITION"); posIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[posIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		positionBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-		vertexCount = accessor.count;
-	}
-	//get vertex normals
-	if (auto normalIt = inputPrimitive.attributes.find("NORMAL"); normalIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[normalIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		normalsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-	}
-	//get vertex texture coordinates
-	if (auto uvIt = inputPrimitive.attributes.find("TEXCOORD_0"); uvIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[uvIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		texCoordsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-	}
-	//get tengents
-	if (auto tangentIt = inputPrimitive.attributes.find("TANGENT"); tangentIt != inputPrimitive.attributes.end()) {
-		const tinygltf::Accessor& accessor = model.accessors[tangentIt->second];
-		const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
-		tangentsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-	}
-
-	//append data to model's vertex buffer
-	for (size_t i = 0; i < vertexCount; ++i) {
-		bufferData.positions.push_back(glm::make_vec3(&positionBuffer[i * 3]));
-		bufferData.normals.push_back(normalsBuffer ? glm::normalize(glm::make_vec3(&normalsBuffer[i * 3])) : glm::vec3(0.f));
-		bufferData.texCoord0s.push_back(texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[i * 2]) : glm::vec2(0.f));
-		bufferData.colors.push_back(glm::vec3(1.f));
-		bufferData.tangents.push_back(tangentsBuffer ? glm::make_vec4(&tangentsBuffer[i * 4]) : glm::vec4(0.f));
+	const size_t vertexOffset = primitive.vertexOffset;
+	const size_t vertexCount = primitive.vertexCount;
+	readAttribute(model, inputPrimitive, "POSITION", TINYGLTF_TYPE_VEC3, bufferData.positions.data() + vertexOffset, vertexCount);
+	if (readAttribute(model, inputPrimitive, "NORMAL", TINYGLTF_TYPE_VEC3, bufferData.normals.data() + vertexOffset, vertexCount)) {
+		for (size_t i = vertexOffset; i < vertexOffset + vertexCount; ++i) {
+			bufferData.normals[i] = glm::normalize(bufferData.normals[i]);
+		}
 	}
+	readAttribute(model, inputPrimitive, "TEXCOORD_0", TINYGLTF_TYPE_VEC2, bufferData.texCoord0s.data() + vertexOffset, vertexCount);
+	readAttribute(model, inputPrimitive, "TANGENT", TINYGLTF_TYPE_VEC4, bufferData.tangents.data() + vertexOffset, vertexCount);
 	
 	/*
 	* indices
 	*/
-	const tinygltf::Accessor& accessor = model.accessors[inputPrimitive.indices];
-	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
-	const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
-
-	uint32_t indexCount = static_cast<uint32_t>(accessor.count);
-
-	switch (accessor.componentType) {
-	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-		const uint32_t* buf = reinterpret_cast<const uint32_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-		for (size_t i = 0; i < accessor.count; ++i) {
-			bufferData.indices.push_back(buf[i] + primitive.vertexOffset);
+	uint32_t* indices = bufferData.indices.data() + primitive.firstIndex;
+	if (inputPrimitive.indices < 0) {
+		//non-indexed primitive - sequential indices
+		for (uint32_t i = 0; i < primitive.indexCount; ++i) {
+			indices[i] = primitive.vertexOffset + i;
 		}
-		break;
 	}
-	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-		const uint16_t* buf = reinterpret_cast<const uint16_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-		for (size_t i = 0; i < accessor.count; ++i) {
-			bufferData.indices.push_back(buf[i] + primitive.vertexOffset);
+	else {
+		const tinygltf::Accessor& accessor = model.accessors[inputPrimitive.indices];
+		size_t stride = 0;
+		const unsigned char* indexData = getAccessorData(model, accessor, stride);
+
+		//component type is checked by loadGeometry()
+		switch (accessor.componentType) {
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+			rebaseIndices<uint32_t>(indices, indexData, stride, primitive.indexCount, primitive.vertexOffset);
+			break;
+		case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+			rebaseIndices<uint16_t>(indices, indexData, stride, primitive.indexCount, primitive.vertexOffset);
+			break;
+		default:
+			rebaseIndices<uint8_t>(indices, indexData, stride, primitive.indexCount, primitive.vertexOffset);
+			break;
 		}
-		break;
 	}
-	case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-		const uint8_t* buf = reinterpret_cast<const uint8_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-		for (size_t i = 0; i < accessor.count; ++i) {
-			bufferData.indices.push_back(buf[i] + primitive.vertexOffset);
-		}
-		break;
+	bufferData.materialIndices[primitiveIndex] = inputPrimitive.material;
+
+	//bounding sphere of the aabb - screen size of the primitive for texture streaming
+	glm::vec3 minPos(std::numeric_limits<float>::max()), maxPos(-std::numeric_limits<float>::max());
+	for (size_t i = vertexOffset; i < vertexOffset + vertexCount; ++i) {
+		minPos = glm::min(minPos, bufferData.positions[i]);
+		maxPos = glm::max(maxPos, bufferData.positions[i]);
+	}
+	primitiveBounds[primitiveIndex] = vertexCount > 0 ?
+		glm::vec4((minPos + maxPos) * 0.5f, glm::length(maxPos - minPos) * 0.5f) : glm::vec4(0.f);
+}
+
+/*
+* first element of an accessor in the buffer it reads
+*
+* @param model - the whole model
+* @param accessor - accessor with a buffer view
+* @param stride - returns byte distance between two elements (byteStride of the view or the element size)
+*
+* @return const unsigned char* - pointer into a mapped file or a decoded data uri buffer
+*/
+const unsigned char* VulkanGLTF::getAccessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor,
+	size_t& stride) const {
+	const std::string str = "VulkanGLTF::getAccessorData(): ";
+	if (accessor.bufferView < 0 || static_cast<size_t>(accessor.bufferView) >= model.bufferViews.size()) {
+		throw std::runtime_error(str + "accessor without buffer view not supported");
+	}
+	const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+	if (view.buffer < 0 || static_cast<size_t>(view.buffer) >= bufferSpans.size()) {
+		throw std::runtime_error(str + "buffer " + std::to_string(view.buffer) + " not found");
+	}
+
+	//the last element must end in the buffer view & in the buffer
+	const int byteStride = accessor.ByteStride(view);
+	const int elementSize = tinygltf::GetComponentSizeInBytes(static_cast<uint32_t>(accessor.componentType)) *
+		tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type));
+	if (byteStride <= 0 || elementSize <= 0) {
+		throw std::runtime_error(str + "invalid accessor type / stride");
+	}
+	stride = static_cast<size_t>(byteStride);
+	const BufferSpan& span = bufferSpans[view.buffer];
+	const size_t end = accessor.count == 0 ? accessor.byteOffset :
+		accessor.byteOffset + (accessor.count - 1) * stride + static_cast<size_t>(elementSize);
+	if (end > view.byteLength || view.byteOffset + view.byteLength > span.size) {
+		throw std::runtime_error(str + "accessor exceeds buffer " + std::to_string(view.buffer));
+	}
+	return span.data + view.byteOffset + accessor.byteOffset;
+}
+
+/*
+* dequantize a component of a KHR_mesh_quantization attribute
+* normalized components are mapped to [0, 1] / [-1, 1] as defined by the glTF spec, others are converted as is
+*
+* @param src - first byte of the component (not necessarily aligned)
+* @param componentType - TINYGLTF_COMPONENT_TYPE_BYTE / UNSIGNED_BYTE / SHORT / UNSIGNED_SHORT
+* @param normalized - accessor.normalized
+*
+* @return float - dequantized component
+*/
+static float dequantizeComponent(const unsigned char* src, int componentType, bool normalized) {
+	switch (componentType) {
+	case TINYGLTF_COMPONENT_TYPE_BYTE: {
+		int8_t value = 0;
+		memcpy(&value, src, sizeof(value));
+		return normalized ? std::max(value / 127.f, -1.f) : static_cast<float>(value);
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+		uint8_t value = 0;
+		memcpy(&value, src, sizeof(value));
+		return normalized ? value / 255.f : static_cast<float>(value);
+	}
+	case TINYGLTF_COMPONENT_TYPE_SHORT: {
+		int16_t value = 0;
+		memcpy(&value, src, sizeof(value));
+		return normalized ? std::max(value / 32767.f, -1.f) : static_cast<float>(value);
+	}
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+		uint16_t value = 0;
+		memcpy(&value, src, sizeof(value));
+		return normalized ? value / 65535.f : static_cast<float>(value);
 	}
 	default:
-		throw std::runtime_error("VulkanGLTF::addPrimitive(): index component type" + 
-			std::to_string(accessor.componentType) + " not supported");
+		return 0.f;
 	}
+}
 
-	primitive.indexCount = indexCount;
-	primitive.vertexCount = static_cast<uint32_t>(vertexCount);
-	primitive.materialIndex = inputPrimitive.material;
-	primitives.push_back(primitive);
-	bufferData.materialIndices.push_back(inputPrimitive.material);
+/*
+* copy a vertex attribute of the primitive to tightly packed float dst
+* float views are copied with a single memcpy if tightly packed, element by element if interleaved
+* byte / short views (KHR_mesh_quantization) are dequantized component by component
+*
+* @param model - the whole model
+* @param inputPrimitive - primitive with the attribute
+* @param name - attribute name (POSITION, NORMAL ...)
+* @param type - expected accessor type (TINYGLTF_TYPE_VEC2 ...) - must match sizeof(T)
+* @param dst - first of vertexCount elements
+* @param vertexCount - number of vertices of the primitive
+*
+* @return bool - false if the primitive doesn't have the attribute (dst is untouched)
+*/
+template<typename T>
+bool VulkanGLTF::readAttribute(const tinygltf::Model& model, const tinygltf::Primitive& inputPrimitive,
+	const char* name, int type, T* dst, size_t vertexCount) const {
+	auto it = inputPrimitive.attributes.find(name);
+	if (it == inputPrimitive.attributes.end()) {
+		return false;
+	}
+	const tinygltf::Accessor& accessor = model.accessors[it->second];
+	const int componentType = accessor.componentType;
+	if (accessor.type != type || (componentType != TINYGLTF_COMPONENT_TYPE_FLOAT &&
+		componentType != TINYGLTF_COMPONENT_TYPE_BYTE && componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+		componentType != TINYGLTF_COMPONENT_TYPE_SHORT && componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)) {
+		throw std::runtime_error("VulkanGLTF::readAttribute(): unsupported format of " + std::string(name) +
+			" (component type " + std::to_string(accessor.componentType) + ", type " + std::to_string(accessor.type) + ")");
+	}
+	if (accessor.count < vertexCount) {
+		throw std::runtime_error("VulkanGLTF::readAttribute(): " + std::string(name) + " has fewer elements than POSITION");
+	}
+
+	size_t stride = 0;
+	const unsigned char* src = getAccessorData(model, accessor, stride);
+	if (componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
+		const size_t componentCount = sizeof(T) / sizeof(float);
+		const size_t componentSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(componentType));
+		for (size_t i = 0; i < vertexCount; ++i) {
+			float* out = glm::value_ptr(dst[i]);
+			const unsigned char* element = src + i * stride;
+			for (size_t c = 0; c < componentCount; ++c) {
+				out[c] = dequantizeComponent(element + c * componentSize, componentType, accessor.normalized);
+			}
+		}
+	}
+	else if (stride == sizeof(T)) {
+		memcpy(dst, src, vertexCount * sizeof(T));
+	}
+	else {
+		for (size_t i = 0; i < vertexCount; ++i) {
+			memcpy(&dst[i], src + i * stride, sizeof(T));
+		}
+	}
+	return true;
 }
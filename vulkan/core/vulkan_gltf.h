@@ -7,6 +7,9 @@ https://github.com/nvpro-samples/nvpro_core/blob/master/nvh/gltfscene.h
 #include <unordered_map>
 #include "vulkan_utils.h"
 #include "vulkan_texture.h"
+#include "vulkan_texture_streamer.h"
+#include "vulkan_mapped_file.h"
+#include "vulkan_scene_cache.h"
 #include "tiny_gltf.h"
 
 /*
@@ -20,20 +23,40 @@ public:
 	/** path to the model */
 	std::string path;
 
-	/** @breif load gltf scene and assign resources */
+	/** @breif load gltf scene (.gltf / .glb) and assign resources */
 	void loadScene(VulkanDevice* devices, const std::string& path, VkBufferUsageFlags usage);
 	/** @brief release all resources */
 	void cleanup();
+	/** @brief incremented whenever the defragmenter moves a buffer or an image - owner rewrites descriptors & device addresses */
+	uint64_t getResourceVersion() const { return resourceVersion; }
 
 	/*
 	* image
 	*/
+	/** unique images of the model - glTF images with identical content share one entry */
 	std::vector<Texture2D> images;
+	/** number of image decode threads - 0 uses the number of hardware threads */
+	uint32_t decodeThreadCount = 0;
+	/** max number of decoded images waiting for upload - bounds the memory of decoded pixels */
+	uint32_t maxInFlightDecodedImages = 8;
+	/** encode images to BC1 / BC3 / BC4 / BC5 by their material role - ignored if BC isn't supported */
+	bool compressTextures = false;
+	/** stream mip levels by the screen size of the primitives - only the coarse levels are loaded by loadScene */
+	bool streamTextures = false;
+	/** mip streaming of the images if streamTextures is set - set budget / residentSize before loadScene */
+	TextureStreamer textureStreamer;
 	/** @brief load images from the model */
-	void loadImages(tinygltf::Model& input);
+	void loadImages(tinygltf::Model& input, UploadBatch& batch);
+	/** @brief request mip levels of the images from the camera & stream them - returns true if an image changed */
+	bool updateTextureStreaming(const glm::vec3& viewPos, const glm::mat4& proj, uint32_t viewportHeight);
+
+	/** number of geometry processing threads - 0 uses the number of hardware threads, 1 processes serially */
+	uint32_t importThreadCount = 0;
+	/** reuse processed geometry from <path>.vkcache if it matches the source - written on a miss */
+	bool useSceneCache = true;
 
 	/*
-	* texture (reference image via image index)
+	* texture (reference image via index in images)
 	*/
 	std::vector<uint32_t> textures;
 	/** @brief parse image references from the model */
@@ -123,10 +146,52 @@ public:
 	};
 	std::vector<Primitive> primitives;
 	VkBuffer primitiveBuffer = VK_NULL_HANDLE;
+	/** bounding sphere of each primitive in model space (xyz center, w radius) */
+	std::vector<glm::vec4> primitiveBounds;
 
 private:
+	/** @brief parse the json of the .gltf / .glb file - its binary buffers are read from memory mapped files */
+	void parseModel(tinygltf::Model& model, const std::string& path);
+	/** @brief pointer to the first element of the accessor in its buffer & its stride - throws if it exceeds the buffer */
+	const unsigned char* getAccessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor,
+		size_t& stride) const;
+	/** @brief copy an attribute of the primitive to dst as float (stride aware, dequantized) - returns false if it doesn't exist */
+	template<typename T>
+	bool readAttribute(const tinygltf::Model& model, const tinygltf::Primitive& inputPrimitive, const char* name,
+		int type, T* dst, size_t vertexCount) const;
+	/** @brief upload a read-only buffer & register it as movable */
+	void uploadBuffer(UploadBatch& batch, VkBuffer& buffer, const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
+	/** @brief process vertices / indices of every primitive & flatten the node hierarchy */
+	void loadGeometry(const tinygltf::Model& model, uint32_t primitiveCount);
+	/** @brief map processed geometry from the scene cache - returns false if it doesn't match the model */
+	bool readSceneCache(const std::string& cachePath, uint64_t key, uint32_t primitiveCount);
+	/** @brief write processed geometry to the scene cache */
+	bool writeSceneCache(const std::string& cachePath, uint64_t key) const;
 	/** @brief get local matrix from the node */
 	glm::mat4 getLocalMatrix(const tinygltf::Node& inputNode) const;
-	/** @brief get vertex / index info from the input primitive */
-	void addPrimitive(const tinygltf::Primitive& inputPrimitive, const tinygltf::Model& model);
+	/** @brief copy vertices / indices of the input primitive into its preassigned ranges (thread safe between primitives) */
+	void addPrimitive(const tinygltf::Primitive& inputPrimitive, const tinygltf::Model& model, uint32_t primitiveIndex);
+
+	/** bytes of a glTF buffer - range of a mapped file, or data decoded by tinygltf (data uri) */
+	struct BufferSpan {
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+	};
+	/** bytes of each glTF buffer while loadScene runs */
+	std::vector<BufferSpan> bufferSpans;
+	/** .glb / .bin files mapped by loadScene - unmapped once the scene is uploaded */
+	std::vector<MappedFile> mappedFiles;
+	/** hash of the json & size / write time of the binary files - key of the scene cache */
+	uint64_t sourceKey = 0;
+	/** scene cache mapped by loadScene on a hit - unmapped once the scene is uploaded */
+	SceneCache sceneCache;
+
+	/** index in images of each glTF image - images with identical content share one texture */
+	std::vector<uint32_t> imageIndices;
+	/** index of each image in textureStreamer */
+	std::vector<uint32_t> imageStreamIndices;
+	/** images sampled by each material - receive the mip level requests of its primitives */
+	std::vector<std::vector<uint32_t>> materialImages;
+	/** incremented by the move callbacks of the buffers & images */
+	uint64_t resourceVersion = 0;
 };
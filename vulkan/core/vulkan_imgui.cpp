@@ -9,10 +9,14 @@
 * init context & style & resources
 * 
 * @param devices - abstracted vulkan device (physical / logical) pointer
+* @param frameRingBuffer - per-frame allocator holding vertex & index data
 */
 void ImguiBase::init(VulkanDevice* devices, int width, int height,
-	VkRenderPass renderPass, uint32_t MAX_FRAMES_IN_FLIGHT, VkSampleCountFlagBits sampleCount) {
+	VkRenderPass renderPass, uint32_t MAX_FRAMES_IN_FLIGHT, VkSampleCountFlagBits sampleCount,
+	FrameRingBuffer* frameRingBuffer) {
 	this->devices = devices;
+	this->frameRingBuffer = frameRingBuffer;
+	vertexIndexAllocations.resize(MAX_FRAMES_IN_FLIGHT);
 	ImGui::CreateContext();
 
 	//color scheme
@@ -73,10 +77,6 @@ void ImguiBase::cleanup() {
 		return;
 	}
 	ImGui::DestroyContext();
-	//vertex & index buffer
-	devices->memoryAllocator.freeBufferMemory(vertexIndexBuffer, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	vkDestroyBuffer(devices->device, vertexIndexBuffer, nullptr);
 	//image
 	fontImage.cleanup();
 	//pipeline
@@ -94,44 +94,110 @@ void ImguiBase::newFrame() {
 	ImGui::NewFrame();
 	ImGui::Begin("Setting");
 	ImGui::End();
+	drawMemoryStatistics();
 	ImGui::Render();
 }
 
+/*
+* format byte size as MiB string
+*/
+static std::string toMiB(VkDeviceSize bytes) {
+	char str[32];
+	snprintf(str, sizeof(str), "%.2f MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+	return str;
+}
+
+/*
+* memory allocator statistics window - call between ImGui::NewFrame() & ImGui::Render()
+* shown only if showMemoryStatistics is true
+*/
+void ImguiBase::drawMemoryStatistics() {
+	if (!showMemoryStatistics) {
+		return;
+	}
+
+	const MemoryAllocator::Statistics stats = devices->memoryAllocator.getStatistics();
+	ImGui::Begin("Memory", &showMemoryStatistics);
+
+	//totals
+	ImGui::Text("allocated: %s, used: %s", toMiB(stats.allocatedBytes).c_str(), toMiB(stats.usedBytes).c_str());
+	ImGui::Text("allocations: %llu, frees: %llu", static_cast<unsigned long long>(stats.allocationCount),
+		static_cast<unsigned long long>(stats.freeCount));
+	ImGui::Text("vkAllocateMemory: %llu, vkFreeMemory: %llu", static_cast<unsigned long long>(stats.chunkAllocationCount),
+		static_cast<unsigned long long>(stats.chunkFreeCount));
+	ImGui::Text("granularity padding saved: %s", toMiB(stats.granularityPaddingSaved).c_str());
+	if (ImGui::Button("dump json")) {
+		devices->memoryAllocator.dumpStatistics("memory_statistics.json");
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("defragment")) {
+		devices->memoryAllocator.beginDefragmentation();
+	}
+
+	//heap budget
+	ImGui::Separator();
+	ImGui::Text(stats.memoryBudgetEnabled ? "heaps (VK_EXT_memory_budget)" : "heaps (budget unavailable)");
+	for (size_t i = 0; i < stats.heaps.size(); ++i) {
+		const MemoryAllocator::HeapStatistics& heap = stats.heaps[i];
+		std::string overlay = toMiB(heap.usage) + " / " + toMiB(heap.budget);
+		ImGui::Text("heap %zu%s", i, (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "");
+		ImGui::ProgressBar(heap.budget ? static_cast<float>(heap.usage) / heap.budget : 0.f,
+			ImVec2(-1.f, 0.f), overlay.c_str());
+	}
+
+	//pools & chunks
+	ImGui::Separator();
+	for (const auto& pool : stats.pools) {
+		std::string label = "type " + std::to_string(pool.memoryTypeIndex) +
+			(pool.lifetime == MemoryAllocator::MemoryLifetime::STATIC ? " static" : " resolution dependent") +
+			" - " + toMiB(pool.usedBytes) + " / " + toMiB(pool.allocatedBytes);
+		if (!ImGui::TreeNode(label.c_str())) {
+			continue;
+		}
+		ImGui::Text("blocks used: %zu, free: %zu, largest free range: %s", pool.usedBlockCount,
+			pool.freeBlockCount, toMiB(pool.largestFreeRange).c_str());
+		for (const auto& chunk : pool.chunks) {
+			std::string overlay = toMiB(chunk.usedBytes) + " / " + toMiB(chunk.size) +
+				(chunk.dedicated ? " (dedicated)" : "");
+			ImGui::ProgressBar(static_cast<float>(chunk.usedBytes) / chunk.size, ImVec2(-1.f, 0.f), overlay.c_str());
+			if (ImGui::IsItemHovered()) {
+				ImGui::SetTooltip("blocks used: %zu, free: %zu\nlargest free range: %s",
+					chunk.usedBlockCount, chunk.freeBlockCount, toMiB(chunk.largestFreeRange).c_str());
+			}
+		}
+		ImGui::TreePop();
+	}
+	ImGui::End();
+}
+
 /*
 * update vertex & index buffer
+* data is written to the frame ring buffer of the current frame, no need to wait for the device
 * 
-* @return bool - buffer recreated?
+* @return bool - vertex & index location or count has been changed (command buffers should be re-recorded)
 */
 bool ImguiBase::updateBuffers() {
-	bool bufferRecreated= false;
 	ImDrawData* imDrawData = ImGui::GetDrawData();
 
 	VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
 	VkDeviceSize indexBufferSize = imDrawData->TotalIdxCount* sizeof(ImDrawIdx);
 
 	if (vertexBufferSize == 0 || indexBufferSize == 0) {
-		return bufferRecreated;
+		return false;
 	}
 
-	//finish all command before deleting the buffer
-	vkDeviceWaitIdle(devices->device);
-
-	//update buffers only if vertex or index count has been changed
-	if (vertexIndexBuffer == VK_NULL_HANDLE || vertexCount != imDrawData->TotalVtxCount 
-		|| indexCount != imDrawData->TotalIdxCount) {
-		devices->memoryAllocator.freeBufferMemory(vertexIndexBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		vkDestroyBuffer(devices->device, vertexIndexBuffer, nullptr);
-		vertexIndexMem = devices->createBuffer(vertexIndexBuffer, vertexBufferSize + indexBufferSize,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		vertexCount = imDrawData->TotalVtxCount;
-		indexCount = imDrawData->TotalIdxCount;
-		bufferRecreated = true;
-	}
+	FrameRingBuffer::Allocation allocation = frameRingBuffer->allocate(vertexBufferSize + indexBufferSize);
+	FrameRingBuffer::Allocation& oldAllocation = vertexIndexAllocations[frameRingBuffer->getCurrentFrame()];
+
+	//pre-recorded command buffers bind the old range - re-record only if it is moved or the counts are changed
+	bool bufferRecreated = oldAllocation.buffer != allocation.buffer || oldAllocation.offset != allocation.offset
+		|| vertexCount != imDrawData->TotalVtxCount || indexCount != imDrawData->TotalIdxCount;
+	oldAllocation = allocation;
+	vertexCount = imDrawData->TotalVtxCount;
+	indexCount = imDrawData->TotalIdxCount;
 
 	//memcpy vertex data
-	ImDrawVert* vtxDst = (ImDrawVert*)vertexIndexMem.getHandle(devices->device);
+	ImDrawVert* vtxDst = (ImDrawVert*)allocation.data;
 	for (int n = 0; n < imDrawData->CmdListsCount; ++n) {
 		const ImDrawList* cmd_list = imDrawData->CmdLists[n];
 		memcpy(vtxDst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
@@ -145,8 +211,7 @@ bool ImguiBase::updateBuffers() {
 		memcpy(idxDst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
 		idxDst += cmd_list->IdxBuffer.Size;
 	}
-	
-	vertexIndexMem.unmap(devices->device);
+
 	return bufferRecreated;
 }
 
@@ -174,11 +239,13 @@ void ImguiBase::drawFrame(VkCommandBuffer cmdBuf, size_t currentFrame) {
 	int32_t vertexOffset = 0;
 	int32_t indexOffset = 0;
 
-	if (imDrawData->CmdListsCount > 0) {
-		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &vertexIndexBuffer, offsets);
+	//vertex & index data of this frame is not written yet (pre-recorded command buffers)
+	const FrameRingBuffer::Allocation& allocation = vertexIndexAllocations[currentFrame];
+	if (imDrawData->CmdListsCount > 0 && allocation.buffer != VK_NULL_HANDLE) {
+		VkDeviceSize offsets[1] = { allocation.offset };
+		vkCmdBindVertexBuffers(cmdBuf, 0, 1, &allocation.buffer, offsets);
 		VkDeviceSize vertexBufferSize = imDrawData->TotalVtxCount * sizeof(ImDrawVert);
-		vkCmdBindIndexBuffer(cmdBuf, vertexIndexBuffer, vertexBufferSize, VK_INDEX_TYPE_UINT16);
+		vkCmdBindIndexBuffer(cmdBuf, allocation.buffer, allocation.offset + vertexBufferSize, VK_INDEX_TYPE_UINT16);
 
 		for (int32_t i = 0; i < imDrawData->CmdListsCount; ++i) {
 			const ImDrawList* cmd_list = imDrawData->CmdLists[i];
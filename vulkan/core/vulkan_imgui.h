@@ -1,6 +1,7 @@
 #pragma once
 #include "vulkan_texture.h"
 #include "vulkan_descriptor_set_bindings.h"
+#include "vulkan_frame_ring_buffer.h"
 
 /* 
 * Imgui & vulkan integration
@@ -13,9 +14,9 @@ protected:
 		glm::vec2 translate;
 	} pushConstBlock;
 
-	/** vertex & index buffer */
-	VkBuffer vertexIndexBuffer							= VK_NULL_HANDLE;
-	MemoryAllocator::HostVisibleMemory vertexIndexMem;
+	/** vertex & index data - rewritten every frame into the frame ring buffer */
+	FrameRingBuffer* frameRingBuffer					= nullptr;
+	std::vector<FrameRingBuffer::Allocation> vertexIndexAllocations;
 	int32_t vertexCount									= 0;
 	int32_t indexCount									= 0;
 	/** font image */
@@ -36,11 +37,13 @@ public:
 	/** @brief init context & style & resources */
 	void init(VulkanDevice* devices, int width, int height,
 		VkRenderPass renderPass, uint32_t MAX_FRAMES_IN_FLIGHT,
-		VkSampleCountFlagBits sampleCount);
+		VkSampleCountFlagBits sampleCount, FrameRingBuffer* frameRingBuffer);
 	/** @brief destroy all resources */
 	void cleanup();
 	/** @brief start imgui frame */
 	virtual void newFrame();
+	/** @brief memory allocator statistics window */
+	void drawMemoryStatistics();
 	/** @brief update vertex & index buffer */
 	bool updateBuffers();
 	/** @brief record imgui draw commands */
@@ -50,6 +53,8 @@ public:
 
 	/** for application update */
 	bool rerecordcommandBuffer = false;
+	/** memory statistics window toggle */
+	bool showMemoryStatistics = false;
 	/** window flags */
 	ImGuiWindowFlags flags;
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <stdexcept>
+#include <utility>
+#include "vulkan_mapped_file.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+* take over the mapping of other
+*/
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+/*
+* release the current mapping & take over the mapping of other
+*/
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		mappedData = std::exchange(other.mappedData, nullptr);
+		mappedSize = std::exchange(other.mappedSize, 0);
+#ifdef _WIN32
+		fileHandle = std::exchange(other.fileHandle, nullptr);
+		mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+	}
+	return *this;
+}
+
+/*
+* map the whole file read-only
+*
+* @param path - path to the file
+*/
+void MappedFile::open(const std::string& path) {
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("MappedFile::open(): failed to open " + path);
+	}
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("MappedFile::open(): failed to get the size of " + path);
+	}
+	fileHandle = file;
+	mappedSize = static_cast<size_t>(fileSize.QuadPart);
+	//empty files can't be mapped
+	if (mappedSize == 0) {
+		return;
+	}
+
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr) {
+		close();
+		throw std::runtime_error("MappedFile::open(): failed to create file mapping of " + path);
+	}
+	mappedData = static_cast<const unsigned char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (mappedData == nullptr) {
+		close();
+		throw std::runtime_error("MappedFile::open(): failed to map " + path);
+	}
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("MappedFile::open(): failed to open " + path);
+	}
+	struct stat fileStat{};
+	if (fstat(file, &fileStat) != 0) {
+		::close(file);
+		throw std::runtime_error("MappedFile::open(): failed to get the size of " + path);
+	}
+	mappedSize = static_cast<size_t>(fileStat.st_size);
+	if (mappedSize > 0) {
+		void* mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping == MAP_FAILED) {
+			::close(file);
+			mappedSize = 0;
+			throw std::runtime_error("MappedFile::open(): failed to map " + path);
+		}
+		mappedData = static_cast<const unsigned char*>(mapping);
+		//the mapping stays valid after the descriptor is closed
+		madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+	}
+	::close(file);
+#endif
+}
+
+/*
+* unmap the file & close its handles
+*/
+void MappedFile::close() {
+#ifdef _WIN32
+	if (mappedData != nullptr) {
+		UnmapViewOfFile(mappedData);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+		fileHandle = nullptr;
+	}
+#else
+	if (mappedData != nullptr) {
+		munmap(const_cast<unsigned char*>(mappedData), mappedSize);
+	}
+#endif
+	mappedData = nullptr;
+	mappedSize = 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+
+/*
+* read-only memory mapping of a whole file
+* pages are read by the os on first access & can be dropped under memory pressure -
+* used to read large binary files (.glb / .bin) without copying them to the heap
+*/
+class MappedFile {
+public:
+	MappedFile() {}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile() { close(); }
+
+	/** @brief map the whole file - throws if the file can't be opened or mapped */
+	void open(const std::string& path);
+	/** @brief unmap the file - pointers to the mapped bytes become invalid */
+	void close();
+
+	/** @brief first mapped byte, nullptr if nothing is mapped (or the file is empty) */
+	const unsigned char* data() const { return mappedData; }
+	/** @brief size of the file in bytes */
+	size_t size() const { return mappedSize; }
+
+private:
+	const unsigned char* mappedData = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	/** file & file mapping handles (HANDLE) */
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -1,81 +1,142 @@
 #include <algorithm>
 #include <string>
+#include <fstream>
+#include <json.hpp>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #include "vulkan_memory_allocator.h"
 
+/*
+* index of the most significant set bit
+*
+* @param mask - must not be zero
+*/
+static inline uint32_t findLastSetBit(uint64_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, mask);
+	return static_cast<uint32_t>(index);
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(mask));
+#endif
+}
+
+/*
+* index of the least significant set bit
+*
+* @param mask - must not be zero
+*/
+static inline uint32_t findFirstSetBit(uint64_t mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+}
+
+/*
+* round x up to the multiple of a
+*/
+static inline VkDeviceSize alignUp(VkDeviceSize x, VkDeviceSize a) {
+	return (x + a - 1) / a * a;
+}
+
 /*
 * get device & chunk size info
 *
 * @param device - logical device handle
 * @param bufferImageGranularity
+* @param nonCoherentAtomSize - alignment of flush / invalidate ranges of non-coherent memory
 */
-void MemoryAllocator::init(VkDevice device, VkDeviceSize bufferImageGranularity,
+void MemoryAllocator::init(VkDevice device, VkDeviceSize bufferImageGranularity, VkDeviceSize nonCoherentAtomSize,
+	const VkPhysicalDeviceMemoryProperties& memProperties, VkMemoryAllocateFlags allocateFlags,
+	uint32_t defaultChunkSize) {
+	vulkanBackend.device = device;
+	init(&vulkanBackend, bufferImageGranularity, nonCoherentAtomSize, memProperties, allocateFlags, defaultChunkSize);
+}
+
+/*
+* get chunk size info - every device call goes through the given backend
+*
+* @param backend - device calls, must outlive the allocator
+* @param bufferImageGranularity
+* @param nonCoherentAtomSize - alignment of flush / invalidate ranges of non-coherent memory
+*/
+void MemoryAllocator::init(MemoryBackend* backend, VkDeviceSize bufferImageGranularity, VkDeviceSize nonCoherentAtomSize,
 	const VkPhysicalDeviceMemoryProperties& memProperties, VkMemoryAllocateFlags allocateFlags,
 	uint32_t defaultChunkSize) {
 	this->memProperties = memProperties;
-	this->device = device;
+	this->backend = backend;
 	this->bufferImageGranularity = bufferImageGranularity;
+	this->nonCoherentAtomSize = std::max<VkDeviceSize>(nonCoherentAtomSize, 1);
 	this->allocateFlags = allocateFlags;
-	memoryPools.resize(memProperties.memoryTypeCount);
+	const uint32_t lifetimeCount = static_cast<uint32_t>(MemoryLifetime::COUNT);
+	memoryPools.resize(lifetimeCount * memProperties.memoryTypeCount);
 
 	//assign memory type index & chunk size to individual memory pool
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
-		uint32_t heapIndex = memProperties.memoryTypes[i].heapIndex;
-		VkDeviceSize heapSize = memProperties.memoryHeaps[heapIndex].size;
+	for (uint32_t lifetime = 0; lifetime < lifetimeCount; ++lifetime) {
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
+			MemoryPool& pool = memoryPools[lifetime * memProperties.memoryTypeCount + i];
+			uint32_t heapIndex = memProperties.memoryTypes[i].heapIndex;
+			VkDeviceSize heapSize = memProperties.memoryHeaps[heapIndex].size;
 
-		//chunk size
-		if (heapSize < 1000000000) { //1GB
-			memoryPools[i].defaultChunkSize = heapSize / 8;
-		}
-		else {
-			memoryPools[i].defaultChunkSize = defaultChunkSize;
-		}
+			//chunk size
+			if (heapSize < 1000000000) { //1GB
+				pool.defaultChunkSize = heapSize / 8;
+			}
+			else {
+				pool.defaultChunkSize = defaultChunkSize;
+			}
 
-		//memory type index
-		memoryPools[i].memoryTypeIndex = i;
+			//memory type index
+			pool.memoryTypeIndex = i;
+			pool.propertyFlags = memProperties.memoryTypes[i].propertyFlags;
+			pool.lifetime = static_cast<MemoryLifetime>(lifetime);
+		}
 	}
 }
 
 /*
 * (sub)allocate to pre-allocated memory
+* resources which prefer / require dedicated allocation or are too big for a chunk get their own device memory
 *
 * @param buffer - buffer handle to allocate (bind) memory
 * @param properties - memory properties needed for memory type search
+* @param lifetime - selects the pool, resources of different lifetime don't share chunks
 * 
 * @return HostVisibleMemory - contain device memory handle, size, offset
 */
-MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties) {
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties,
+	MemoryLifetime lifetime) {
+	VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memRequirements2{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	memRequirements2.pNext = &dedicatedRequirements;
+	backend->getBufferMemoryRequirements(buffer, memRequirements2);
+	const VkMemoryRequirements& memRequirements = memRequirements2.memoryRequirements;
 	uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
+	uint32_t poolIndex = static_cast<uint32_t>(lifetime) * memProperties.memoryTypeCount + memoryTypeIndex;
 
-	MemoryPool& pool = memoryPools[memoryTypeIndex];
-	//find suitable memory chunk
-	for (size_t i = 0; i < pool.memoryChunks.size(); ++i) {
-		if (pool.memoryChunks[i].currentSize > memRequirements.size) {
-			MemoryBlock memoryBlock{};
-			if (pool.memoryChunks[i].findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-				pool.memoryChunks[i].addBufferMemoryBlock(device, buffer, memoryBlock);
-				if(properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
-					return { pool.memoryChunks[i].memoryHandle, memoryBlock.size, memoryBlock.offset };
-				else {
-					return{};
-				}
-			}
-		}
-	}
-
-	//failed to find suitable memory location - add new memory chunk
-	pool.allocateChunk(device, allocateFlags);
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+	dedicatedInfo.buffer = buffer;
 	MemoryBlock memoryBlock{};
-	if (pool.memoryChunks.back().findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-		pool.memoryChunks.back().addBufferMemoryBlock(device, buffer, memoryBlock);
-		if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
-			return { pool.memoryChunks.back().memoryHandle, memoryBlock.size, memoryBlock.offset };
-		else {
-			return{};
-		}
-	}
+	uint32_t freeBlockIndex = INVALID_BLOCK_INDEX;
+	uint32_t chunkIndex = reserveMemoryBlock(memRequirements, dedicatedRequirements, dedicatedInfo,
+		poolIndex, true, memoryBlock, freeBlockIndex);
 
+	MemoryPool& pool = memoryPools[poolIndex];
+	uint32_t blockIndex = pool.memoryChunks[chunkIndex].addBufferMemoryBlock(*backend, buffer, memoryBlock, freeBlockIndex);
+	bufferMemoryBlocks[buffer] = { poolIndex, chunkIndex, blockIndex };
+	pool.allocationCount++;
+	if (traceFile.is_open()) {
+		traceAllocation('b', reinterpret_cast<uint64_t>(buffer), memRequirements, dedicatedRequirements,
+			properties, lifetime, true);
+	}
+	if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		return getHostVisibleMemory(pool, pool.memoryChunks[chunkIndex], memoryBlock);
+	}
 	return {};
 }
 
@@ -84,121 +145,125 @@ MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateBufferMemory(VkBuffe
 *
 * @param image - image handle to allocate (bind) memory
 * @param properties - memory properties needed for memory type search
+* @param lifetime - selects the pool, resources of different lifetime don't share chunks
+* @param tiling - linear images are treated like buffers for bufferImageGranularity
 *
 * @return HostVisibleMemory - contain device memory handle, size, offset
 */
-MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties) {
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(device, image, &memRequirements);
+MemoryAllocator::HostVisibleMemory MemoryAllocator::allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties,
+	MemoryLifetime lifetime, VkImageTiling tiling) {
+	VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memRequirements2{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	memRequirements2.pNext = &dedicatedRequirements;
+	backend->getImageMemoryRequirements(image, memRequirements2);
+	const VkMemoryRequirements& memRequirements = memRequirements2.memoryRequirements;
 	uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
+	uint32_t poolIndex = static_cast<uint32_t>(lifetime) * memProperties.memoryTypeCount + memoryTypeIndex;
 
-	MemoryPool& pool = memoryPools[memoryTypeIndex];
-	//find suitable memory chunk
-	for (size_t i = 0; i < pool.memoryChunks.size(); ++i) {
-		if (pool.memoryChunks[i].currentSize > memRequirements.size) {
-			MemoryBlock memoryBlock{};
-			if (pool.memoryChunks[i].findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-				pool.memoryChunks[i].addImageMemoryBlock(device, image, memoryBlock);
-				if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-					return { pool.memoryChunks[i].memoryHandle, memoryBlock.size, memoryBlock.offset };
-				else {
-					return{};
-				}
-			}
-		}
-	}
-
-	//failed to find suitable memory location - add new memory chunk
-	pool.allocateChunk(device, allocateFlags);
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO };
+	dedicatedInfo.image = image;
 	MemoryBlock memoryBlock{};
-	if (pool.memoryChunks.back().findSuitableMemoryLocation(memRequirements, bufferImageGranularity, memoryBlock)) {
-		pool.memoryChunks.back().addImageMemoryBlock(device, image, memoryBlock);
-		if (properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-			return { pool.memoryChunks.back().memoryHandle, memoryBlock.size, memoryBlock.offset };
-		else {
-			return{};
-		}
-	}
+	uint32_t freeBlockIndex = INVALID_BLOCK_INDEX;
+	uint32_t chunkIndex = reserveMemoryBlock(memRequirements, dedicatedRequirements, dedicatedInfo,
+		poolIndex, tiling == VK_IMAGE_TILING_LINEAR, memoryBlock, freeBlockIndex);
 
+	MemoryPool& pool = memoryPools[poolIndex];
+	uint32_t blockIndex = pool.memoryChunks[chunkIndex].addImageMemoryBlock(*backend, image, memoryBlock, freeBlockIndex);
+	imageMemoryBlocks[image] = { poolIndex, chunkIndex, blockIndex };
+	pool.allocationCount++;
+	if (traceFile.is_open()) {
+		traceAllocation('i', reinterpret_cast<uint64_t>(image), memRequirements, dedicatedRequirements,
+			properties, lifetime, tiling == VK_IMAGE_TILING_LINEAR);
+	}
+	if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		return getHostVisibleMemory(pool, pool.memoryChunks[chunkIndex], memoryBlock);
+	}
 	return {};
 }
 
 /*
 * free buffer memory block
 * 
-* @param buffer - buffer to be deallocated
-* @param properties - used to identify memory type; 
-*	if it is not provided then memory allocator should search the whole memory pools
+* @param buffer - buffer to be deallocated (its memory block is recorded when the buffer is allocated)
 */
-void MemoryAllocator::freeBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties) {
+void MemoryAllocator::freeBufferMemory(VkBuffer buffer) {
 	if (buffer == VK_NULL_HANDLE) {
 		return;
 	}
 
-	if (properties == VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM) {
-		//memory properties are not provided; search the whole memory pools
-		for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryPools.size(); ++memoryTypeIndex) {
-			if (findAndEraseBufferMemoryBlock(buffer, memoryTypeIndex)) {
-				return;
-			}
-		}
+	auto it = bufferMemoryBlocks.find(buffer);
+	if (it == bufferMemoryBlocks.end()) {
+		throw std::runtime_error("MemoryAllocator::freeBufferMemory(): there is no matching buffer");
 	}
-	else {
-		//identify memory type
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(device, buffer, &memRequirements); //make sure to free memory before you free VkBuffer
-		uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
 
-		if (findAndEraseBufferMemoryBlock(buffer, memoryTypeIndex)) {
-			return;
+	//buffer is gone before its planned move
+	movableBuffers.erase(buffer);
+	for (size_t i = 0; i < defragmentationMoves.size(); ++i) {
+		if (!defragmentationMoves[i].image && defragmentationMoves[i].srcBuffer == buffer) {
+			cancelMove(i);
+			break;
 		}
 	}
 
-	throw std::runtime_error("MemoryAllocator::freeBufferMemory(): there is no matching buffer");
+	eraseMemoryBlock(it->second);
+	bufferMemoryBlocks.erase(it);
+	if (traceFile.is_open()) {
+		traceFile << "f b " << reinterpret_cast<uint64_t>(buffer) << "\n";
+	}
 }
 
 /*
 * basically the same as freeBufferMemory but for VkImage
 *
-* @param image - image to be deallocated
-* @param properties - used to identify memory type;
-*	if it is not provided then memory allocator should search the whole memory pools
+* @param image - image to be deallocated (its memory block is recorded when the image is allocated)
 */
-void MemoryAllocator::freeImageMemory(VkImage image, VkMemoryPropertyFlags properties) {
+void MemoryAllocator::freeImageMemory(VkImage image) {
 	if (image == VK_NULL_HANDLE) {
 		return;
 	}
 
-	if (properties == VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM) {
-		//memory properties are not provided; search the whole memory pools
-		for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryPools.size(); ++memoryTypeIndex) {
-			if (findAndEraseImageMemoryBlock(image, memoryTypeIndex)) {
-				return;
-			}
-		}
+	auto it = imageMemoryBlocks.find(image);
+	if (it == imageMemoryBlocks.end()) {
+		throw std::runtime_error("MemoryAllocator::freeImageMemory(): there is no matching image");
 	}
-	else {
-		//identify memory type
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(device, image, &memRequirements); //make sure to free memory before you free VkImage
-		uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, memProperties);
 
-		if (findAndEraseImageMemoryBlock(image, memoryTypeIndex)) {
-			return;
+	//image is gone before its planned move
+	movableImages.erase(image);
+	for (size_t i = 0; i < defragmentationMoves.size(); ++i) {
+		if (defragmentationMoves[i].image && defragmentationMoves[i].srcImage == image) {
+			cancelMove(i);
+			break;
 		}
 	}
 
-	throw std::runtime_error("MemoryAllocator::freeImageMemory(): there is no matching image");
+	eraseMemoryBlock(it->second);
+	imageMemoryBlocks.erase(it);
+	if (traceFile.is_open()) {
+		traceFile << "f i " << reinterpret_cast<uint64_t>(image) << "\n";
+	}
 }
 
 /*
 * free all allocated memory
 */
 void MemoryAllocator::cleanup() {
+	//destination resources of unfinished moves are owned by the allocator
+	while (!defragmentationMoves.empty()) {
+		cancelMove(defragmentationMoves.size() - 1);
+	}
+	recordedMoveCount = 0;
+	defragmentationSourceChunks.clear();
+	movableBuffers.clear();
+	movableImages.clear();
+
+	stopTrace();
+
 	std::vector<size_t> reminaingMemoryBlockNums;
 	for (size_t i = 0; i < memoryPools.size(); ++i) {
-		reminaingMemoryBlockNums.push_back(memoryPools[i].cleanup(device));
+		reminaingMemoryBlockNums.push_back(memoryPools[i].cleanup(*backend));
 	}
+	bufferMemoryBlocks.clear();
+	imageMemoryBlocks.clear();
 
 	bool remaining = false;
 	for (size_t i = 0; i < reminaingMemoryBlockNums.size(); ++i) {
@@ -220,6 +285,727 @@ void MemoryAllocator::cleanup() {
 	}
 }
 
+/*
+* bufferImageGranularity padding avoided by placing linear & optimal resources apart only when they meet
+*
+* @return VkDeviceSize - bytes saved by the currently active blocks
+*/
+VkDeviceSize MemoryAllocator::getGranularityPaddingSaved() const {
+	VkDeviceSize saved = 0;
+	for (const auto& pool : memoryPools) {
+		for (const auto& chunk : pool.memoryChunks) {
+			saved += chunk.paddingSaved;
+		}
+	}
+	return saved;
+}
+
+/*
+* release chunks which have no active memory block
+* resolution dependent pools keep their chunks across resize so the new resources reuse the memory in place,
+* call this after recreation to give back what the new extent doesn't need
+*
+* @param lifetime - lifetime of the pools to shrink
+*/
+void MemoryAllocator::releaseEmptyChunks(MemoryLifetime lifetime) {
+	for (auto& pool : memoryPools) {
+		if (pool.lifetime != lifetime) {
+			continue;
+		}
+		for (uint32_t i = 0; i < static_cast<uint32_t>(pool.memoryChunks.size()); ++i) {
+			const MemoryChunk& chunk = pool.memoryChunks[i];
+			if (chunk.memoryHandle != VK_NULL_HANDLE && chunk.activeBlockCount == 0) {
+				pool.freeChunk(*backend, i);
+			}
+		}
+	}
+	if (traceFile.is_open()) {
+		traceFile << "e " << static_cast<uint32_t>(lifetime) << "\n";
+	}
+}
+
+/*
+* heap budget & usage of getStatistics() are queried from VK_EXT_memory_budget after this call
+*
+* @param physicalDevice - physical device of the logical device which enabled VK_EXT_memory_budget
+*/
+void MemoryAllocator::enableMemoryBudget(VkPhysicalDevice physicalDevice) {
+	budgetPhysicalDevice = physicalDevice;
+}
+
+/*
+* collect per pool / chunk usage, allocation counters & heap budget
+*
+* @return Statistics - snapshot of the allocator
+*/
+MemoryAllocator::Statistics MemoryAllocator::getStatistics() const {
+	Statistics stats{};
+	stats.heaps.resize(memProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; ++i) {
+		stats.heaps[i].size = memProperties.memoryHeaps[i].size;
+		stats.heaps[i].flags = memProperties.memoryHeaps[i].flags;
+	}
+
+	for (const auto& pool : memoryPools) {
+		stats.allocationCount += pool.allocationCount;
+		stats.freeCount += pool.freeCount;
+		stats.chunkAllocationCount += pool.chunkAllocationCount;
+		stats.chunkFreeCount += pool.chunkFreeCount;
+		if (pool.chunkAllocationCount == 0) {
+			continue;
+		}
+
+		PoolStatistics poolStats{};
+		poolStats.memoryTypeIndex = pool.memoryTypeIndex;
+		poolStats.heapIndex = memProperties.memoryTypes[pool.memoryTypeIndex].heapIndex;
+		poolStats.propertyFlags = pool.propertyFlags;
+		poolStats.lifetime = pool.lifetime;
+		poolStats.allocationCount = pool.allocationCount;
+		poolStats.freeCount = pool.freeCount;
+		poolStats.chunkAllocationCount = pool.chunkAllocationCount;
+		poolStats.chunkFreeCount = pool.chunkFreeCount;
+
+		for (const auto& chunk : pool.memoryChunks) {
+			//released slot
+			if (chunk.memoryHandle == VK_NULL_HANDLE) {
+				continue;
+			}
+			ChunkStatistics chunkStats{};
+			chunkStats.size = chunk.chunkSize;
+			chunkStats.freeBytes = chunk.currentSize;
+			chunkStats.usedBytes = chunk.chunkSize - chunk.currentSize;
+			chunkStats.largestFreeRange = chunk.getLargestFreeRange();
+			chunkStats.usedBlockCount = chunk.activeBlockCount;
+			chunkStats.freeBlockCount = chunk.freeBlockCount;
+			chunkStats.dedicated = chunk.dedicated;
+
+			poolStats.allocatedBytes += chunkStats.size;
+			poolStats.usedBytes += chunkStats.usedBytes;
+			poolStats.largestFreeRange = std::max(poolStats.largestFreeRange, chunkStats.largestFreeRange);
+			poolStats.usedBlockCount += chunkStats.usedBlockCount;
+			poolStats.freeBlockCount += chunkStats.freeBlockCount;
+			stats.granularityPaddingSaved += chunk.paddingSaved;
+			poolStats.chunks.push_back(chunkStats);
+		}
+
+		stats.heaps[poolStats.heapIndex].allocatedBytes += poolStats.allocatedBytes;
+		stats.allocatedBytes += poolStats.allocatedBytes;
+		stats.usedBytes += poolStats.usedBytes;
+		stats.pools.push_back(std::move(poolStats));
+	}
+
+	//heap budget - includes memory of other processes & allocations outside of this allocator
+	if (budgetPhysicalDevice != VK_NULL_HANDLE) {
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT };
+		VkPhysicalDeviceMemoryProperties2 memProperties2{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2 };
+		memProperties2.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(budgetPhysicalDevice, &memProperties2);
+		for (uint32_t i = 0; i < memProperties.memoryHeapCount; ++i) {
+			stats.heaps[i].budget = budgetProperties.heapBudget[i];
+			stats.heaps[i].usage = budgetProperties.heapUsage[i];
+		}
+		stats.memoryBudgetEnabled = true;
+	}
+	else {
+		for (auto& heap : stats.heaps) {
+			heap.budget = heap.size;
+			heap.usage = heap.allocatedBytes;
+		}
+	}
+	return stats;
+}
+
+/*
+* write statistics snapshot to a json file
+*
+* @param path - output file path
+*/
+void MemoryAllocator::dumpStatistics(const std::string& path) const {
+	static const char* lifetimeNames[] = { "static", "resolution_dependent" };
+	Statistics stats = getStatistics();
+
+	nlohmann::json root;
+	root["memoryBudgetEnabled"] = stats.memoryBudgetEnabled;
+	root["allocatedBytes"] = stats.allocatedBytes;
+	root["usedBytes"] = stats.usedBytes;
+	root["granularityPaddingSaved"] = stats.granularityPaddingSaved;
+	root["allocationCount"] = stats.allocationCount;
+	root["freeCount"] = stats.freeCount;
+	root["chunkAllocationCount"] = stats.chunkAllocationCount;
+	root["chunkFreeCount"] = stats.chunkFreeCount;
+
+	root["heaps"] = nlohmann::json::array();
+	for (size_t i = 0; i < stats.heaps.size(); ++i) {
+		const HeapStatistics& heap = stats.heaps[i];
+		root["heaps"].push_back({
+			{ "index", i },
+			{ "deviceLocal", (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 },
+			{ "size", heap.size },
+			{ "allocatedBytes", heap.allocatedBytes },
+			{ "budget", heap.budget },
+			{ "usage", heap.usage }
+		});
+	}
+
+	root["pools"] = nlohmann::json::array();
+	for (const auto& pool : stats.pools) {
+		nlohmann::json chunks = nlohmann::json::array();
+		for (const auto& chunk : pool.chunks) {
+			chunks.push_back({
+				{ "size", chunk.size },
+				{ "usedBytes", chunk.usedBytes },
+				{ "freeBytes", chunk.freeBytes },
+				{ "largestFreeRange", chunk.largestFreeRange },
+				{ "usedBlockCount", chunk.usedBlockCount },
+				{ "freeBlockCount", chunk.freeBlockCount },
+				{ "dedicated", chunk.dedicated }
+			});
+		}
+		root["pools"].push_back({
+			{ "memoryTypeIndex", pool.memoryTypeIndex },
+			{ "heapIndex", pool.heapIndex },
+			{ "propertyFlags", pool.propertyFlags },
+			{ "lifetime", lifetimeNames[static_cast<uint32_t>(pool.lifetime)] },
+			{ "allocatedBytes", pool.allocatedBytes },
+			{ "usedBytes", pool.usedBytes },
+			{ "largestFreeRange", pool.largestFreeRange },
+			{ "usedBlockCount", pool.usedBlockCount },
+			{ "freeBlockCount", pool.freeBlockCount },
+			{ "allocationCount", pool.allocationCount },
+			{ "freeCount", pool.freeCount },
+			{ "chunkAllocationCount", pool.chunkAllocationCount },
+			{ "chunkFreeCount", pool.chunkFreeCount },
+			{ "chunks", chunks }
+		});
+	}
+
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("MemoryAllocator::dumpStatistics(): failed to open " + path);
+	}
+	file << root.dump(4);
+	LOG("saved:\t" + path);
+}
+
+/*
+* record every allocation & free to a text file - replayed offline by allocator_replay
+* header lists heaps, memory types & granularity so the replay uses the same memory properties
+* records : a (allocation), f <b|i> <handle> (free), r <b|i> <old> <new> (defragmentation move),
+* e <lifetime> (releaseEmptyChunks)
+*
+* @param path - trace file path
+*/
+void MemoryAllocator::startTrace(const std::string& path) {
+	stopTrace();
+	traceFile.open(path);
+	if (!traceFile.is_open()) {
+		throw std::runtime_error("MemoryAllocator::startTrace(): failed to open " + path);
+	}
+
+	traceFile << "# vulkan memory allocator trace v1\n";
+	for (uint32_t i = 0; i < memProperties.memoryHeapCount; ++i) {
+		traceFile << "heap " << i << " " << memProperties.memoryHeaps[i].size << " " <<
+			memProperties.memoryHeaps[i].flags << "\n";
+	}
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i) {
+		traceFile << "type " << i << " " << memProperties.memoryTypes[i].heapIndex << " " <<
+			memProperties.memoryTypes[i].propertyFlags << "\n";
+	}
+	traceFile << "granularity " << bufferImageGranularity << " " << nonCoherentAtomSize << "\n";
+	LOG("tracing:\t" + path);
+}
+
+/*
+* close the trace file
+*/
+void MemoryAllocator::stopTrace() {
+	if (traceFile.is_open()) {
+		traceFile.close();
+	}
+}
+
+/*
+* append an allocation record to the trace
+* a <b|i> <handle> <size> <alignment> <memoryTypeBits> <properties> <lifetime> <linear> <prefersDedicated> <requiresDedicated>
+*
+* @param resourceType - 'b' for buffers, 'i' for images
+* @param handle - buffer / image handle, matches the handle of the free record
+*/
+void MemoryAllocator::traceAllocation(char resourceType, uint64_t handle, const VkMemoryRequirements& memRequirements,
+	const VkMemoryDedicatedRequirements& dedicatedRequirements, VkMemoryPropertyFlags properties,
+	MemoryLifetime lifetime, bool linear) {
+	traceFile << "a " << resourceType << " " << handle << " " << memRequirements.size << " " <<
+		memRequirements.alignment << " " << memRequirements.memoryTypeBits << " " << properties << " " <<
+		static_cast<uint32_t>(lifetime) << " " << linear << " " <<
+		dedicatedRequirements.prefersDedicatedAllocation << " " << dedicatedRequirements.requiresDedicatedAllocation << "\n";
+}
+
+/*
+* allow the defragmenter to move the buffer
+* the buffer must not be written by the device & must be created with VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+*
+* @param buffer - buffer allocated by allocateBufferMemory
+* @param createInfo - used to create the buffer again at the new location
+* @param onMoved - called with the new buffer when the move is finished (the old buffer is already destroyed)
+*/
+void MemoryAllocator::registerMovableBuffer(VkBuffer buffer, const VkBufferCreateInfo& createInfo,
+	BufferMovedCallback onMoved) {
+	if (bufferMemoryBlocks.find(buffer) == bufferMemoryBlocks.end()) {
+		throw std::runtime_error("MemoryAllocator::registerMovableBuffer(): there is no matching buffer");
+	}
+	if ((createInfo.usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) == 0) {
+		throw std::runtime_error("MemoryAllocator::registerMovableBuffer(): buffer must be a transfer source");
+	}
+
+	MovableBuffer& movable = movableBuffers[buffer];
+	movable.createInfo = createInfo;
+	movable.createInfo.pNext = nullptr;
+	//moved buffer can be moved again
+	movable.createInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	movable.queueFamilyIndices.clear();
+	if (createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+		movable.queueFamilyIndices.assign(createInfo.pQueueFamilyIndices,
+			createInfo.pQueueFamilyIndices + createInfo.queueFamilyIndexCount);
+	}
+	movable.onMoved = std::move(onMoved);
+}
+
+/*
+* allow the defragmenter to move the image
+* the image must not be written by the device & must be created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+*
+* @param image - image allocated by allocateImageMemory
+* @param createInfo - used to create the image again at the new location
+* @param layout - layout of all subresources while the image is in use, the moved image is left in this layout
+* @param aspectMask - aspects copied to the new image
+* @param onMoved - called with the new image when the move is finished (the old image is already destroyed)
+*/
+void MemoryAllocator::registerMovableImage(VkImage image, const VkImageCreateInfo& createInfo, VkImageLayout layout,
+	VkImageAspectFlags aspectMask, ImageMovedCallback onMoved) {
+	if (imageMemoryBlocks.find(image) == imageMemoryBlocks.end()) {
+		throw std::runtime_error("MemoryAllocator::registerMovableImage(): there is no matching image");
+	}
+	if ((createInfo.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) == 0) {
+		throw std::runtime_error("MemoryAllocator::registerMovableImage(): image must be a transfer source");
+	}
+	if (layout == VK_IMAGE_LAYOUT_UNDEFINED || layout == VK_IMAGE_LAYOUT_PREINITIALIZED) {
+		throw std::runtime_error("MemoryAllocator::registerMovableImage(): image content must be defined");
+	}
+
+	MovableImage& movable = movableImages[image];
+	movable.createInfo = createInfo;
+	movable.createInfo.pNext = nullptr;
+	movable.createInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	movable.createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	movable.queueFamilyIndices.clear();
+	if (createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT) {
+		movable.queueFamilyIndices.assign(createInfo.pQueueFamilyIndices,
+			createInfo.pQueueFamilyIndices + createInfo.queueFamilyIndexCount);
+	}
+	movable.layout = layout;
+	movable.aspectMask = aspectMask;
+	movable.onMoved = std::move(onMoved);
+}
+
+/*
+* plan moves of the registered resources - live blocks of the sparsest chunks are packed into fuller chunks
+* of the same pool, a chunk is planned only if all of its blocks are movable & fit somewhere else
+* new resources are created & bound right away, the copies are recorded by recordDefragmentationPass()
+* host visible pools are skipped - owners keep mapped pointers into them
+*
+* @return size_t - number of planned moves
+*/
+size_t MemoryAllocator::beginDefragmentation() {
+	if (!defragmentationMoves.empty()) {
+		return defragmentationMoves.size();
+	}
+
+	//movable resources of each chunk - key : poolIndex << 32 | chunkIndex
+	std::unordered_map<uint64_t, std::pair<std::vector<VkBuffer>, std::vector<VkImage>>> chunkMovables;
+	for (const auto& movable : movableBuffers) {
+		const MemoryBlockLocation& location = bufferMemoryBlocks.at(movable.first);
+		chunkMovables[(uint64_t(location.poolIndex) << 32) | location.chunkIndex].first.push_back(movable.first);
+	}
+	for (const auto& movable : movableImages) {
+		const MemoryBlockLocation& location = imageMemoryBlocks.at(movable.first);
+		chunkMovables[(uint64_t(location.poolIndex) << 32) | location.chunkIndex].second.push_back(movable.first);
+	}
+
+	for (uint32_t poolIndex = 0; poolIndex < static_cast<uint32_t>(memoryPools.size()); ++poolIndex) {
+		MemoryPool& pool = memoryPools[poolIndex];
+		if (pool.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+			continue;
+		}
+
+		//suballocated chunks in use - sparsest first
+		std::vector<uint32_t> sortedChunks;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(pool.memoryChunks.size()); ++i) {
+			const MemoryChunk& chunk = pool.memoryChunks[i];
+			if (chunk.memoryHandle != VK_NULL_HANDLE && !chunk.dedicated && chunk.activeBlockCount > 0) {
+				sortedChunks.push_back(i);
+			}
+		}
+		std::sort(sortedChunks.begin(), sortedChunks.end(), [&pool](uint32_t a, uint32_t b) {
+			return pool.memoryChunks[a].chunkSize - pool.memoryChunks[a].currentSize <
+				pool.memoryChunks[b].chunkSize - pool.memoryChunks[b].currentSize;
+		});
+
+		for (size_t s = 0; s + 1 < sortedChunks.size(); ++s) {
+			uint32_t srcChunkIndex = sortedChunks[s];
+			auto movablesIt = chunkMovables.find((uint64_t(poolIndex) << 32) | srcChunkIndex);
+			if (movablesIt == chunkMovables.end()) {
+				continue;
+			}
+			//chunk can't be released if any block stays
+			const auto& buffers = movablesIt->second.first;
+			const auto& images = movablesIt->second.second;
+			if (buffers.size() + images.size() != pool.memoryChunks[srcChunkIndex].activeBlockCount) {
+				continue;
+			}
+
+			//fullest chunk first
+			std::vector<uint32_t> dstChunks(sortedChunks.rbegin(), sortedChunks.rend() - s - 1);
+			size_t firstMove = defragmentationMoves.size();
+			bool planned = true;
+			for (size_t i = 0; i < buffers.size() && planned; ++i) {
+				DefragmentationMove move{};
+				planned = planBufferMove(buffers[i], poolIndex, dstChunks, move);
+				if (planned) {
+					defragmentationMoves.push_back(move);
+				}
+			}
+			for (size_t i = 0; i < images.size() && planned; ++i) {
+				DefragmentationMove move{};
+				planned = planImageMove(images[i], poolIndex, dstChunks, move);
+				if (planned) {
+					defragmentationMoves.push_back(move);
+				}
+			}
+
+			//partially moved chunk doesn't save anything - undo
+			if (!planned) {
+				while (defragmentationMoves.size() > firstMove) {
+					cancelMove(defragmentationMoves.size() - 1);
+				}
+				continue;
+			}
+			pool.memoryChunks[srcChunkIndex].defragmentationSource = true;
+			defragmentationSourceChunks.push_back({ poolIndex, srcChunkIndex });
+		}
+	}
+
+	if (!defragmentationMoves.empty()) {
+		LOG("defragmentation:\t" + std::to_string(defragmentationMoves.size()) + " moves, " +
+			std::to_string(defragmentationSourceChunks.size()) + " chunks to release");
+	}
+	return defragmentationMoves.size();
+}
+
+/*
+* record copies of the planned moves - at least one move, more while they fit in the budget
+* call endDefragmentationPass() once the command buffer is completed
+*
+* @param commandBuffer - command buffer in recording state (graphics / compute / transfer queue)
+* @param byteBudget - bytes to copy in this pass
+*
+* @return VkDeviceSize - recorded bytes
+*/
+VkDeviceSize MemoryAllocator::recordDefragmentationPass(VkCommandBuffer commandBuffer, VkDeviceSize byteBudget) {
+	if (recordedMoveCount != 0) {
+		throw std::runtime_error("MemoryAllocator::recordDefragmentationPass(): previous pass is not finished");
+	}
+	if (defragmentationMoves.empty()) {
+		return 0;
+	}
+
+	//make previous writes to the source resources visible to the copies
+	VkMemoryBarrier memoryBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+	memoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	VkDeviceSize recordedBytes = 0;
+	while (recordedMoveCount < defragmentationMoves.size()) {
+		const DefragmentationMove& move = defragmentationMoves[recordedMoveCount];
+		if (recordedMoveCount > 0 && recordedBytes + move.size > byteBudget) {
+			break;
+		}
+
+		if (!move.image) {
+			VkBufferCopy region{ 0, 0, move.size };
+			vkCmdCopyBuffer(commandBuffer, move.srcBuffer, move.dstBuffer, 1, &region);
+		}
+		else {
+			const MovableImage& movable = movableImages.at(move.srcImage);
+			const VkImageCreateInfo& info = movable.createInfo;
+			VkImageSubresourceRange range{ movable.aspectMask, 0, info.mipLevels, 0, info.arrayLayers };
+			vktools::insertImageMemoryBarrier(commandBuffer, move.srcImage,
+				VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+				movable.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, range);
+			vktools::insertImageMemoryBarrier(commandBuffer, move.dstImage,
+				0, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, range);
+
+			//all mip levels & array layers
+			std::vector<VkImageCopy> regions(info.mipLevels);
+			for (uint32_t mip = 0; mip < info.mipLevels; ++mip) {
+				VkImageCopy& region = regions[mip];
+				region.srcSubresource = { movable.aspectMask, mip, 0, info.arrayLayers };
+				region.dstSubresource = region.srcSubresource;
+				region.extent = { std::max(info.extent.width >> mip, 1u),
+					std::max(info.extent.height >> mip, 1u),
+					std::max(info.extent.depth >> mip, 1u) };
+			}
+			vkCmdCopyImage(commandBuffer, move.srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				move.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(regions.size()), regions.data());
+
+			//source stays usable until the pass ends
+			vktools::insertImageMemoryBarrier(commandBuffer, move.srcImage,
+				0, VK_ACCESS_MEMORY_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, movable.layout,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, range);
+			vktools::insertImageMemoryBarrier(commandBuffer, move.dstImage,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, movable.layout,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, range);
+		}
+		recordedBytes += move.size;
+		recordedMoveCount++;
+	}
+
+	//copied data is visible to every later command
+	memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	return recordedBytes;
+}
+
+/*
+* finish moves recorded by the last pass - old resources are destroyed & owners get the new handles,
+* source chunks whose last block is moved are released by vkFreeMemory
+* the command buffer of the pass (and every submission using the old handles) must be completed
+*
+* @return size_t - number of finished moves
+*/
+size_t MemoryAllocator::endDefragmentationPass() {
+	//moves are removed first - callbacks may free / register resources
+	std::vector<DefragmentationMove> finishedMoves(defragmentationMoves.begin(),
+		defragmentationMoves.begin() + recordedMoveCount);
+	defragmentationMoves.erase(defragmentationMoves.begin(), defragmentationMoves.begin() + recordedMoveCount);
+	recordedMoveCount = 0;
+
+	for (const auto& move : finishedMoves) {
+		if (!move.image) {
+			auto it = bufferMemoryBlocks.find(move.srcBuffer);
+			eraseMemoryBlock(it->second);
+			bufferMemoryBlocks.erase(it);
+			backend->destroyBuffer(move.srcBuffer);
+			if (traceFile.is_open()) {
+				traceFile << "r b " << reinterpret_cast<uint64_t>(move.srcBuffer) << " " <<
+					reinterpret_cast<uint64_t>(move.dstBuffer) << "\n";
+			}
+
+			auto movableIt = movableBuffers.find(move.srcBuffer);
+			MovableBuffer movable = std::move(movableIt->second);
+			movableBuffers.erase(movableIt);
+			BufferMovedCallback onMoved = movable.onMoved;
+			movableBuffers[move.dstBuffer] = std::move(movable);
+			if (onMoved) {
+				onMoved(move.dstBuffer);
+			}
+		}
+		else {
+			auto it = imageMemoryBlocks.find(move.srcImage);
+			eraseMemoryBlock(it->second);
+			imageMemoryBlocks.erase(it);
+			backend->destroyImage(move.srcImage);
+			if (traceFile.is_open()) {
+				traceFile << "r i " << reinterpret_cast<uint64_t>(move.srcImage) << " " <<
+					reinterpret_cast<uint64_t>(move.dstImage) << "\n";
+			}
+
+			auto movableIt = movableImages.find(move.srcImage);
+			MovableImage movable = std::move(movableIt->second);
+			movableImages.erase(movableIt);
+			ImageMovedCallback onMoved = movable.onMoved;
+			movableImages[move.dstImage] = std::move(movable);
+			if (onMoved) {
+				onMoved(move.dstImage);
+			}
+		}
+	}
+
+	//give back emptied chunks
+	for (size_t i = 0; i < defragmentationSourceChunks.size();) {
+		MemoryPool& pool = memoryPools[defragmentationSourceChunks[i].first];
+		uint32_t chunkIndex = defragmentationSourceChunks[i].second;
+		MemoryChunk& chunk = pool.memoryChunks[chunkIndex];
+		if (chunk.activeBlockCount == 0 || defragmentationMoves.empty()) {
+			if (chunk.activeBlockCount == 0) {
+				pool.freeChunk(*backend, chunkIndex);
+			}
+			else {
+				chunk.defragmentationSource = false;
+			}
+			defragmentationSourceChunks[i] = defragmentationSourceChunks.back();
+			defragmentationSourceChunks.pop_back();
+			continue;
+		}
+		++i;
+	}
+	return finishedMoves.size();
+}
+
+/*
+* create the buffer again & bind it to one of the destination chunks
+*
+* @param buffer - buffer to move
+* @param poolIndex - pool of the buffer
+* @param dstChunks - chunk indices the buffer may be moved to, in search order
+* @param move - out parameter, filled if return value is true
+*
+* @return bool - false if the buffer doesn't fit in any destination chunk
+*/
+bool MemoryAllocator::planBufferMove(VkBuffer buffer, uint32_t poolIndex, const std::vector<uint32_t>& dstChunks,
+	DefragmentationMove& move) {
+	const MovableBuffer& movable = movableBuffers.at(buffer);
+	VkBufferCreateInfo createInfo = movable.createInfo;
+	createInfo.pQueueFamilyIndices = movable.queueFamilyIndices.data();
+	VkBuffer newBuffer = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(backend->createBuffer(createInfo, newBuffer));
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memRequirements2{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	memRequirements2.pNext = &dedicatedRequirements;
+	backend->getBufferMemoryRequirements(newBuffer, memRequirements2);
+
+	uint32_t chunkIndex = 0, freeBlockIndex = INVALID_BLOCK_INDEX;
+	MemoryBlock memoryBlock{};
+	if (dedicatedRequirements.requiresDedicatedAllocation ||
+		!findMoveDestination(poolIndex, dstChunks, memRequirements2.memoryRequirements, true,
+			chunkIndex, memoryBlock, freeBlockIndex)) {
+		backend->destroyBuffer(newBuffer);
+		return false;
+	}
+
+	MemoryPool& pool = memoryPools[poolIndex];
+	uint32_t blockIndex = pool.memoryChunks[chunkIndex].addBufferMemoryBlock(*backend, newBuffer, memoryBlock, freeBlockIndex);
+	bufferMemoryBlocks[newBuffer] = { poolIndex, chunkIndex, blockIndex };
+	pool.allocationCount++;
+
+	move.image = false;
+	move.srcBuffer = buffer;
+	move.dstBuffer = newBuffer;
+	move.size = createInfo.size;
+	return true;
+}
+
+/*
+* basically the same as planBufferMove but for VkImage
+*
+* @param image - image to move
+* @param poolIndex - pool of the image
+* @param dstChunks - chunk indices the image may be moved to, in search order
+* @param move - out parameter, filled if return value is true
+*
+* @return bool - false if the image doesn't fit in any destination chunk
+*/
+bool MemoryAllocator::planImageMove(VkImage image, uint32_t poolIndex, const std::vector<uint32_t>& dstChunks,
+	DefragmentationMove& move) {
+	const MovableImage& movable = movableImages.at(image);
+	VkImageCreateInfo createInfo = movable.createInfo;
+	createInfo.pQueueFamilyIndices = movable.queueFamilyIndices.data();
+	VkImage newImage = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(backend->createImage(createInfo, newImage));
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{ VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memRequirements2{ VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+	memRequirements2.pNext = &dedicatedRequirements;
+	backend->getImageMemoryRequirements(newImage, memRequirements2);
+
+	uint32_t chunkIndex = 0, freeBlockIndex = INVALID_BLOCK_INDEX;
+	MemoryBlock memoryBlock{};
+	if (dedicatedRequirements.requiresDedicatedAllocation ||
+		!findMoveDestination(poolIndex, dstChunks, memRequirements2.memoryRequirements,
+			createInfo.tiling == VK_IMAGE_TILING_LINEAR, chunkIndex, memoryBlock, freeBlockIndex)) {
+		backend->destroyImage(newImage);
+		return false;
+	}
+
+	MemoryPool& pool = memoryPools[poolIndex];
+	uint32_t blockIndex = pool.memoryChunks[chunkIndex].addImageMemoryBlock(*backend, newImage, memoryBlock, freeBlockIndex);
+	imageMemoryBlocks[newImage] = { poolIndex, chunkIndex, blockIndex };
+	pool.allocationCount++;
+
+	move.image = true;
+	move.srcImage = image;
+	move.dstImage = newImage;
+	move.size = memRequirements2.memoryRequirements.size;
+	return true;
+}
+
+/*
+* find free range for the moved resource in the destination chunks
+*
+* @param poolIndex - pool of the resource, the memory type must stay the same
+* @param dstChunks - chunk indices to search, in search order
+* @param memRequirements - requirements of the new resource
+* @param linear - true for buffers & linear tiling images
+* @param chunkIndex - out parameter, chunk containing memoryBlock
+* @param memoryBlock - out parameter containing block layout
+* @param freeBlockIndex - out parameter, free block which memoryBlock is split off
+*
+* @return bool - true when found
+*/
+bool MemoryAllocator::findMoveDestination(uint32_t poolIndex, const std::vector<uint32_t>& dstChunks,
+	const VkMemoryRequirements& memRequirements, bool linear,
+	uint32_t& chunkIndex, MemoryBlock& memoryBlock, uint32_t& freeBlockIndex) {
+	MemoryPool& pool = memoryPools[poolIndex];
+	if ((memRequirements.memoryTypeBits & (1u << pool.memoryTypeIndex)) == 0) {
+		return false;
+	}
+	for (uint32_t dstChunkIndex : dstChunks) {
+		MemoryChunk& chunk = pool.memoryChunks[dstChunkIndex];
+		if (!chunk.defragmentationSource && chunk.currentSize > memRequirements.size &&
+			chunk.findSuitableMemoryLocation(memRequirements, bufferImageGranularity, linear, memoryBlock, freeBlockIndex)) {
+			chunkIndex = dstChunkIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+* release destination block & handle of a move which won't happen
+*
+* @param moveIndex - index of the move in defragmentationMoves
+*/
+void MemoryAllocator::cancelMove(size_t moveIndex) {
+	const DefragmentationMove& move = defragmentationMoves[moveIndex];
+	if (!move.image) {
+		auto it = bufferMemoryBlocks.find(move.dstBuffer);
+		eraseMemoryBlock(it->second);
+		bufferMemoryBlocks.erase(it);
+		backend->destroyBuffer(move.dstBuffer);
+	}
+	else {
+		auto it = imageMemoryBlocks.find(move.dstImage);
+		eraseMemoryBlock(it->second);
+		imageMemoryBlocks.erase(it);
+		backend->destroyImage(move.dstImage);
+	}
+
+	if (moveIndex < recordedMoveCount) {
+		recordedMoveCount--;
+	}
+	defragmentationMoves.erase(defragmentationMoves.begin() + moveIndex);
+}
+
 /*
 * find a memory in 'memoryTypeBitsRequirements' that includes all of 'requiredProperties'
 *
@@ -241,222 +1027,696 @@ uint32_t MemoryAllocator::findMemoryType(uint32_t memoryTypeBitsRequirements,
 }
 
 /*
-* helper function for freeBufferMemory
-* 
-* @param buffer - buffer handle bound to the memory to be deallocated
-* @param memoryTypeIndex - index of memoryType used by the buffer
-*/
-bool MemoryAllocator::findAndEraseBufferMemoryBlock(VkBuffer buffer, uint32_t memoryTypeIndex) {
-	//find & remove 
-	for (auto& memoryChunk : memoryPools[memoryTypeIndex].memoryChunks) {
-		auto it = std::find_if(memoryChunk.memoryBlocks.begin(), memoryChunk.memoryBlocks.end(),
-			[&buffer](const MemoryBlock& memoryBlock) {
-				return buffer == memoryBlock.handle.bufferHandle;
-			});
+* find memory chunk which can hold the resource (or allocate new one) and reserve memory block in it
+*
+* @param memRequirements
+* @param dedicatedRequirements - driver hint whether the resource wants its own device memory
+* @param dedicatedInfo - resource handle used for dedicated allocation
+* @param poolIndex - index of memory pool
+* @param linear - true for buffers & linear tiling images
+* @param memoryBlock - out parameter containing block layout
+* @param freeBlockIndex - out parameter, free block which memoryBlock is split off
+*
+* @return uint32_t - index of the memory chunk
+*/
+uint32_t MemoryAllocator::reserveMemoryBlock(const VkMemoryRequirements& memRequirements,
+	const VkMemoryDedicatedRequirements& dedicatedRequirements, const VkMemoryDedicatedAllocateInfo& dedicatedInfo,
+	uint32_t poolIndex, bool linear, MemoryBlock& memoryBlock, uint32_t& freeBlockIndex) {
+	MemoryPool& pool = memoryPools[poolIndex];
 
-		if (it != memoryChunk.memoryBlocks.end()) {
-			memoryChunk.currentSize += (it->blockEndLocation - it->offset);
-			memoryChunk.memoryBlocks.erase(it);
-			return true;
+	//dedicated allocation - driver asks for it or the resource would waste most of a chunk
+	//resolution dependent resources only take it when required, dedicated memory can't be reused after resize
+	bool dedicated = dedicatedRequirements.requiresDedicatedAllocation;
+	if (pool.lifetime == MemoryLifetime::STATIC) {
+		dedicated |= dedicatedRequirements.prefersDedicatedAllocation || memRequirements.size > pool.defaultChunkSize / 2;
+	}
+	if (dedicated) {
+		uint32_t chunkIndex = pool.allocateChunk(*backend, allocateFlags, memRequirements.size, &dedicatedInfo);
+		//the whole memory is a single free block - no alignment / granularity padding needed
+		memoryBlock = { VK_NULL_HANDLE,
+			0,
+			memRequirements.size,
+			memRequirements.alignment,
+			memRequirements.size };
+		memoryBlock.linear = linear;
+		freeBlockIndex = 0;
+		return chunkIndex;
+	}
+
+	//find suitable memory chunk
+	uint32_t bestChunkIndex = INVALID_BLOCK_INDEX;
+	for (size_t i = 0; i < pool.memoryChunks.size(); ++i) {
+		MemoryChunk& chunk = pool.memoryChunks[i];
+		if (chunk.dedicated || chunk.defragmentationSource || chunk.currentSize <= memRequirements.size) {
+			continue;
+		}
+		//fullest fit - only chunks with less free memory than the current best are worth searching
+		if (chunkSearchStrategy == ChunkSearchStrategy::FULLEST_FIT && bestChunkIndex != INVALID_BLOCK_INDEX &&
+			chunk.currentSize >= pool.memoryChunks[bestChunkIndex].currentSize) {
+			continue;
+		}
+		MemoryBlock candidateBlock{};
+		uint32_t candidateFreeBlockIndex = INVALID_BLOCK_INDEX;
+		if (chunk.findSuitableMemoryLocation(memRequirements, bufferImageGranularity, linear,
+			candidateBlock, candidateFreeBlockIndex)) {
+			bestChunkIndex = static_cast<uint32_t>(i);
+			memoryBlock = candidateBlock;
+			freeBlockIndex = candidateFreeBlockIndex;
+			if (chunkSearchStrategy == ChunkSearchStrategy::FIRST_FIT) {
+				break;
+			}
 		}
 	}
-	return false;
+	if (bestChunkIndex != INVALID_BLOCK_INDEX) {
+		return bestChunkIndex;
+	}
+
+	//failed to find suitable memory location - add new memory chunk (large enough for the worst alignment & granularity case)
+	VkDeviceSize alignment = std::max<VkDeviceSize>({ memRequirements.alignment, bufferImageGranularity, 1 });
+	VkDeviceSize chunkSize = std::max(pool.defaultChunkSize, alignUp(memRequirements.size, alignment) + alignment + bufferImageGranularity);
+	uint32_t chunkIndex = pool.allocateChunk(*backend, allocateFlags, chunkSize);
+	if (!pool.memoryChunks[chunkIndex].findSuitableMemoryLocation(memRequirements, bufferImageGranularity, linear, memoryBlock, freeBlockIndex)) {
+		throw std::runtime_error("MemoryAllocator::reserveMemoryBlock(): failed to find suitable memory location");
+	}
+	return chunkIndex;
 }
 
 /*
-* helper function for freeImageMemory
+* build HostVisibleMemory of the memory block
 *
-* @param image - image handle bound to the memory to be deallocated
-* @param memoryTypeIndex - index of memoryType used by the image
+* @param pool - memory pool containing the chunk
+* @param chunk - memory chunk containing the block
+* @param memoryBlock - used memory block
+*
+* @return HostVisibleMemory - contain device memory handle, size, offset, mapped pointer
 */
-bool MemoryAllocator::findAndEraseImageMemoryBlock(VkImage image, uint32_t memoryTypeIndex) {
-	//find & remove 
-	for (auto& memoryChunk : memoryPools[memoryTypeIndex].memoryChunks) {
-		auto it = std::find_if(memoryChunk.memoryBlocks.begin(), memoryChunk.memoryBlocks.end(),
-			[&image](const MemoryBlock& memoryBlock) {
-				return image == memoryBlock.handle.imageHandle;
-			});
+MemoryAllocator::HostVisibleMemory MemoryAllocator::getHostVisibleMemory(const MemoryPool& pool,
+	const MemoryChunk& chunk, const MemoryBlock& memoryBlock) const {
+	HostVisibleMemory hostVisibleMemory{};
+	hostVisibleMemory.memory = chunk.memoryHandle;
+	hostVisibleMemory.size = memoryBlock.size;
+	hostVisibleMemory.offset = memoryBlock.offset;
+	hostVisibleMemory.memorySize = chunk.chunkSize;
+	if (chunk.mappedData) {
+		hostVisibleMemory.mappedData = static_cast<uint8_t*>(chunk.mappedData) + memoryBlock.offset;
+	}
+	if ((pool.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+		hostVisibleMemory.nonCoherentAtomSize = nonCoherentAtomSize;
+	}
+	return hostVisibleMemory;
+}
 
-		if (it != memoryChunk.memoryBlocks.end()) {
-			memoryChunk.currentSize += (it->blockEndLocation - it->offset);
-			memoryChunk.memoryBlocks.erase(it);
-			return true;
-		}
+/*
+* helper function for freeBufferMemory / freeImageMemory
+* 
+* @param location - location of the memory block to be deallocated
+*/
+void MemoryAllocator::eraseMemoryBlock(const MemoryBlockLocation& location) {
+	MemoryPool& pool = memoryPools[location.poolIndex];
+	MemoryChunk& chunk = pool.memoryChunks[location.chunkIndex];
+	chunk.freeMemoryBlock(location.blockIndex);
+	pool.freeCount++;
+
+	//dedicated memory is released together with its resource
+	if (chunk.dedicated) {
+		pool.freeChunk(*backend, location.chunkIndex);
 	}
-	return false;
 }
 
 /*
-* pre-allocate big chunk of memory
+* pre-allocate big chunk of memory, or dedicated memory of a single resource
+*
+* @param backend - device calls used for vkAllocateMemory / vkMapMemory
+* @param allocateFlags - memory allocate flags
+* @param chunkSize - size of the device memory
+* @param dedicatedInfo - buffer / image handle if memory is dedicated to it, otherwise nullptr
 *
-* @param device - logical device handle needed for vkAllocateMemory
+* @return uint32_t - index of the new memory chunk
 */
-void MemoryAllocator::MemoryPool::allocateChunk(VkDevice device, VkMemoryAllocateFlags allocateFlags) {
+uint32_t MemoryAllocator::MemoryPool::allocateChunk(MemoryBackend& backend, VkMemoryAllocateFlags allocateFlags,
+	VkDeviceSize chunkSize, const VkMemoryDedicatedAllocateInfo* dedicatedInfo) {
 	VkMemoryAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = defaultChunkSize;
+	allocInfo.allocationSize = chunkSize;
 	allocInfo.memoryTypeIndex = memoryTypeIndex;
+	allocInfo.pNext = dedicatedInfo;
 	VkMemoryAllocateFlagsInfo flagsInfo{};
 	if (allocateFlags & VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT) {
 		flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
 		flagsInfo.flags = allocateFlags;
 		//flagsInfo.deviceMask = 1;
+		flagsInfo.pNext = dedicatedInfo;
 		allocInfo.pNext = &flagsInfo;
 	}
-	MemoryChunk newChunk{ VK_NULL_HANDLE, defaultChunkSize, defaultChunkSize };
-	VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &newChunk.memoryHandle));
-	memoryChunks.push_back(newChunk);
+	VkDeviceMemory memoryHandle = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(backend.allocateMemory(allocInfo, memoryHandle));
+
+	//map host visible chunk once - every block in it shares this pointer
+	void* mappedData = nullptr;
+	if (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		VK_CHECK_RESULT(backend.mapMemory(memoryHandle, &mappedData));
+	}
+
+	//reuse slot of released chunk so that recorded chunk indices stay valid
+	uint32_t chunkIndex = 0;
+	if (!unusedChunkSlots.empty()) {
+		chunkIndex = unusedChunkSlots.back();
+		unusedChunkSlots.pop_back();
+	}
+	else {
+		chunkIndex = static_cast<uint32_t>(memoryChunks.size());
+		memoryChunks.emplace_back();
+	}
+	memoryChunks[chunkIndex].init(memoryHandle, chunkSize, mappedData, dedicatedInfo != nullptr);
+	chunkAllocationCount++;
+	return chunkIndex;
+}
+
+/*
+* release device memory of the chunk - its slot is reused by the next allocateChunk
+*
+* @param backend - device calls used for vkFreeMemory
+* @param chunkIndex - index of the chunk to release
+*/
+void MemoryAllocator::MemoryPool::freeChunk(MemoryBackend& backend, uint32_t chunkIndex) {
+	MemoryChunk& chunk = memoryChunks[chunkIndex];
+	if (chunk.mappedData) {
+		backend.unmapMemory(chunk.memoryHandle);
+	}
+	backend.freeMemory(chunk.memoryHandle);
+	chunk = MemoryChunk{};
+	unusedChunkSlots.push_back(chunkIndex);
+	chunkFreeCount++;
 }
 
 /*
 * clean up all pre-allocated chunk of memory
 *
-* @param device - logical device handle needed for vkAllocateMemory
+* @param backend - device calls used for vkFreeMemory
 * 
 * @return int - number of memoryblocks which are still active
 */
-size_t MemoryAllocator::MemoryPool::cleanup(VkDevice device) {
+size_t MemoryAllocator::MemoryPool::cleanup(MemoryBackend& backend) {
 	size_t activeMemoryNum = 0;
 	for (auto& memoryChunk : memoryChunks) {
-		activeMemoryNum += memoryChunk.memoryBlocks.size();
-		vkFreeMemory(device, memoryChunk.memoryHandle, nullptr);
+		//released slot
+		if (memoryChunk.memoryHandle == VK_NULL_HANDLE) {
+			continue;
+		}
+		activeMemoryNum += memoryChunk.activeBlockCount;
+		if (memoryChunk.mappedData) {
+			backend.unmapMemory(memoryChunk.memoryHandle);
+		}
+		backend.freeMemory(memoryChunk.memoryHandle);
 	}
+	memoryChunks.clear();
+	unusedChunkSlots.clear();
 	return activeMemoryNum;
 }
 
+/*
+* make the whole chunk a single free block
+*
+* @param memoryHandle - device memory allocated by vkAllocateMemory
+* @param chunkSize - size of the device memory
+* @param mappedData - persistently mapped pointer, nullptr if memory is not host visible
+* @param dedicated - true if the memory is dedicated to a single resource
+*/
+void MemoryAllocator::MemoryChunk::init(VkDeviceMemory memoryHandle, VkDeviceSize chunkSize, void* mappedData,
+	bool dedicated) {
+	this->memoryHandle = memoryHandle;
+	this->mappedData = mappedData;
+	this->dedicated = dedicated;
+	this->chunkSize = chunkSize;
+	currentSize = chunkSize;
+	activeBlockCount = 0;
+	paddingSaved = 0;
+	freeBlockCount = 0;
+
+	flBitmap = 0;
+	slBitmaps.assign(FL_INDEX_COUNT, 0);
+	freeListHeads.assign(FL_INDEX_COUNT * SL_INDEX_COUNT, INVALID_BLOCK_INDEX);
+	memoryBlocks.clear();
+	unusedBlockSlots.clear();
+
+	MemoryBlock freeBlock{};
+	freeBlock.offset = 0;
+	freeBlock.size = chunkSize;
+	freeBlock.blockEndLocation = chunkSize;
+	freeBlock.free = true;
+	memoryBlocks.push_back(freeBlock);
+	insertFreeBlock(0);
+}
+
+/*
+* true if the last byte of resource A and the first byte of resource B are on the same page
+*
+* @param resourceAEnd - last byte location of resource A
+* @param resourceBOffset - first byte location of resource B
+* @param pageSize - bufferImageGranularity
+*/
+static inline bool isOnSamePage(VkDeviceSize resourceAEnd, VkDeviceSize resourceBOffset, VkDeviceSize pageSize) {
+	return (resourceAEnd & ~(pageSize - 1)) == (resourceBOffset & ~(pageSize - 1));
+}
+
 /*
 * return suitable memory location (offset) in current memory chunk
+* bufferImageGranularity padding is added only when the previous block is of a different kind (linear / optimal)
 *
 * @param memRequirements
 * @param bufferImageGranularity
+* @param linear - true for buffers & linear tiling images
 * @param memoryBlock - out parameter containing block layout if return value is true
+* @param freeBlockIndex - out parameter, index of the free block containing memoryBlock
 *
 * @return bool - true when found, false when there is none
 */
-bool MemoryAllocator::MemoryChunk::findSuitableMemoryLocation(
-	const VkMemoryRequirements& memRequirements, VkDeviceSize bufferImageGranularity, MemoryBlock& memoryBlock) {
-	//TODO: consider bufferImageGranularity only when linear and non-linear resources are placed in adjacent memory
-	//memory chunk is empty
-	if (memoryBlocks.empty()) {
-		//bufferImageGranularity check
-		VkDeviceSize blockEndLocation = memRequirements.size;
-		if (bufferImageGranularity > memRequirements.alignment) {
-			if (VkDeviceSize remainder = memRequirements.size % bufferImageGranularity; remainder != 0) {
-				VkDeviceSize padding = bufferImageGranularity - remainder;
-				blockEndLocation += padding;
-			}
-		}
-		memoryBlock = { VK_NULL_HANDLE, 0, memRequirements.size, memRequirements.alignment, blockEndLocation };
-		return true;
-	}
-
-	//iterate all memory blocks
-	for (size_t i = 0; i < memoryBlocks.size(); ++i) {
-		VkDeviceSize location = memoryBlocks[i].blockEndLocation;
-		VkDeviceSize blockSize = memRequirements.size;
+bool MemoryAllocator::MemoryChunk::findSuitableMemoryLocation(const VkMemoryRequirements& memRequirements,
+	VkDeviceSize bufferImageGranularity, bool linear, MemoryBlock& memoryBlock, uint32_t& freeBlockIndex) {
+	VkDeviceSize alignment = std::max<VkDeviceSize>(memRequirements.alignment, 1);
+	VkDeviceSize granularity = std::max<VkDeviceSize>(bufferImageGranularity, 1);
 
-		//alignment check
-		if (VkDeviceSize remainder = location % memRequirements.alignment; remainder != 0) {
-			//some padding is added to take account for alignment
-			VkDeviceSize padding = memRequirements.alignment - remainder;
-			location += padding;
-			blockSize += padding;
-		}
+	//worst case - start aligned to the granularity & at least one page left after the end,
+	//so the block never shares a page with the next block whatever kind it is
+	VkDeviceSize searchSize = memRequirements.size + alignment - 1;
+	if (granularity > 1) {
+		searchSize = memRequirements.size + std::max(alignment, granularity) - 1 + granularity - 1;
+	}
 
-		//bufferImageGranularity check
-		if (bufferImageGranularity > memRequirements.alignment) {
-			if (VkDeviceSize remainder = (location + memRequirements.size) % bufferImageGranularity; remainder != 0) {
-				VkDeviceSize padding = bufferImageGranularity - remainder;
-				blockSize += padding;
-			}
-		}
+	//any block in the found list can hold the block even in the worst alignment case
+	freeBlockIndex = findFreeBlock(searchSize);
+	if (freeBlockIndex == INVALID_BLOCK_INDEX) {
+		return false;
+	}
 
-		VkDeviceSize nextBlockEndLocation = (i + 1 == memoryBlocks.size()) ?
-			chunkSize : memoryBlocks[i + 1].offset;
+	const MemoryBlock& freeBlock = memoryBlocks[freeBlockIndex];
+	VkDeviceSize location = alignUp(freeBlock.offset, alignment);
 
-		VkDeviceSize spaceInBetween = nextBlockEndLocation - memoryBlocks[i].blockEndLocation;
-		if (spaceInBetween > blockSize) {
-			memoryBlock = { VK_NULL_HANDLE,
-				location,
-				memRequirements.size,
-				memRequirements.alignment,
-				memoryBlocks[i].blockEndLocation + blockSize };
-			return true;
+	//bufferImageGranularity check - linear & optimal resources can't share a page
+	if (granularity > 1 && freeBlock.prevPhysicalBlock != INVALID_BLOCK_INDEX) {
+		const MemoryBlock& prev = memoryBlocks[freeBlock.prevPhysicalBlock];
+		if (prev.linear != linear && isOnSamePage(prev.offset + prev.size - 1, location, granularity)) {
+			location = alignUp(location, granularity);
 		}
 	}
 
-	return false;
-}
+	memoryBlock = { VK_NULL_HANDLE,
+		location,
+		memRequirements.size,
+		memRequirements.alignment,
+		location + memRequirements.size };
+	memoryBlock.linear = linear;
 
-/*
-* sort memory block vector in real memory location order
-*/
-void MemoryAllocator::MemoryChunk::sort() {
-	std::sort(memoryBlocks.begin(), memoryBlocks.end(),
-		[](const MemoryBlock& l, const MemoryBlock& r) {
-			return l.offset < r.offset;
-		});
+	//padding the block would have taken if every block were aligned & rounded up to the granularity
+	if (granularity > alignment) {
+		VkDeviceSize paddedEnd = alignUp(freeBlock.offset, granularity) + alignUp(memRequirements.size, granularity);
+		memoryBlock.paddingSaved = paddedEnd - memoryBlock.blockEndLocation;
+	}
+	return true;
 }
 
 /*
 * add new memory block to this memory chunk
 *
-* @param device - logical device handle
+* @param backend - device calls used for vkBindBufferMemory
 * @param buffer - buffer handle owning memoryBlock
 * @param memoryBlock - memory block to add
+* @param freeBlockIndex - free block found by findSuitableMemoryLocation
+*
+* @return uint32_t - index of the added block
 */
-void MemoryAllocator::MemoryChunk::addBufferMemoryBlock(VkDevice device, VkBuffer buffer,
-	MemoryBlock& memoryBlock) {
+uint32_t MemoryAllocator::MemoryChunk::addBufferMemoryBlock(MemoryBackend& backend, VkBuffer buffer,
+	MemoryBlock& memoryBlock, uint32_t freeBlockIndex) {
 	memoryBlock.handle.bufferHandle = buffer;
-	memoryBlocks.push_back(memoryBlock);
-	sort();
-	currentSize -= (memoryBlock.blockEndLocation - memoryBlock.offset);
-	vkBindBufferMemory(device, buffer, memoryHandle, memoryBlock.offset);
+	uint32_t blockIndex = insertMemoryBlock(memoryBlock, freeBlockIndex);
+	VK_CHECK_RESULT(backend.bindBufferMemory(buffer, memoryHandle, memoryBlock.offset));
+	return blockIndex;
 }
 
 /*
 * basically same as addBufferMemoryBlock but for VkImage
 *
-* @param device - logical device handle
+* @param backend - device calls used for vkBindImageMemory
 * @param image - image handle owning memoryBlock
 * @param memoryBlock - memory block to add
+* @param freeBlockIndex - free block found by findSuitableMemoryLocation
+*
+* @return uint32_t - index of the added block
 */
-void MemoryAllocator::MemoryChunk::addImageMemoryBlock(VkDevice device, VkImage image,
-	MemoryBlock& memoryBlock) {
+uint32_t MemoryAllocator::MemoryChunk::addImageMemoryBlock(MemoryBackend& backend, VkImage image,
+	MemoryBlock& memoryBlock, uint32_t freeBlockIndex) {
 	memoryBlock.handle.imageHandle = image;
-	memoryBlocks.push_back(memoryBlock);
-	sort();
+	uint32_t blockIndex = insertMemoryBlock(memoryBlock, freeBlockIndex);
+	VK_CHECK_RESULT(backend.bindImageMemory(image, memoryHandle, memoryBlock.offset));
+	return blockIndex;
+}
+
+/*
+* release memory block and merge it with neighbouring free blocks
+*
+* @param blockIndex - index of the block to release
+*/
+void MemoryAllocator::MemoryChunk::freeMemoryBlock(uint32_t blockIndex) {
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	currentSize += (block.blockEndLocation - block.offset);
+	activeBlockCount--;
+	paddingSaved -= block.paddingSaved;
+	block.handle.bufferHandle = VK_NULL_HANDLE;
+	block.free = true;
+	block.linear = false;
+	block.paddingSaved = 0;
+
+	//merge with the previous free block
+	uint32_t prevIndex = block.prevPhysicalBlock;
+	if (prevIndex != INVALID_BLOCK_INDEX && memoryBlocks[prevIndex].free) {
+		removeFreeBlock(prevIndex);
+		MemoryBlock& prev = memoryBlocks[prevIndex];
+		prev.blockEndLocation = block.blockEndLocation;
+		prev.nextPhysicalBlock = block.nextPhysicalBlock;
+		if (block.nextPhysicalBlock != INVALID_BLOCK_INDEX) {
+			memoryBlocks[block.nextPhysicalBlock].prevPhysicalBlock = prevIndex;
+		}
+		unusedBlockSlots.push_back(blockIndex);
+		blockIndex = prevIndex;
+	}
+
+	//merge with the next free block
+	MemoryBlock& merged = memoryBlocks[blockIndex];
+	uint32_t nextIndex = merged.nextPhysicalBlock;
+	if (nextIndex != INVALID_BLOCK_INDEX && memoryBlocks[nextIndex].free) {
+		removeFreeBlock(nextIndex);
+		MemoryBlock& next = memoryBlocks[nextIndex];
+		merged.blockEndLocation = next.blockEndLocation;
+		merged.nextPhysicalBlock = next.nextPhysicalBlock;
+		if (next.nextPhysicalBlock != INVALID_BLOCK_INDEX) {
+			memoryBlocks[next.nextPhysicalBlock].prevPhysicalBlock = blockIndex;
+		}
+		unusedBlockSlots.push_back(nextIndex);
+	}
+
+	merged.size = merged.blockEndLocation - merged.offset;
+	merged.alignment = 0;
+	insertFreeBlock(blockIndex);
+}
+
+/*
+* split used range off the free block - remaining front / back ranges become new free blocks
+*
+* @param memoryBlock - used block layout computed by findSuitableMemoryLocation
+* @param freeBlockIndex - free block containing memoryBlock
+*
+* @return uint32_t - index of the used block
+*/
+uint32_t MemoryAllocator::MemoryChunk::insertMemoryBlock(MemoryBlock& memoryBlock, uint32_t freeBlockIndex) {
+	removeFreeBlock(freeBlockIndex);
+	VkDeviceSize freeBegin = memoryBlocks[freeBlockIndex].offset;
+	VkDeviceSize freeEnd = memoryBlocks[freeBlockIndex].blockEndLocation;
+
+	//front padding caused by alignment
+	if (memoryBlock.offset > freeBegin) {
+		uint32_t frontIndex = createBlockSlot();
+		MemoryBlock& front = memoryBlocks[frontIndex];
+		MemoryBlock& block = memoryBlocks[freeBlockIndex];
+		front = MemoryBlock{};
+		front.offset = freeBegin;
+		front.blockEndLocation = memoryBlock.offset;
+		front.size = front.blockEndLocation - front.offset;
+		front.free = true;
+		front.prevPhysicalBlock = block.prevPhysicalBlock;
+		front.nextPhysicalBlock = freeBlockIndex;
+		if (block.prevPhysicalBlock != INVALID_BLOCK_INDEX) {
+			memoryBlocks[block.prevPhysicalBlock].nextPhysicalBlock = frontIndex;
+		}
+		block.prevPhysicalBlock = frontIndex;
+		insertFreeBlock(frontIndex);
+	}
+
+	//remaining range after the used block
+	if (memoryBlock.blockEndLocation < freeEnd) {
+		uint32_t backIndex = createBlockSlot();
+		MemoryBlock& back = memoryBlocks[backIndex];
+		MemoryBlock& block = memoryBlocks[freeBlockIndex];
+		back = MemoryBlock{};
+		back.offset = memoryBlock.blockEndLocation;
+		back.blockEndLocation = freeEnd;
+		back.size = back.blockEndLocation - back.offset;
+		back.free = true;
+		back.prevPhysicalBlock = freeBlockIndex;
+		back.nextPhysicalBlock = block.nextPhysicalBlock;
+		if (block.nextPhysicalBlock != INVALID_BLOCK_INDEX) {
+			memoryBlocks[block.nextPhysicalBlock].prevPhysicalBlock = backIndex;
+		}
+		block.nextPhysicalBlock = backIndex;
+		insertFreeBlock(backIndex);
+	}
+
+	MemoryBlock& block = memoryBlocks[freeBlockIndex];
+	block.handle = memoryBlock.handle;
+	block.offset = memoryBlock.offset;
+	block.size = memoryBlock.size;
+	block.alignment = memoryBlock.alignment;
+	block.blockEndLocation = memoryBlock.blockEndLocation;
+	block.free = false;
+	block.linear = memoryBlock.linear;
+	block.paddingSaved = memoryBlock.paddingSaved;
+
 	currentSize -= (memoryBlock.blockEndLocation - memoryBlock.offset);
-	vkBindImageMemory(device, image, memoryHandle, memoryBlock.offset);
+	paddingSaved += memoryBlock.paddingSaved;
+	activeBlockCount++;
+	return freeBlockIndex;
+}
+
+/*
+* get unused slot in memoryBlocks (reuse slot of merged blocks if possible)
+*
+* @return uint32_t - index of the slot
+*/
+uint32_t MemoryAllocator::MemoryChunk::createBlockSlot() {
+	if (!unusedBlockSlots.empty()) {
+		uint32_t blockIndex = unusedBlockSlots.back();
+		unusedBlockSlots.pop_back();
+		return blockIndex;
+	}
+	memoryBlocks.emplace_back();
+	return static_cast<uint32_t>(memoryBlocks.size() - 1);
+}
+
+/*
+* compute free list indices of the given size
+*
+* @param size - block size
+* @param fl - out parameter, first level index (power of 2 range)
+* @param sl - out parameter, second level index (linear subdivision of the first level range)
+*/
+void MemoryAllocator::MemoryChunk::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+	if (size < SMALL_BLOCK_SIZE) {
+		fl = 0;
+		sl = static_cast<uint32_t>(size);
+		return;
+	}
+	uint32_t msb = findLastSetBit(size);
+	fl = msb - SL_INDEX_COUNT_LOG2 + 1;
+	sl = static_cast<uint32_t>(size >> (msb - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+}
+
+/*
+* find free block which is large enough to hold the given size
+*
+* @param size - required size
+*
+* @return uint32_t - index of the found free block, INVALID_BLOCK_INDEX if there is none
+*/
+uint32_t MemoryAllocator::MemoryChunk::findFreeBlock(VkDeviceSize size) const {
+	//round up to the next list so that every block in the list is large enough
+	VkDeviceSize searchSize = size;
+	if (searchSize >= SMALL_BLOCK_SIZE) {
+		searchSize += (VkDeviceSize(1) << (findLastSetBit(searchSize) - SL_INDEX_COUNT_LOG2)) - 1;
+	}
+
+	uint32_t fl = 0, sl = 0;
+	mapping(searchSize, fl, sl);
+	if (fl < FL_INDEX_COUNT) {
+		//search current first level
+		uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+		if (slMap == 0) {
+			//search larger first levels
+			uint64_t flMap = (fl + 1 < 64) ? (flBitmap & (~uint64_t(0) << (fl + 1))) : 0;
+			if (flMap != 0) {
+				fl = findFirstSetBit(flMap);
+				slMap = slBitmaps[fl];
+			}
+		}
+		if (slMap != 0) {
+			sl = findFirstSetBit(slMap);
+			return freeListHeads[fl * SL_INDEX_COUNT + sl];
+		}
+	}
+
+	//rounding up may skip blocks in the exact list that still fit - check them before giving up
+	mapping(size, fl, sl);
+	uint32_t blockIndex = freeListHeads[fl * SL_INDEX_COUNT + sl];
+	while (blockIndex != INVALID_BLOCK_INDEX) {
+		if (memoryBlocks[blockIndex].size >= size) {
+			return blockIndex;
+		}
+		blockIndex = memoryBlocks[blockIndex].nextFreeBlock;
+	}
+	return INVALID_BLOCK_INDEX;
+}
+
+/*
+* push free block to the head of its free list
+*
+* @param blockIndex - index of the free block
+*/
+void MemoryAllocator::MemoryChunk::insertFreeBlock(uint32_t blockIndex) {
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	uint32_t fl = 0, sl = 0;
+	mapping(block.size, fl, sl);
+	uint32_t& head = freeListHeads[fl * SL_INDEX_COUNT + sl];
+
+	block.prevFreeBlock = INVALID_BLOCK_INDEX;
+	block.nextFreeBlock = head;
+	if (head != INVALID_BLOCK_INDEX) {
+		memoryBlocks[head].prevFreeBlock = blockIndex;
+	}
+	head = blockIndex;
+	freeBlockCount++;
+
+	flBitmap |= (uint64_t(1) << fl);
+	slBitmaps[fl] |= (1u << sl);
+}
+
+/*
+* unlink free block from its free list
+*
+* @param blockIndex - index of the free block
+*/
+void MemoryAllocator::MemoryChunk::removeFreeBlock(uint32_t blockIndex) {
+	MemoryBlock& block = memoryBlocks[blockIndex];
+	uint32_t fl = 0, sl = 0;
+	mapping(block.size, fl, sl);
+
+	if (block.prevFreeBlock != INVALID_BLOCK_INDEX) {
+		memoryBlocks[block.prevFreeBlock].nextFreeBlock = block.nextFreeBlock;
+	}
+	if (block.nextFreeBlock != INVALID_BLOCK_INDEX) {
+		memoryBlocks[block.nextFreeBlock].prevFreeBlock = block.prevFreeBlock;
+	}
+
+	uint32_t& head = freeListHeads[fl * SL_INDEX_COUNT + sl];
+	if (head == blockIndex) {
+		head = block.nextFreeBlock;
+		//list became empty
+		if (head == INVALID_BLOCK_INDEX) {
+			slBitmaps[fl] &= ~(1u << sl);
+			if (slBitmaps[fl] == 0) {
+				flBitmap &= ~(uint64_t(1) << fl);
+			}
+		}
+	}
+	block.prevFreeBlock = INVALID_BLOCK_INDEX;
+	block.nextFreeBlock = INVALID_BLOCK_INDEX;
+	freeBlockCount--;
+}
+
+/*
+* size of the largest free block - only the highest non-empty free list is searched
+*
+* @return VkDeviceSize - 0 if the chunk is full
+*/
+VkDeviceSize MemoryAllocator::MemoryChunk::getLargestFreeRange() const {
+	if (flBitmap == 0) {
+		return 0;
+	}
+	uint32_t fl = findLastSetBit(flBitmap);
+	uint32_t sl = findLastSetBit(slBitmaps[fl]);
+	VkDeviceSize largest = 0;
+	uint32_t blockIndex = freeListHeads[fl * SL_INDEX_COUNT + sl];
+	while (blockIndex != INVALID_BLOCK_INDEX) {
+		largest = std::max(largest, memoryBlocks[blockIndex].size);
+		blockIndex = memoryBlocks[blockIndex].nextFreeBlock;
+	}
+	return largest;
 }
 
 /*
 * memcpy bufferData to device memory
 * 
-* @param device - logical device  handle needed for vkMapMemory
+* @param device - logical device handle needed for flushing non-coherent memory
 * @param bufferData - data to be copied
 */
 void MemoryAllocator::HostVisibleMemory::mapData(VkDevice device, const void* bufferData) {
-	void* data;
-	vkMapMemory(device, memory, offset, size, 0, &data);
-	memcpy(data, bufferData, (size_t)size);
-	vkUnmapMemory(device, memory);
+	memcpy(mappedData, bufferData, (size_t)size);
+	flush(device);
 }
 
 /*
-* return data pointer
+* return data pointer - chunk is already mapped, no vkMapMemory call
 * 
 * @return void* - data pointer
 */
-void* MemoryAllocator::HostVisibleMemory::getHandle(VkDevice device) {
-	void* data;
-	vkMapMemory(device, memory, offset, size, 0, &data);
-	return data;
+void* MemoryAllocator::HostVisibleMemory::getHandle() {
+	return mappedData;
 }
 
 /*
-* unmap memory - vkUnmapMemory
+* memory stays mapped until its chunk is freed - just flush host writes
 */
 void MemoryAllocator::HostVisibleMemory::unmap(VkDevice device) {
-	vkUnmapMemory(device, memory);
+	flush(device);
+}
+
+/*
+* vkFlushMappedMemoryRanges - make host writes visible to the device
+*
+* @param device - logical device handle
+* @param rangeOffset - offset relative to the beginning of this memory block
+* @param rangeSize - size of the range to flush, VK_WHOLE_SIZE for the rest of the block
+*/
+void MemoryAllocator::HostVisibleMemory::flush(VkDevice device, VkDeviceSize rangeOffset, VkDeviceSize rangeSize) {
+	if (nonCoherentAtomSize == 0) {
+		return;
+	}
+	VkMappedMemoryRange range = getMappedMemoryRange(rangeOffset, rangeSize);
+	VK_CHECK_RESULT(vkFlushMappedMemoryRanges(device, 1, &range));
+}
+
+/*
+* vkInvalidateMappedMemoryRanges - make device writes visible to the host
+*
+* @param device - logical device handle
+* @param rangeOffset - offset relative to the beginning of this memory block
+* @param rangeSize - size of the range to invalidate, VK_WHOLE_SIZE for the rest of the block
+*/
+void MemoryAllocator::HostVisibleMemory::invalidate(VkDevice device, VkDeviceSize rangeOffset, VkDeviceSize rangeSize) {
+	if (nonCoherentAtomSize == 0) {
+		return;
+	}
+	VkMappedMemoryRange range = getMappedMemoryRange(rangeOffset, rangeSize);
+	VK_CHECK_RESULT(vkInvalidateMappedMemoryRanges(device, 1, &range));
+}
+
+/*
+* build memory range aligned to nonCoherentAtomSize
+* neighbouring blocks may be touched by the aligned range, which is harmless for flush / invalidate
+*
+* @param rangeOffset - offset relative to the beginning of this memory block
+* @param rangeSize - size of the range, VK_WHOLE_SIZE for the rest of the block
+*
+* @return VkMappedMemoryRange - range relative to the beginning of the device memory
+*/
+VkMappedMemoryRange MemoryAllocator::HostVisibleMemory::getMappedMemoryRange(VkDeviceSize rangeOffset, VkDeviceSize rangeSize) const {
+	if (rangeSize == VK_WHOLE_SIZE) {
+		rangeSize = size - rangeOffset;
+	}
+	VkDeviceSize begin = (offset + rangeOffset) / nonCoherentAtomSize * nonCoherentAtomSize;
+	VkDeviceSize end = alignUp(offset + rangeOffset + rangeSize, nonCoherentAtomSize);
+
+	VkMappedMemoryRange range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+	range.memory = memory;
+	range.offset = begin;
+	//range reaching the end of the memory doesn't have to be a multiple of nonCoherentAtomSize
+	range.size = (end >= memorySize) ? VK_WHOLE_SIZE : end - begin;
+	return range;
 }
@@ -1,21 +1,56 @@
 #pragma once
-#include "vulkan_utils.h"
+#include <unordered_map>
+#include <string>
+#include <functional>
+#include <fstream>
+#include "vulkan_memory_backend.h"
 
 /*
 	* Custom memory allocator is implemented to deal with device memory allocation limit in a very NAIVE way
-	* There is no defragmentation feature or fancy algorithm for memory block searching
+	* Registered resources can be moved out of sparsely used chunks by the incremental defragmenter
+	* Resources which prefer / require dedicated allocation or are larger than half of a chunk get their own device memory
+	* Free ranges of each chunk are searched in O(1) by two-level segregated fit (TLSF) free lists
+	* Device calls go through MemoryBackend, so recorded allocation traces can be replayed offline
 */
 class MemoryAllocator {
 public:
-	/** contain all info needed for data mapping */
+	/** invalid memory block index */
+	static constexpr uint32_t INVALID_BLOCK_INDEX = UINT32_MAX;
+
+	/** resources of different lifetime never share a memory chunk */
+	enum class MemoryLifetime : uint32_t {
+		/** scene buffers, textures, acceleration structures - live until the app ends */
+		STATIC = 0,
+		/** swapchain-sized images - destroyed & recreated on every resize */
+		RESOLUTION_DEPENDENT,
+		COUNT
+	};
+
+	/** order in which existing chunks of a pool are searched for a free range */
+	enum class ChunkSearchStrategy : uint32_t {
+		/** oldest chunk first */
+		FIRST_FIT = 0,
+		/** chunk with the least free memory first - keeps sparse chunks empty so they can be released */
+		FULLEST_FIT,
+		COUNT
+	};
+
+	/*
+	* contain all info needed for data mapping
+	* host visible chunks are mapped once when they are allocated, so the pointer stays valid until the block is freed
+	*/
 	struct HostVisibleMemory {
 	public:
-		/** @brief memcpy bufferData to device memory */
+		/** @brief memcpy bufferData to device memory (flushed if memory is not coherent) */
 		void mapData(VkDevice device, const void* bufferData);
-		/** @brief return data pointer */
-		void* getHandle(VkDevice device);
-		/** @brief vkUnmapMemory */
+		/** @brief return persistently mapped data pointer */
+		void* getHandle();
+		/** @brief finish host writes - memory stays mapped, only flushes non-coherent memory */
 		void unmap(VkDevice device);
+		/** @brief make host writes visible to the device (no-op for coherent memory) */
+		void flush(VkDevice device, VkDeviceSize rangeOffset = 0, VkDeviceSize rangeSize = VK_WHOLE_SIZE);
+		/** @brief make device writes visible to the host (no-op for coherent memory) */
+		void invalidate(VkDevice device, VkDeviceSize rangeOffset = 0, VkDeviceSize rangeSize = VK_WHOLE_SIZE);
 
 		/** device memory handle */
 		VkDeviceMemory memory = VK_NULL_HANDLE;
@@ -23,28 +58,139 @@ public:
 		VkDeviceSize size = 0;
 		/** offset where this memory block begins */
 		VkDeviceSize offset = 0;
+		/** mapped pointer to the beginning of this memory block (chunk base + offset) */
+		void* mappedData = nullptr;
+		/** size of the whole device memory - flush / invalidate range can't exceed it */
+		VkDeviceSize memorySize = 0;
+		/** 0 if memory is host coherent, otherwise VkPhysicalDeviceLimits::nonCoherentAtomSize */
+		VkDeviceSize nonCoherentAtomSize = 0;
+
+	private:
+		/** @brief build memory range aligned to nonCoherentAtomSize */
+		VkMappedMemoryRange getMappedMemoryRange(VkDeviceSize rangeOffset, VkDeviceSize rangeSize) const;
+	};
+
+	/** used / free info of a single chunk (device memory) */
+	struct ChunkStatistics {
+		VkDeviceSize size = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize freeBytes = 0;
+		/** the largest resource which fits without allocating new memory (before alignment) */
+		VkDeviceSize largestFreeRange = 0;
+		size_t usedBlockCount = 0;
+		size_t freeBlockCount = 0;
+		/** true if the chunk is dedicated memory of a single resource */
+		bool dedicated = false;
+	};
+
+	/** sum of the chunk statistics of a memory pool & its counters */
+	struct PoolStatistics {
+		uint32_t memoryTypeIndex = 0;
+		uint32_t heapIndex = 0;
+		VkMemoryPropertyFlags propertyFlags = 0;
+		MemoryLifetime lifetime = MemoryLifetime::STATIC;
+		/** size of all device memory of this pool */
+		VkDeviceSize allocatedBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize largestFreeRange = 0;
+		size_t usedBlockCount = 0;
+		size_t freeBlockCount = 0;
+		/** number of buffer / image memory allocations & frees since init */
+		uint64_t allocationCount = 0;
+		uint64_t freeCount = 0;
+		/** number of vkAllocateMemory / vkFreeMemory calls since init */
+		uint64_t chunkAllocationCount = 0;
+		uint64_t chunkFreeCount = 0;
+		std::vector<ChunkStatistics> chunks;
+	};
+
+	/** memory heap usage - budget & usage come from VK_EXT_memory_budget if it is enabled */
+	struct HeapStatistics {
+		VkDeviceSize size = 0;
+		VkMemoryHeapFlags flags = 0;
+		/** device memory allocated by this allocator */
+		VkDeviceSize allocatedBytes = 0;
+		/** how much the process can allocate from the heap - heap size if the budget is unknown */
+		VkDeviceSize budget = 0;
+		/** current usage of the process - allocatedBytes if the budget is unknown */
+		VkDeviceSize usage = 0;
+	};
+
+	/** snapshot of the whole allocator */
+	struct Statistics {
+		/** pools which have allocated device memory at least once */
+		std::vector<PoolStatistics> pools;
+		std::vector<HeapStatistics> heaps;
+		/** true if heap budget & usage are queried from VK_EXT_memory_budget */
+		bool memoryBudgetEnabled = false;
+		VkDeviceSize allocatedBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize granularityPaddingSaved = 0;
+		uint64_t allocationCount = 0;
+		uint64_t freeCount = 0;
+		uint64_t chunkAllocationCount = 0;
+		uint64_t chunkFreeCount = 0;
 	};
 
-	void init(VkDevice device, VkDeviceSize bufferImageGranularity,
+	void init(VkDevice device, VkDeviceSize bufferImageGranularity, VkDeviceSize nonCoherentAtomSize,
 		const VkPhysicalDeviceMemoryProperties& memProperties, VkMemoryAllocateFlags allocateFlags = 0,
 		uint32_t defaultChunkSize = 268435000); //256 MiB
+	/** @brief init with custom device calls (e.g. FakeMemoryBackend for offline simulation) */
+	void init(MemoryBackend* backend, VkDeviceSize bufferImageGranularity, VkDeviceSize nonCoherentAtomSize,
+		const VkPhysicalDeviceMemoryProperties& memProperties, VkMemoryAllocateFlags allocateFlags = 0,
+		uint32_t defaultChunkSize = 268435000);
 	/** @brief free all allocated memory */
 	void cleanup();
 	/** @brief suballocation - add new (buffer) memory block */
-	HostVisibleMemory allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties);
+	HostVisibleMemory allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties,
+		MemoryLifetime lifetime = MemoryLifetime::STATIC);
 	/** @brief suballocation - add new (image) memory block */
-	HostVisibleMemory allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties);
+	HostVisibleMemory allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties,
+		MemoryLifetime lifetime = MemoryLifetime::STATIC, VkImageTiling tiling = VK_IMAGE_TILING_OPTIMAL);
+	/** @brief bytes of bufferImageGranularity padding avoided by linear / optimal tracking */
+	VkDeviceSize getGranularityPaddingSaved() const;
+	/** @brief release chunks of the given lifetime which have no active memory block */
+	void releaseEmptyChunks(MemoryLifetime lifetime);
+	/** @brief query heap budget & usage from VK_EXT_memory_budget (the extension must be enabled) */
+	void enableMemoryBudget(VkPhysicalDevice physicalDevice);
+	/** @brief collect per pool / chunk usage, counters & heap budget */
+	Statistics getStatistics() const;
+	/** @brief write statistics snapshot to a json file */
+	void dumpStatistics(const std::string& path) const;
+	/** @brief select order in which existing chunks are searched */
+	void setChunkSearchStrategy(ChunkSearchStrategy strategy) { chunkSearchStrategy = strategy; }
+	/** @brief record every allocation & free to a text file for allocator_replay */
+	void startTrace(const std::string& path);
+	/** @brief close the trace file */
+	void stopTrace();
+
+	/** called with the new handle after the resource is moved - owner updates views, descriptors & device addresses */
+	using BufferMovedCallback = std::function<void(VkBuffer newBuffer)>;
+	using ImageMovedCallback = std::function<void(VkImage newImage)>;
+	/** @brief allow the defragmenter to move the buffer (read-only on the device, TRANSFER_SRC usage) */
+	void registerMovableBuffer(VkBuffer buffer, const VkBufferCreateInfo& createInfo, BufferMovedCallback onMoved);
+	/** @brief allow the defragmenter to move the image (read-only on the device, TRANSFER_SRC usage) */
+	void registerMovableImage(VkImage image, const VkImageCreateInfo& createInfo, VkImageLayout layout,
+		VkImageAspectFlags aspectMask, ImageMovedCallback onMoved);
+	/** @brief plan moves of the registered resources out of sparsely used chunks */
+	size_t beginDefragmentation();
+	/** @brief record copies of the planned moves up to the byte budget */
+	VkDeviceSize recordDefragmentationPass(VkCommandBuffer commandBuffer, VkDeviceSize byteBudget);
+	/** @brief finish moves recorded by the last pass - its command buffer must be completed */
+	size_t endDefragmentationPass();
+	/** @brief true if there are planned moves left */
+	bool isDefragmenting() const { return !defragmentationMoves.empty(); }
 
 	/** @brief free (buffer) memory block */
-	void freeBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM);
+	void freeBufferMemory(VkBuffer buffer);
 	/** @brief free (image) memory block */
-	void freeImageMemory(VkImage image, VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_FLAG_BITS_MAX_ENUM);
+	void freeImageMemory(VkImage image);
 	/** @brief return suitable memory type */
 	static uint32_t findMemoryType(uint32_t memoryTypeBitsRequirements,
 		VkMemoryPropertyFlags requiredProperties, const VkPhysicalDeviceMemoryProperties& memProperties);
 
 private:
-	/** small memory chunk reside in MemoryChunk */
+	/** small memory chunk reside in MemoryChunk (either bound to a resource or free) */
 	struct MemoryBlock {
 		union Handle{
 			VkBuffer bufferHandle = VK_NULL_HANDLE;
@@ -55,56 +201,211 @@ private:
 		VkDeviceSize offset = 0;
 		VkDeviceSize size = 0;
 		VkDeviceSize alignment = 0;
-		/** byte location divisible by alignment, also divisible by bufferImageGranularity */
+		/** end of the block - next block starts at or after this location */
 		VkDeviceSize blockEndLocation = 0;
+
+		/** true if this block is in the free list */
+		bool free = false;
+		/** buffer or linear tiling image - bufferImageGranularity applies only between linear & optimal neighbours */
+		bool linear = false;
+		/** bufferImageGranularity padding this block doesn't need compared to always rounding up to the granularity */
+		VkDeviceSize paddingSaved = 0;
+		/** neighbouring blocks in real memory location order */
+		uint32_t prevPhysicalBlock = INVALID_BLOCK_INDEX;
+		uint32_t nextPhysicalBlock = INVALID_BLOCK_INDEX;
+		/** neighbouring blocks in the same segregated free list */
+		uint32_t prevFreeBlock = INVALID_BLOCK_INDEX;
+		uint32_t nextFreeBlock = INVALID_BLOCK_INDEX;
 	};
 
-	/** allocated memory block by vkAllocateMemory call */
+	/*
+	* allocated memory block by vkAllocateMemory call
+	* free ranges are managed by two-level segregated fit (TLSF) free lists
+	*/
 	struct MemoryChunk {
+		/** @brief make the whole chunk a single free block */
+		void init(VkDeviceMemory memoryHandle, VkDeviceSize chunkSize, void* mappedData, bool dedicated);
 		/** @brief return suitable memory location (offset) in current memory chunk */
 		bool findSuitableMemoryLocation(const VkMemoryRequirements& memRequirements,
-			VkDeviceSize bufferImageGranularity, MemoryBlock& memoryBlock);
-		/** @brief sort memory block vector in real memory location order (offset) */
-		void sort();
+			VkDeviceSize bufferImageGranularity, bool linear, MemoryBlock& memoryBlock, uint32_t& freeBlockIndex);
 		/** @brief add new buffer memory block to this memory chunk */
-		void addBufferMemoryBlock(VkDevice device, VkBuffer buffer, MemoryBlock& memoryBlock);
+		uint32_t addBufferMemoryBlock(MemoryBackend& backend, VkBuffer buffer,
+			MemoryBlock& memoryBlock, uint32_t freeBlockIndex);
 		/** @brief add new image memory block to this memory chunk */
-		void addImageMemoryBlock(VkDevice device, VkImage image, MemoryBlock& memoryBlock);
+		uint32_t addImageMemoryBlock(MemoryBackend& backend, VkImage image,
+			MemoryBlock& memoryBlock, uint32_t freeBlockIndex);
+		/** @brief release memory block and merge it with neighbouring free blocks */
+		void freeMemoryBlock(uint32_t blockIndex);
+		/** @brief size of the largest free block */
+		VkDeviceSize getLargestFreeRange() const;
 
 		VkDeviceMemory memoryHandle = VK_NULL_HANDLE;
+		/** persistently mapped pointer to the whole chunk - nullptr if memory is not host visible */
+		void* mappedData = nullptr;
+		/** true if this chunk is dedicated memory of a single resource (VK_KHR_dedicated_allocation) */
+		bool dedicated = false;
+		/** true while the defragmenter empties this chunk - no new block is placed in it */
+		bool defragmentationSource = false;
 		VkDeviceSize chunkSize = 0;
 		VkDeviceSize currentSize = 0;
+		/** number of blocks bound to buffers / images */
+		size_t activeBlockCount = 0;
+		/** sum of paddingSaved of the active blocks */
+		VkDeviceSize paddingSaved = 0;
+		/** number of blocks in the free lists */
+		size_t freeBlockCount = 0;
+		/** used & free blocks - linked to each other by indices */
 		std::vector<MemoryBlock> memoryBlocks;
+
+	private:
+		/** second level index count (log2) - each first level range is split into 16 lists */
+		static constexpr uint32_t SL_INDEX_COUNT_LOG2 = 4;
+		static constexpr uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+		/** blocks smaller than this are all stored in the first level 0 */
+		static constexpr VkDeviceSize SMALL_BLOCK_SIZE = 1 << SL_INDEX_COUNT_LOG2;
+		static constexpr uint32_t FL_INDEX_COUNT = 64 - SL_INDEX_COUNT_LOG2 + 1;
+
+		/** @brief split used range off the free block */
+		uint32_t insertMemoryBlock(MemoryBlock& memoryBlock, uint32_t freeBlockIndex);
+		/** @brief get unused slot in memoryBlocks */
+		uint32_t createBlockSlot();
+		/** @brief compute free list indices of the given size */
+		static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+		/** @brief find free block which is large enough to hold the given size */
+		uint32_t findFreeBlock(VkDeviceSize size) const;
+		/** @brief push free block to the head of its free list */
+		void insertFreeBlock(uint32_t blockIndex);
+		/** @brief unlink free block from its free list */
+		void removeFreeBlock(uint32_t blockIndex);
+
+		/** first level bitmap - bit is set if any list of that level is not empty */
+		uint64_t flBitmap = 0;
+		/** second level bitmaps */
+		std::vector<uint32_t> slBitmaps;
+		/** head block of each free list (FL_INDEX_COUNT * SL_INDEX_COUNT) */
+		std::vector<uint32_t> freeListHeads;
+		/** indices of memoryBlocks elements which are not used by any block */
+		std::vector<uint32_t> unusedBlockSlots;
 	};
 
 	/** allocated memory block by vkAllocateMemory */
 	struct MemoryPool {
-		/** @brief pre-allocate big chunk of memory */
-		void allocateChunk(VkDevice device, VkMemoryAllocateFlags allocateFlags);
+		/** @brief pre-allocate big chunk of memory (or dedicated memory of a single resource) */
+		uint32_t allocateChunk(MemoryBackend& backend, VkMemoryAllocateFlags allocateFlags, VkDeviceSize chunkSize,
+			const VkMemoryDedicatedAllocateInfo* dedicatedInfo = nullptr);
+		/** @brief release device memory of the chunk */
+		void freeChunk(MemoryBackend& backend, uint32_t chunkIndex);
 		/** @brief clean up all pre-allocated chunk of memory */
-		size_t cleanup(VkDevice device);
+		size_t cleanup(MemoryBackend& backend);
 
 		/** default block size -> 256 MiB */
 		VkDeviceSize defaultChunkSize = 0;
 		/** index of memory type defined in device memory properties */
 		uint32_t memoryTypeIndex = -1;
+		/** property flags of the memory type - host visible chunks are persistently mapped */
+		VkMemoryPropertyFlags propertyFlags = 0;
+		/** lifetime of resources placed in this pool */
+		MemoryLifetime lifetime = MemoryLifetime::STATIC;
 		/** vector of pre-allocated memories */
 		std::vector<MemoryChunk> memoryChunks;
+		/** indices of memoryChunks elements whose device memory is released */
+		std::vector<uint32_t> unusedChunkSlots;
+		/** number of buffer / image memory allocations & frees */
+		uint64_t allocationCount = 0;
+		uint64_t freeCount = 0;
+		/** number of vkAllocateMemory / vkFreeMemory calls */
+		uint64_t chunkAllocationCount = 0;
+		uint64_t chunkFreeCount = 0;
 	};
 
 	/** device memory properties */
 	VkPhysicalDeviceMemoryProperties memProperties;
-	/** logical device handle used for memory allocation */
-	VkDevice device = VK_NULL_HANDLE;
+	/** device calls of the logical device passed to init */
+	VulkanMemoryBackend vulkanBackend;
+	/** device calls used for memory allocation - &vulkanBackend or a custom backend */
+	MemoryBackend* backend = nullptr;
+	/** order in which existing chunks are searched */
+	ChunkSearchStrategy chunkSearchStrategy = ChunkSearchStrategy::FIRST_FIT;
+	/** allocation trace - not open if no trace is being recorded */
+	std::ofstream traceFile;
 	/** used for chunk size */
 	VkDeviceSize bufferImageGranularity = 0;
-	/** memory pools for each memory types */
+	/** flush / invalidate range alignment of non-coherent memory */
+	VkDeviceSize nonCoherentAtomSize = 1;
+	/** memory pools for each lifetime & memory type - index : lifetime * memoryTypeCount + memoryTypeIndex */
 	std::vector<MemoryPool> memoryPools;
 	/** memory allocate flags - used for vkAllocateMemory */
 	VkMemoryAllocateFlags allocateFlags = 0;
+	/** physical device used for VK_EXT_memory_budget query - VK_NULL_HANDLE if the extension is not enabled */
+	VkPhysicalDevice budgetPhysicalDevice = VK_NULL_HANDLE;
+
+	/** location of the memory block bound to a buffer / image */
+	struct MemoryBlockLocation {
+		uint32_t poolIndex = 0;
+		uint32_t chunkIndex = 0;
+		uint32_t blockIndex = INVALID_BLOCK_INDEX;
+	};
+	/** buffer handle -> memory block location */
+	std::unordered_map<VkBuffer, MemoryBlockLocation> bufferMemoryBlocks;
+	/** image handle -> memory block location */
+	std::unordered_map<VkImage, MemoryBlockLocation> imageMemoryBlocks;
+
+	/** create info & owner callback of a buffer the defragmenter may move */
+	struct MovableBuffer {
+		VkBufferCreateInfo createInfo{};
+		std::vector<uint32_t> queueFamilyIndices;
+		BufferMovedCallback onMoved;
+	};
+	/** create info, layout & owner callback of an image the defragmenter may move */
+	struct MovableImage {
+		VkImageCreateInfo createInfo{};
+		std::vector<uint32_t> queueFamilyIndices;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		ImageMovedCallback onMoved;
+	};
+	std::unordered_map<VkBuffer, MovableBuffer> movableBuffers;
+	std::unordered_map<VkImage, MovableImage> movableImages;
+
+	/** copy of a resource to the new handle bound at its new location */
+	struct DefragmentationMove {
+		bool image = false;
+		VkBuffer srcBuffer = VK_NULL_HANDLE;
+		VkBuffer dstBuffer = VK_NULL_HANDLE;
+		VkImage srcImage = VK_NULL_HANDLE;
+		VkImage dstImage = VK_NULL_HANDLE;
+		/** byte size counted against the pass budget */
+		VkDeviceSize size = 0;
+	};
+	/** planned moves - the first recordedMoveCount moves are recorded by the current pass */
+	std::vector<DefragmentationMove> defragmentationMoves;
+	size_t recordedMoveCount = 0;
+	/** chunks the plan empties - released once their last block is moved */
+	std::vector<std::pair<uint32_t, uint32_t>> defragmentationSourceChunks;
 
-	/** @brief helper function for freeBufferMemory */
-	bool findAndEraseBufferMemoryBlock(VkBuffer buffer, uint32_t memoryTypeIndex);
-	/** @brief helper function for freeImageMemory */
-	bool findAndEraseImageMemoryBlock(VkImage image, uint32_t memoryTypeIndex);
+	/** @brief create the buffer again & bind it to one of the destination chunks */
+	bool planBufferMove(VkBuffer buffer, uint32_t poolIndex, const std::vector<uint32_t>& dstChunks,
+		DefragmentationMove& move);
+	/** @brief create the image again & bind it to one of the destination chunks */
+	bool planImageMove(VkImage image, uint32_t poolIndex, const std::vector<uint32_t>& dstChunks,
+		DefragmentationMove& move);
+	/** @brief find free range for the moved resource in the destination chunks */
+	bool findMoveDestination(uint32_t poolIndex, const std::vector<uint32_t>& dstChunks,
+		const VkMemoryRequirements& memRequirements, bool linear,
+		uint32_t& chunkIndex, MemoryBlock& memoryBlock, uint32_t& freeBlockIndex);
+	/** @brief release destination block & handle of a move which won't happen */
+	void cancelMove(size_t moveIndex);
+	/** @brief find (or allocate) memory chunk and reserve memory block for the resource */
+	uint32_t reserveMemoryBlock(const VkMemoryRequirements& memRequirements,
+		const VkMemoryDedicatedRequirements& dedicatedRequirements, const VkMemoryDedicatedAllocateInfo& dedicatedInfo,
+		uint32_t poolIndex, bool linear, MemoryBlock& memoryBlock, uint32_t& freeBlockIndex);
+	/** @brief build HostVisibleMemory of the memory block */
+	HostVisibleMemory getHostVisibleMemory(const MemoryPool& pool, const MemoryChunk& chunk,
+		const MemoryBlock& memoryBlock) const;
+	/** @brief helper function for freeBufferMemory / freeImageMemory */
+	void eraseMemoryBlock(const MemoryBlockLocation& location);
+	/** @brief append an allocation record to the trace */
+	void traceAllocation(char resourceType, uint64_t handle, const VkMemoryRequirements& memRequirements,
+		const VkMemoryDedicatedRequirements& dedicatedRequirements, VkMemoryPropertyFlags properties,
+		MemoryLifetime lifetime, bool linear);
 };
\ No newline at end of file
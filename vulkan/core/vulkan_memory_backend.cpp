@@ -0,0 +1,203 @@
+#include <algorithm>
+#include "vulkan_memory_backend.h"
+
+/*
+* handle <-> integer conversion for fake handles
+*/
+template<typename Handle>
+static inline Handle toHandle(uint64_t value) {
+	return reinterpret_cast<Handle>(value);
+}
+
+template<typename Handle>
+static inline uint64_t toValue(Handle handle) {
+	return reinterpret_cast<uint64_t>(handle);
+}
+
+/*
+* VulkanMemoryBackend - thin wrappers of the device functions
+*/
+void VulkanMemoryBackend::getBufferMemoryRequirements(VkBuffer buffer, VkMemoryRequirements2& memRequirements) {
+	VkBufferMemoryRequirementsInfo2 requirementsInfo{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2 };
+	requirementsInfo.buffer = buffer;
+	vkGetBufferMemoryRequirements2(device, &requirementsInfo, &memRequirements);
+}
+
+void VulkanMemoryBackend::getImageMemoryRequirements(VkImage image, VkMemoryRequirements2& memRequirements) {
+	VkImageMemoryRequirementsInfo2 requirementsInfo{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2 };
+	requirementsInfo.image = image;
+	vkGetImageMemoryRequirements2(device, &requirementsInfo, &memRequirements);
+}
+
+VkResult VulkanMemoryBackend::allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory) {
+	return vkAllocateMemory(device, &allocInfo, nullptr, &memory);
+}
+
+void VulkanMemoryBackend::freeMemory(VkDeviceMemory memory) {
+	vkFreeMemory(device, memory, nullptr);
+}
+
+VkResult VulkanMemoryBackend::mapMemory(VkDeviceMemory memory, void** mappedData) {
+	return vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mappedData);
+}
+
+void VulkanMemoryBackend::unmapMemory(VkDeviceMemory memory) {
+	vkUnmapMemory(device, memory);
+}
+
+VkResult VulkanMemoryBackend::bindBufferMemory(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset) {
+	return vkBindBufferMemory(device, buffer, memory, offset);
+}
+
+VkResult VulkanMemoryBackend::bindImageMemory(VkImage image, VkDeviceMemory memory, VkDeviceSize offset) {
+	return vkBindImageMemory(device, image, memory, offset);
+}
+
+VkResult VulkanMemoryBackend::createBuffer(const VkBufferCreateInfo& createInfo, VkBuffer& buffer) {
+	return vkCreateBuffer(device, &createInfo, nullptr, &buffer);
+}
+
+void VulkanMemoryBackend::destroyBuffer(VkBuffer buffer) {
+	vkDestroyBuffer(device, buffer, nullptr);
+}
+
+VkResult VulkanMemoryBackend::createImage(const VkImageCreateInfo& createInfo, VkImage& image) {
+	return vkCreateImage(device, &createInfo, nullptr, &image);
+}
+
+void VulkanMemoryBackend::destroyImage(VkImage image) {
+	vkDestroyImage(device, image, nullptr);
+}
+
+/*
+* create buffer handle which reports the given memory requirements
+*
+* @param memRequirements - size, alignment & memory type bits of the buffer
+* @param prefersDedicated - VkMemoryDedicatedRequirements::prefersDedicatedAllocation
+* @param requiresDedicated - VkMemoryDedicatedRequirements::requiresDedicatedAllocation
+*
+* @return VkBuffer - fake buffer handle
+*/
+VkBuffer FakeMemoryBackend::createFakeBuffer(const VkMemoryRequirements& memRequirements,
+	bool prefersDedicated, bool requiresDedicated) {
+	uint64_t handle = nextHandle++;
+	resources[handle] = { memRequirements, prefersDedicated, requiresDedicated };
+	return toHandle<VkBuffer>(handle);
+}
+
+/*
+* basically the same as createFakeBuffer but for VkImage
+*/
+VkImage FakeMemoryBackend::createFakeImage(const VkMemoryRequirements& memRequirements,
+	bool prefersDedicated, bool requiresDedicated) {
+	uint64_t handle = nextHandle++;
+	resources[handle] = { memRequirements, prefersDedicated, requiresDedicated };
+	return toHandle<VkImage>(handle);
+}
+
+void FakeMemoryBackend::getBufferMemoryRequirements(VkBuffer buffer, VkMemoryRequirements2& memRequirements) {
+	getMemoryRequirements(toValue(buffer), memRequirements);
+}
+
+void FakeMemoryBackend::getImageMemoryRequirements(VkImage image, VkMemoryRequirements2& memRequirements) {
+	getMemoryRequirements(toValue(image), memRequirements);
+}
+
+VkResult FakeMemoryBackend::allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory) {
+	uint64_t handle = nextHandle++;
+	memories[handle] = allocInfo.allocationSize;
+	memory = toHandle<VkDeviceMemory>(handle);
+
+	allocateCallCount++;
+	allocationCount++;
+	allocatedBytes += allocInfo.allocationSize;
+	peakAllocationCount = std::max(peakAllocationCount, allocationCount);
+	peakAllocatedBytes = std::max(peakAllocatedBytes, allocatedBytes);
+	return VK_SUCCESS;
+}
+
+void FakeMemoryBackend::freeMemory(VkDeviceMemory memory) {
+	auto it = memories.find(toValue(memory));
+	if (it == memories.end()) {
+		throw std::runtime_error("FakeMemoryBackend::freeMemory(): unknown device memory");
+	}
+	allocationCount--;
+	allocatedBytes -= it->second;
+	memories.erase(it);
+}
+
+/*
+* fake device memory has no host storage
+*/
+VkResult FakeMemoryBackend::mapMemory(VkDeviceMemory /*memory*/, void** mappedData) {
+	*mappedData = nullptr;
+	return VK_SUCCESS;
+}
+
+void FakeMemoryBackend::unmapMemory(VkDeviceMemory /*memory*/) {
+}
+
+VkResult FakeMemoryBackend::bindBufferMemory(VkBuffer /*buffer*/, VkDeviceMemory /*memory*/, VkDeviceSize /*offset*/) {
+	return VK_SUCCESS;
+}
+
+VkResult FakeMemoryBackend::bindImageMemory(VkImage /*image*/, VkDeviceMemory /*memory*/, VkDeviceSize /*offset*/) {
+	return VK_SUCCESS;
+}
+
+/*
+* fake buffer of createInfo.size bytes, aligned to bufferAlignment
+*/
+VkResult FakeMemoryBackend::createBuffer(const VkBufferCreateInfo& createInfo, VkBuffer& buffer) {
+	VkMemoryRequirements memRequirements{ createInfo.size, bufferAlignment, UINT32_MAX };
+	buffer = createFakeBuffer(memRequirements);
+	return VK_SUCCESS;
+}
+
+void FakeMemoryBackend::destroyBuffer(VkBuffer buffer) {
+	resources.erase(toValue(buffer));
+}
+
+/*
+* fake image - size is estimated as 4 bytes per texel of every mip level, layer & sample
+*/
+VkResult FakeMemoryBackend::createImage(const VkImageCreateInfo& createInfo, VkImage& image) {
+	VkDeviceSize size = 0;
+	for (uint32_t mip = 0; mip < createInfo.mipLevels; ++mip) {
+		size += VkDeviceSize(std::max(createInfo.extent.width >> mip, 1u)) *
+			std::max(createInfo.extent.height >> mip, 1u) *
+			std::max(createInfo.extent.depth >> mip, 1u) * 4;
+	}
+	size *= VkDeviceSize(createInfo.arrayLayers) * createInfo.samples;
+
+	VkMemoryRequirements memRequirements{ size, imageAlignment, UINT32_MAX };
+	image = createFakeImage(memRequirements);
+	return VK_SUCCESS;
+}
+
+void FakeMemoryBackend::destroyImage(VkImage image) {
+	resources.erase(toValue(image));
+}
+
+/*
+* fill VkMemoryRequirements2 (& VkMemoryDedicatedRequirements in its pNext chain)
+*
+* @param handle - fake buffer / image handle
+* @param memRequirements - out parameter
+*/
+void FakeMemoryBackend::getMemoryRequirements(uint64_t handle, VkMemoryRequirements2& memRequirements) const {
+	auto it = resources.find(handle);
+	if (it == resources.end()) {
+		throw std::runtime_error("FakeMemoryBackend::getMemoryRequirements(): unknown resource");
+	}
+	memRequirements.memoryRequirements = it->second.memRequirements;
+
+	for (VkBaseOutStructure* next = static_cast<VkBaseOutStructure*>(memRequirements.pNext);
+		next != nullptr; next = next->pNext) {
+		if (next->sType == VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS) {
+			VkMemoryDedicatedRequirements* dedicatedRequirements = reinterpret_cast<VkMemoryDedicatedRequirements*>(next);
+			dedicatedRequirements->prefersDedicatedAllocation = it->second.prefersDedicated ? VK_TRUE : VK_FALSE;
+			dedicatedRequirements->requiresDedicatedAllocation = it->second.requiresDedicated ? VK_TRUE : VK_FALSE;
+		}
+	}
+}
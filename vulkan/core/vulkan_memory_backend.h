@@ -0,0 +1,103 @@
+#pragma once
+#include <unordered_map>
+#include "vulkan_utils.h"
+
+/*
+* device calls made by MemoryAllocator
+* the allocator never calls the device directly, so placement policies can be replayed without a GPU
+*/
+class MemoryBackend {
+public:
+	virtual ~MemoryBackend() {}
+	virtual void getBufferMemoryRequirements(VkBuffer buffer, VkMemoryRequirements2& memRequirements) = 0;
+	virtual void getImageMemoryRequirements(VkImage image, VkMemoryRequirements2& memRequirements) = 0;
+	virtual VkResult allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory) = 0;
+	virtual void freeMemory(VkDeviceMemory memory) = 0;
+	virtual VkResult mapMemory(VkDeviceMemory memory, void** mappedData) = 0;
+	virtual void unmapMemory(VkDeviceMemory memory) = 0;
+	virtual VkResult bindBufferMemory(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset) = 0;
+	virtual VkResult bindImageMemory(VkImage image, VkDeviceMemory memory, VkDeviceSize offset) = 0;
+	virtual VkResult createBuffer(const VkBufferCreateInfo& createInfo, VkBuffer& buffer) = 0;
+	virtual void destroyBuffer(VkBuffer buffer) = 0;
+	virtual VkResult createImage(const VkImageCreateInfo& createInfo, VkImage& image) = 0;
+	virtual void destroyImage(VkImage image) = 0;
+};
+
+/*
+* forwards every call to the logical device
+*/
+class VulkanMemoryBackend : public MemoryBackend {
+public:
+	virtual void getBufferMemoryRequirements(VkBuffer buffer, VkMemoryRequirements2& memRequirements) override;
+	virtual void getImageMemoryRequirements(VkImage image, VkMemoryRequirements2& memRequirements) override;
+	virtual VkResult allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory) override;
+	virtual void freeMemory(VkDeviceMemory memory) override;
+	virtual VkResult mapMemory(VkDeviceMemory memory, void** mappedData) override;
+	virtual void unmapMemory(VkDeviceMemory memory) override;
+	virtual VkResult bindBufferMemory(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset) override;
+	virtual VkResult bindImageMemory(VkImage image, VkDeviceMemory memory, VkDeviceSize offset) override;
+	virtual VkResult createBuffer(const VkBufferCreateInfo& createInfo, VkBuffer& buffer) override;
+	virtual void destroyBuffer(VkBuffer buffer) override;
+	virtual VkResult createImage(const VkImageCreateInfo& createInfo, VkImage& image) override;
+	virtual void destroyImage(VkImage image) override;
+
+	/** logical device handle */
+	VkDevice device = VK_NULL_HANDLE;
+};
+
+/*
+* fake device for offline simulation - handles are counters, device memory is never backed by host memory
+* memory requirements of each resource are given by the caller (e.g. read from an allocation trace)
+*/
+class FakeMemoryBackend : public MemoryBackend {
+public:
+	/** @brief create buffer handle which reports the given memory requirements */
+	VkBuffer createFakeBuffer(const VkMemoryRequirements& memRequirements,
+		bool prefersDedicated = false, bool requiresDedicated = false);
+	/** @brief create image handle which reports the given memory requirements */
+	VkImage createFakeImage(const VkMemoryRequirements& memRequirements,
+		bool prefersDedicated = false, bool requiresDedicated = false);
+
+	virtual void getBufferMemoryRequirements(VkBuffer buffer, VkMemoryRequirements2& memRequirements) override;
+	virtual void getImageMemoryRequirements(VkImage image, VkMemoryRequirements2& memRequirements) override;
+	virtual VkResult allocateMemory(const VkMemoryAllocateInfo& allocInfo, VkDeviceMemory& memory) override;
+	virtual void freeMemory(VkDeviceMemory memory) override;
+	virtual VkResult mapMemory(VkDeviceMemory memory, void** mappedData) override;
+	virtual void unmapMemory(VkDeviceMemory memory) override;
+	virtual VkResult bindBufferMemory(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset) override;
+	virtual VkResult bindImageMemory(VkImage image, VkDeviceMemory memory, VkDeviceSize offset) override;
+	virtual VkResult createBuffer(const VkBufferCreateInfo& createInfo, VkBuffer& buffer) override;
+	virtual void destroyBuffer(VkBuffer buffer) override;
+	virtual VkResult createImage(const VkImageCreateInfo& createInfo, VkImage& image) override;
+	virtual void destroyImage(VkImage image) override;
+
+	/** alignment reported for buffers / images created by createBuffer / createImage */
+	VkDeviceSize bufferAlignment = 256;
+	VkDeviceSize imageAlignment = 65536;
+	/** live & peak number of device memory allocations */
+	size_t allocationCount = 0;
+	size_t peakAllocationCount = 0;
+	/** live & peak byte size of device memory */
+	VkDeviceSize allocatedBytes = 0;
+	VkDeviceSize peakAllocatedBytes = 0;
+	/** number of allocateMemory calls */
+	size_t allocateCallCount = 0;
+
+private:
+	/** memory requirements of a fake buffer / image */
+	struct FakeResource {
+		VkMemoryRequirements memRequirements{};
+		bool prefersDedicated = false;
+		bool requiresDedicated = false;
+	};
+
+	/** @brief fill VkMemoryRequirements2 (& VkMemoryDedicatedRequirements in its pNext chain) */
+	void getMemoryRequirements(uint64_t handle, VkMemoryRequirements2& memRequirements) const;
+
+	/** next handle value - shared by buffers, images & device memory */
+	uint64_t nextHandle = 1;
+	/** buffer / image handle -> requirements */
+	std::unordered_map<uint64_t, FakeResource> resources;
+	/** device memory handle -> size */
+	std::unordered_map<uint64_t, VkDeviceSize> memories;
+};
@@ -1,5 +1,6 @@
 #include "vulkan_ray_tracing_helper.h"
 #include "vulkan_device.h"
+#include "vulkan_frame_ring_buffer.h"
 
 /*
 * convert mesh to ray tracing geometry used to build the BLAS
@@ -220,7 +221,7 @@ void buildBlas(VulkanDevice* devices,
 				//delete src acceleration structures
 				for (auto& as : cleanupAs) {
 					vkfp::vkDestroyAccelerationStructureKHR(devices->device, as.accel, nullptr);
-					devices->memoryAllocator.freeBufferMemory(as.buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+					devices->memoryAllocator.freeBufferMemory(as.buffer);
 					vkDestroyBuffer(devices->device, as.buffer, nullptr);
 				}
 			}
@@ -233,7 +234,7 @@ void buildBlas(VulkanDevice* devices,
 
 	//cleanup
 	vkDestroyQueryPool(devices->device, queryPool, nullptr);
-	devices->memoryAllocator.freeBufferMemory(scratchBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(scratchBuffer);
 	vkDestroyBuffer(devices->device, scratchBuffer, nullptr);
 }
 
@@ -355,12 +356,13 @@ VkDeviceAddress getBlasDeviceAddress(VkDevice device, VkAccelerationStructureKHR
 * build top-level acceleration structure
 *
 * @param instance -
+* @param frameRingBuffer - holds the instances until the build is finished
 * @param flags - used for acceleration structure build info
 */
 void buildTlas(VulkanDevice* devices,
 	const std::vector<VkAccelerationStructureInstanceKHR>& instances,
 	AccelKHR& tlas,
-	VkBuffer& instanceBuffer,
+	FrameRingBuffer* frameRingBuffer,
 	VkBuildAccelerationStructureFlagsKHR flags,
 	bool update) {
 	//cannot call buildTlas twice except to update
@@ -368,58 +370,17 @@ void buildTlas(VulkanDevice* devices,
 		throw std::runtime_error("buildTlas() called twice");
 	}
 
-	//create a buffer holding the actual instance data for use by the AS builder
 	VkDeviceSize instanceDescsSizeInBytes = instances.size() * sizeof(VkAccelerationStructureInstanceKHR);
 
-	//allocate the instance buffer and copy its contents from host to device memory
-	if (update) {
-		devices->memoryAllocator.freeBufferMemory(instanceBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		vkDestroyBuffer(devices->device, instanceBuffer, nullptr);
-	}
-
 	/*
-	* staging instance data
+	* instance data - only read during the build, which is finished before this function returns
+	* the build reads host coherent memory directly, host writes are visible to the submission
 	*/
-	//create staging buffer
-	VkBuffer stagingBuffer;
-	VkBufferCreateInfo stagingBufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		instanceDescsSizeInBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &stagingBufferCreateInfo, nullptr, &stagingBuffer));
-
-	//suballocate
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	MemoryAllocator::HostVisibleMemory hostVisibleMemory = devices->memoryAllocator.allocateBufferMemory(
-		stagingBuffer, properties);
-
-	hostVisibleMemory.mapData(devices->device, instances.data());
-
-	//create instance buffer
-	VkBufferCreateInfo bufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		instanceDescsSizeInBytes,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-		VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
-		VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &bufferCreateInfo, nullptr, &instanceBuffer));
-
-	//suballocation
-	devices->memoryAllocator.allocateBufferMemory(instanceBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
+	const VkDeviceSize instanceAlignment = 16; //required for VkAccelerationStructureGeometryInstancesDataKHR
+	FrameRingBuffer::Allocation instanceAllocation = frameRingBuffer->upload(instances.data(),
+		instanceDescsSizeInBytes, instanceAlignment);
 
-	//copy buffer
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = instanceDescsSizeInBytes;
-	vkCmdCopyBuffer(cmdBuf, stagingBuffer, instanceBuffer, 1, &copyRegion);
-
-	//make sure the copy of the instance buffer are copied before triggering the acceleration structure build
-	VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
-	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-	vkCmdPipelineBarrier(cmdBuf,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
-		0, 1, &barrier, 0, nullptr, 0, nullptr);
+	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
 
 	/*
 	* create tlas
@@ -429,7 +390,8 @@ void buildTlas(VulkanDevice* devices,
 	VkAccelerationStructureGeometryInstancesDataKHR instancesData{};
 	instancesData.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
 	instancesData.arrayOfPointers = VK_FALSE;
-	instancesData.data.deviceAddress = vktools::getBufferDeviceAddress(devices->device, instanceBuffer);
+	instancesData.data.deviceAddress = vktools::getBufferDeviceAddress(devices->device, instanceAllocation.buffer) +
+		instanceAllocation.offset;
 
 	//put the above into a VkAccelerationStructureGeometryKHR
 	//we need to put the instances struct in a union and label it as instance data
@@ -484,8 +446,6 @@ void buildTlas(VulkanDevice* devices,
 	vkfp::vkCmdBuildAccelerationStructuresKHR(cmdBuf, 1, &tlasBuildInfo, &pBuildOffsetInfo);
 
 	devices->endCommandBuffer(cmdBuf);
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer, properties);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
-	devices->memoryAllocator.freeBufferMemory(scratchBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeBufferMemory(scratchBuffer);
 	vkDestroyBuffer(devices->device, scratchBuffer, nullptr);
 }
@@ -4,6 +4,7 @@
 #include "vulkan_gltf.h"
 
 struct VulkanDevice;
+class FrameRingBuffer;
 
 /*
 * Bottom level acceleration structure
@@ -106,7 +107,7 @@ VkDeviceAddress getBlasDeviceAddress(VkDevice device, VkAccelerationStructureKHR
 void buildTlas(VulkanDevice* devices,
 	const std::vector<VkAccelerationStructureInstanceKHR>& instances,
 	AccelKHR& tlas,
-	VkBuffer& instanceBuffer,
+	FrameRingBuffer* frameRingBuffer,
 	VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
 	bool update = false
 );
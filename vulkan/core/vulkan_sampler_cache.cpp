@@ -0,0 +1,83 @@
+#include <array>
+#include <cstring>
+#include "vulkan_sampler_cache.h"
+#include "vulkan_device.h"
+
+/*
+* create info fields compared by the cache as 32 bit words (floats by their bits)
+* sType & pNext are excluded - pNext must be null
+*/
+static std::array<uint32_t, 16> getSamplerInfoFields(const VkSamplerCreateInfo& info) {
+	auto floatBits = [](float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	};
+	return { info.flags, static_cast<uint32_t>(info.magFilter), static_cast<uint32_t>(info.minFilter),
+		static_cast<uint32_t>(info.mipmapMode), static_cast<uint32_t>(info.addressModeU),
+		static_cast<uint32_t>(info.addressModeV), static_cast<uint32_t>(info.addressModeW),
+		floatBits(info.mipLodBias), info.anisotropyEnable, floatBits(info.maxAnisotropy), info.compareEnable,
+		static_cast<uint32_t>(info.compareOp), floatBits(info.minLod), floatBits(info.maxLod),
+		static_cast<uint32_t>(info.borderColor), info.unnormalizedCoordinates };
+}
+
+/*
+* set devices handle
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+*/
+void SamplerCache::init(VulkanDevice* devices) {
+	this->devices = devices;
+}
+
+/*
+* destroy every sampler
+*/
+void SamplerCache::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	for (auto& sampler : samplers) {
+		vkDestroySampler(devices->device, sampler.second, nullptr);
+	}
+	samplers.clear();
+	devices = nullptr;
+}
+
+/*
+* find or create sampler
+*
+* @param samplerInfo - create info without pNext chain
+*
+* @return VkSampler - sampler owned by the cache
+*/
+VkSampler SamplerCache::getSampler(const VkSamplerCreateInfo& samplerInfo) {
+	if (samplerInfo.pNext != nullptr) {
+		throw std::runtime_error("SamplerCache::getSampler(): pNext chain is not supported");
+	}
+
+	auto it = samplers.find(samplerInfo);
+	if (it != samplers.end()) {
+		return it->second;
+	}
+	VkSampler sampler = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateSampler(devices->device, &samplerInfo, nullptr, &sampler));
+	samplers.emplace(samplerInfo, sampler);
+	return sampler;
+}
+
+/*
+* hash of the compared fields
+*/
+size_t SamplerCache::SamplerInfoHash::operator()(const VkSamplerCreateInfo& samplerInfo) const {
+	//-0 & +0 differ by their bits - only costs a duplicate sampler
+	std::array<uint32_t, 16> fields = getSamplerInfoFields(samplerInfo);
+	return static_cast<size_t>(vktools::hashBytes(fields.data(), sizeof(fields)));
+}
+
+/*
+* field-wise comparison
+*/
+bool SamplerCache::SamplerInfoEqual::operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const {
+	return getSamplerInfoFields(a) == getSamplerInfoFields(b);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <unordered_map>
+#include "vulkan_utils.h"
+
+struct VulkanDevice;
+
+/*
+* samplers shared by every texture with the same create info - textures never destroy their sampler
+* keeps the number of samplers small (maxSamplerAllocationCount, immutable samplers of bindless arrays)
+*/
+class SamplerCache {
+public:
+	/** @brief set devices handle */
+	void init(VulkanDevice* devices);
+	/** @brief destroy every sampler - textures using them must be destroyed */
+	void cleanup();
+	/** @brief sampler with the create info - created on the first request (pNext must be null) */
+	VkSampler getSampler(const VkSamplerCreateInfo& samplerInfo);
+	/** @brief number of created samplers */
+	size_t getSamplerCount() const { return samplers.size(); }
+
+private:
+	/** @brief hash of the create info fields */
+	struct SamplerInfoHash {
+		size_t operator()(const VkSamplerCreateInfo& samplerInfo) const;
+	};
+	/** @brief field-wise comparison of create infos */
+	struct SamplerInfoEqual {
+		bool operator()(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b) const;
+	};
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	std::unordered_map<VkSamplerCreateInfo, VkSampler, SamplerInfoHash, SamplerInfoEqual> samplers;
+};
@@ -0,0 +1,142 @@
+#include <filesystem>
+#include <fstream>
+#include "vulkan_scene_cache.h"
+
+/*
+* map the cache & validate its header and section table
+*
+* @param path - path to the cache file
+* @param key - content key the cache must have been written with (source hash, import flags ...)
+*
+* @return bool - true if the cache can be used
+*/
+bool SceneCache::open(const std::string& path, uint64_t key) {
+	close();
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(path, error)) {
+		return false;
+	}
+	try {
+		file.open(path);
+	}
+	catch (const std::runtime_error&) {
+		return false;
+	}
+
+	//header & section table
+	if (file.size() < sizeof(Header)) {
+		close();
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(file.data());
+	if (header->magic != MAGIC || header->version != VERSION || header->key != key || header->sectionCount == 0 ||
+		header->sectionCount > (file.size() - sizeof(Header)) / sizeof(SectionEntry)) {
+		close();
+		return false;
+	}
+	const SectionEntry* entries = reinterpret_cast<const SectionEntry*>(file.data() + sizeof(Header));
+	for (uint32_t i = 0; i < header->sectionCount; ++i) {
+		const SectionEntry& entry = entries[i];
+		if (entry.elementSize == 0 || entry.offset > file.size() ||
+			entry.count > (file.size() - entry.offset) / entry.elementSize) {
+			close();
+			return false;
+		}
+	}
+
+	sections = entries;
+	sectionCount = header->sectionCount;
+	return true;
+}
+
+/*
+* unmap the cache
+*/
+void SceneCache::close() {
+	file.close();
+	sections = nullptr;
+	sectionCount = 0;
+}
+
+/*
+* find a section of the mapped cache
+*
+* @param id - section id
+* @param elementSize - expected element size (layout check)
+* @param count - returns number of elements
+*
+* @return const void* - first element in the mapping, nullptr if the section is missing
+*/
+const void* SceneCache::getSection(uint32_t id, uint32_t elementSize, uint64_t& count) const {
+	for (uint32_t i = 0; i < sectionCount; ++i) {
+		if (sections[i].id == id && sections[i].elementSize == elementSize) {
+			count = sections[i].count;
+			return file.data() + sections[i].offset;
+		}
+	}
+	count = 0;
+	return nullptr;
+}
+
+/*
+* write a new cache
+* the sections are written to <path>.tmp which replaces the cache once complete -
+* an interrupted write never leaves a truncated cache behind
+*
+* @param path - path to the cache file
+* @param key - content key checked by open()
+* @param sections - sections to write
+*
+* @return bool - false if the cache couldn't be written
+*/
+bool SceneCache::write(const std::string& path, uint64_t key, const std::vector<Section>& sections) {
+	if (sections.empty()) {
+		return false;
+	}
+	auto align = [](uint64_t offset) {
+		return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+	};
+
+	//section table
+	Header header{ MAGIC, VERSION, key, static_cast<uint32_t>(sections.size()), 0 };
+	std::vector<SectionEntry> entries(sections.size());
+	uint64_t offset = align(sizeof(Header) + sizeof(SectionEntry) * sections.size());
+	for (size_t i = 0; i < sections.size(); ++i) {
+		entries[i] = { sections[i].id, sections[i].elementSize, offset, sections[i].count };
+		offset = align(offset + sections[i].count * sections[i].elementSize);
+	}
+
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			return false;
+		}
+		const char padding[SECTION_ALIGNMENT] = {};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), sizeof(SectionEntry) * entries.size());
+		uint64_t written = sizeof(Header) + sizeof(SectionEntry) * entries.size();
+		for (size_t i = 0; i < sections.size(); ++i) {
+			out.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+			uint64_t size = sections[i].count * sections[i].elementSize;
+			if (size > 0) {
+				out.write(static_cast<const char*>(sections[i].data), static_cast<std::streamsize>(size));
+			}
+			written = entries[i].offset + size;
+		}
+		if (!out) {
+			out.close();
+			std::error_code error;
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
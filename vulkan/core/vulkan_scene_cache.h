@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "vulkan_mapped_file.h"
+
+/*
+* versioned binary cache of processed scene data (flat attribute arrays, primitives, nodes ...)
+* a header (magic, format version, content key) is followed by a section table & 16 byte aligned section data
+* the cache is opened with a single memory mapping - sections are copied or uploaded straight from it
+*/
+class SceneCache {
+public:
+	/** section to write - count elements of elementSize bytes */
+	struct Section {
+		uint32_t id = 0;
+		uint32_t elementSize = 0;
+		const void* data = nullptr;
+		uint64_t count = 0;
+	};
+
+	/** @brief map the cache - returns false if it doesn't exist, is corrupt or doesn't match the key */
+	bool open(const std::string& path, uint64_t key);
+	/** @brief unmap the cache - section pointers become invalid */
+	void close();
+	/** @brief true if a valid cache is mapped */
+	bool isOpen() const { return sectionCount > 0; }
+
+	/** @brief first element of a section & its element count - nullptr if missing or of another element size */
+	const void* getSection(uint32_t id, uint32_t elementSize, uint64_t& count) const;
+	/** @brief copy a section to a vector - returns false if the section is missing */
+	template<typename T>
+	bool readSection(uint32_t id, std::vector<T>& out) const {
+		uint64_t count = 0;
+		const void* data = getSection(id, sizeof(T), count);
+		if (data == nullptr) {
+			return false;
+		}
+		out.resize(static_cast<size_t>(count));
+		if (count > 0) {
+			memcpy(out.data(), data, static_cast<size_t>(count) * sizeof(T));
+		}
+		return true;
+	}
+
+	/** @brief write sections to a new cache - written to a temporary file & renamed, returns false on failure */
+	static bool write(const std::string& path, uint64_t key, const std::vector<Section>& sections);
+
+private:
+	/** file header */
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t sectionCount;
+		uint32_t reserved;
+	};
+	/** section table entry - offset from the beginning of the file */
+	struct SectionEntry {
+		uint32_t id;
+		uint32_t elementSize;
+		uint64_t offset;
+		uint64_t count;
+	};
+	/** "VKSC" */
+	static constexpr uint32_t MAGIC = 0x43534B56;
+	/** bumped whenever the file layout changes */
+	static constexpr uint32_t VERSION = 1;
+	/** alignment of section data */
+	static constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+	/** mapping of the cache file */
+	MappedFile file;
+	/** section table in the mapping */
+	const SectionEntry* sections = nullptr;
+	uint32_t sectionCount = 0;
+};
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <string>
+#include "vulkan_staging_buffer_pool.h"
+#include "vulkan_device.h"
+
+/*
+* create persistently mapped staging buffers
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+* @param bufferSize - byte size of each staging buffer, larger uploads get a temporary buffer
+* @param bufferCount - number of staging buffers
+*/
+void StagingBufferPool::init(VulkanDevice* devices, VkDeviceSize bufferSize, uint32_t bufferCount) {
+	this->devices = devices;
+	this->bufferSize = bufferSize;
+	currentBuffer = 0;
+	temporaryBufferCount = 0;
+
+	//ranges can be used as the source of any buffer -> image copy (texel / block size up to 16 bytes)
+	defaultAlignment = std::max<VkDeviceSize>(devices->properties.limits.optimalBufferCopyOffsetAlignment, 16);
+
+	stagingBuffers.resize(bufferCount);
+	for (auto& stagingBuffer : stagingBuffers) {
+		stagingBuffer.memory = devices->createBuffer(stagingBuffer.buffer, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		stagingBuffer.head = 0;
+		stagingBuffer.liveRangeCount = 0;
+	}
+	LOG("created:\tstaging buffer pool (" + std::to_string(bufferCount) + " x " +
+		std::to_string(bufferSize / (1024 * 1024)) + " MiB)");
+}
+
+/*
+* wait for pending copies & destroy all staging buffers
+*/
+void StagingBufferPool::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	for (const auto& pendingRange : pendingRanges) {
+		VK_CHECK_RESULT(vkWaitForFences(devices->device, 1, &pendingRange.fence, VK_TRUE, UINT64_MAX));
+		recycle(pendingRange.bufferIndex, pendingRange.temporaryBuffer);
+	}
+	pendingRanges.clear();
+
+	for (auto& stagingBuffer : stagingBuffers) {
+		devices->memoryAllocator.freeBufferMemory(stagingBuffer.buffer);
+		vkDestroyBuffer(devices->device, stagingBuffer.buffer, nullptr);
+	}
+	stagingBuffers.clear();
+	devices = nullptr;
+}
+
+/*
+* suballocate upload range
+* if every staging buffer is full, waits for the oldest pending copy before falling back to a temporary buffer
+*
+* @param size - byte size to allocate
+* @param alignment - offset alignment, 0 to use max(optimalBufferCopyOffsetAlignment, 16)
+*
+* @return Allocation - buffer, offset & mapped pointer of the allocated range
+*/
+StagingBufferPool::Allocation StagingBufferPool::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+	if (alignment == 0) {
+		alignment = defaultAlignment;
+	}
+	if (size > bufferSize || stagingBuffers.empty()) {
+		return allocateTemporary(size);
+	}
+
+	collect();
+	while (true) {
+		for (uint32_t i = 0; i < static_cast<uint32_t>(stagingBuffers.size()); ++i) {
+			uint32_t bufferIndex = (currentBuffer + i) % static_cast<uint32_t>(stagingBuffers.size());
+			StagingBuffer& stagingBuffer = stagingBuffers[bufferIndex];
+			VkDeviceSize offset = (stagingBuffer.head + alignment - 1) / alignment * alignment;
+			if (offset + size > bufferSize) {
+				continue;
+			}
+			stagingBuffer.head = offset + size;
+			stagingBuffer.liveRangeCount++;
+			currentBuffer = bufferIndex;
+
+			Allocation allocation{};
+			allocation.buffer = stagingBuffer.buffer;
+			allocation.offset = offset;
+			allocation.size = size;
+			allocation.data = static_cast<uint8_t*>(stagingBuffer.memory.mappedData) + offset;
+			allocation.bufferIndex = bufferIndex;
+			return allocation;
+		}
+
+		//every range is still held by the caller - nothing to wait for
+		if (pendingRanges.empty()) {
+			return allocateTemporary(size);
+		}
+		VK_CHECK_RESULT(vkWaitForFences(devices->device, 1, &pendingRanges.front().fence, VK_TRUE, UINT64_MAX));
+		collect();
+	}
+}
+
+/*
+* allocate & memcpy data
+*
+* @param data - data to be copied
+* @param size - byte size of data
+* @param alignment - offset alignment, 0 to use the default alignment
+*
+* @return Allocation - buffer, offset & mapped pointer of the allocated range
+*/
+StagingBufferPool::Allocation StagingBufferPool::upload(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+	Allocation allocation = allocate(size, alignment);
+	memcpy(allocation.data, data, static_cast<size_t>(size));
+	return allocation;
+}
+
+/*
+* give back the range - the copy reading it must be submitted
+*
+* @param allocation - range returned by allocate / upload
+* @param fence - signaled when the copy is finished, VK_NULL_HANDLE if the caller already waited for it
+*		(the fence must not be destroyed or reset before the range is recycled)
+*/
+void StagingBufferPool::free(const Allocation& allocation, VkFence fence) {
+	VkBuffer temporaryBuffer = allocation.bufferIndex == INVALID_INDEX ? allocation.buffer : VK_NULL_HANDLE;
+	if (fence == VK_NULL_HANDLE) {
+		recycle(allocation.bufferIndex, temporaryBuffer);
+		return;
+	}
+	pendingRanges.push_back({ fence, allocation.bufferIndex, temporaryBuffer });
+}
+
+/*
+* recycle ranges whose fence is signaled
+*/
+void StagingBufferPool::collect() {
+	auto signaled = [this](const PendingRange& pendingRange) {
+		if (vkGetFenceStatus(devices->device, pendingRange.fence) != VK_SUCCESS) {
+			return false;
+		}
+		recycle(pendingRange.bufferIndex, pendingRange.temporaryBuffer);
+		return true;
+	};
+	pendingRanges.erase(std::remove_if(pendingRanges.begin(), pendingRanges.end(), signaled), pendingRanges.end());
+}
+
+/*
+* recycle a single range - the staging buffer is rewound when its last range is recycled
+*
+* @param bufferIndex - staging buffer of the range, INVALID_INDEX for temporary buffers
+* @param temporaryBuffer - temporary buffer to destroy
+*/
+void StagingBufferPool::recycle(uint32_t bufferIndex, VkBuffer temporaryBuffer) {
+	if (bufferIndex == INVALID_INDEX) {
+		devices->memoryAllocator.freeBufferMemory(temporaryBuffer);
+		vkDestroyBuffer(devices->device, temporaryBuffer, nullptr);
+		return;
+	}
+
+	StagingBuffer& stagingBuffer = stagingBuffers[bufferIndex];
+	if (--stagingBuffer.liveRangeCount == 0) {
+		stagingBuffer.head = 0;
+	}
+}
+
+/*
+* create a temporary buffer for an upload which doesn't fit in the staging buffers
+*
+* @param size - byte size of the upload
+*
+* @return Allocation - the whole temporary buffer
+*/
+StagingBufferPool::Allocation StagingBufferPool::allocateTemporary(VkDeviceSize size) {
+	Allocation allocation{};
+	MemoryAllocator::HostVisibleMemory memory = devices->createBuffer(allocation.buffer, size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	allocation.offset = 0;
+	allocation.size = size;
+	allocation.data = memory.mappedData;
+	allocation.bufferIndex = INVALID_INDEX;
+	temporaryBufferCount++;
+	return allocation;
+}
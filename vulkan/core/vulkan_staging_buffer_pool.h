@@ -0,0 +1,83 @@
+#pragma once
+#include "vulkan_memory_allocator.h"
+
+struct VulkanDevice;
+
+/*
+* reusable host -> device upload memory (buffer / image copy sources)
+* a few large persistently mapped staging buffers are suballocated linearly - a buffer is rewound once
+* every range in it is released & the fences of the copies reading them are signaled
+* uploads larger than a staging buffer get a temporary buffer of their own
+*/
+class StagingBufferPool {
+public:
+	/** sub-range of a staging buffer */
+	struct Allocation {
+		/** copy source buffer */
+		VkBuffer buffer = VK_NULL_HANDLE;
+		/** byte offset in buffer */
+		VkDeviceSize offset = 0;
+		/** requested size */
+		VkDeviceSize size = 0;
+		/** mapped pointer to the beginning of this range */
+		void* data = nullptr;
+		/** index of the staging buffer - INVALID_INDEX for temporary buffers */
+		uint32_t bufferIndex = INVALID_INDEX;
+	};
+	/** bufferIndex of temporary buffers */
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	/** @brief create persistently mapped staging buffers */
+	void init(VulkanDevice* devices, VkDeviceSize bufferSize, uint32_t bufferCount);
+	/** @brief wait for pending copies & destroy all staging buffers */
+	void cleanup();
+	/** @brief suballocate upload range */
+	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+	/** @brief allocate & copy data */
+	Allocation upload(const void* data, VkDeviceSize size, VkDeviceSize alignment = 0);
+	/** @brief give back the range - recycled once fence is signaled (immediately if VK_NULL_HANDLE) */
+	void free(const Allocation& allocation, VkFence fence = VK_NULL_HANDLE);
+	/** @brief recycle ranges whose fence is signaled */
+	void collect();
+	/** @brief total byte size of the staging buffers */
+	VkDeviceSize getCapacity() const { return bufferSize * stagingBuffers.size(); }
+
+	/** number of uploads which needed a temporary buffer */
+	size_t temporaryBufferCount = 0;
+
+private:
+	/** persistently mapped staging buffer */
+	struct StagingBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		MemoryAllocator::HostVisibleMemory memory;
+		/** bump pointer - next free byte */
+		VkDeviceSize head = 0;
+		/** number of allocated ranges not recycled yet */
+		uint32_t liveRangeCount = 0;
+	};
+	/** released range waiting for its fence */
+	struct PendingRange {
+		VkFence fence = VK_NULL_HANDLE;
+		uint32_t bufferIndex = INVALID_INDEX;
+		/** temporary buffer destroyed together with the range */
+		VkBuffer temporaryBuffer = VK_NULL_HANDLE;
+	};
+
+	/** @brief recycle a single range */
+	void recycle(uint32_t bufferIndex, VkBuffer temporaryBuffer);
+	/** @brief create a temporary buffer for the upload */
+	Allocation allocateTemporary(VkDeviceSize size);
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	/** staging buffers */
+	std::vector<StagingBuffer> stagingBuffers;
+	/** released ranges in release order */
+	std::vector<PendingRange> pendingRanges;
+	/** staging buffer searched first */
+	uint32_t currentBuffer = 0;
+	/** size of each staging buffer */
+	VkDeviceSize bufferSize = 0;
+	/** max(optimalBufferCopyOffsetAlignment, 16) - valid offset for any buffer -> image copy */
+	VkDeviceSize defaultAlignment = 16;
+};
@@ -15,7 +15,7 @@ void VulkanSwapchain::cleanup() {
 /*
 * get device handle from app
 */
-void VulkanSwapchain::init(const VulkanDevice* devices, GLFWwindow* window) {
+void VulkanSwapchain::init(VulkanDevice* devices, GLFWwindow* window) {
 	this->devices = devices;
 	this->window = window;
 }
@@ -132,12 +132,12 @@ void VulkanSwapchain::create() {
 	VK_CHECK_RESULT(vkCreateSwapchainKHR(devices->device, &swapchainInfo, nullptr, &swapchain));
 	LOG("created:\tswapchain");
 
-	//delete old swapchain & image views
+	//retire old swapchain & image views - destroyed once the presentation of the frames in flight is finished
 	if (oldSwapchain != VK_NULL_HANDLE) {
 		for (auto& imageView : imageViews) {
-			vkDestroyImageView(devices->device, imageView, nullptr);
+			devices->deletionQueue.retireImageView(imageView);
 		}
-		vkDestroySwapchainKHR(devices->device, oldSwapchain, nullptr);
+		devices->deletionQueue.retireSwapchain(oldSwapchain);
 	}
 
 	//get swapchain images
@@ -7,7 +7,7 @@ class VulkanSwapchain {
 public:
 	VulkanSwapchain() {}
 	void cleanup();
-	void init(const VulkanDevice* devices, GLFWwindow* window);
+	void init(VulkanDevice* devices, GLFWwindow* window);
 	void create();
 
 	VkResult acquireImage(VkSemaphore presentCompleteSamaphore, uint32_t& imageIndex);
@@ -30,7 +30,7 @@ public:
 
 private:
 	/** abstracted vulkan device collection handle */
-	const VulkanDevice* devices;
+	VulkanDevice* devices;
 	/** glfw window handle */
 	GLFWwindow* window = nullptr;
 };
\ No newline at end of file
@@ -2,6 +2,23 @@
 #include "vulkan_texture.h"
 
 
+/*
+* sampler of textures - shared through devices->samplerCache
+* lod isn't clamped by the sampler (the image view limits it), so textures differing in mip levels share it
+*
+* @param devices - abstracted vulkan device handle
+* @param filter - min / mag filter
+* @param mode - address mode of every axis
+*
+* @return VkSampler - sampler owned by the cache
+*/
+static VkSampler getSampler(VulkanDevice* devices, VkFilter filter, VkSamplerAddressMode mode) {
+	VkSamplerCreateInfo samplerInfo = vktools::initializers::samplerCreateInfo(
+		devices->availableFeatures, devices->properties, filter, mode);
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	return devices->samplerCache.getSampler(samplerInfo);
+}
+
 /*
 * clean image & image memory
 * must be called if texture is not null
@@ -10,11 +27,11 @@ void TextureBase::cleanup() {
 	if (devices == nullptr) {
 		return;
 	}
-	vkDestroySampler(devices->device, descriptor.sampler, nullptr);
+	//sampler is owned by devices->samplerCache
 	descriptor.sampler = VK_NULL_HANDLE;
 	vkDestroyImageView(devices->device, descriptor.imageView, nullptr);
 	descriptor.imageView = VK_NULL_HANDLE;
-	devices->memoryAllocator.freeImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	devices->memoryAllocator.freeImageMemory(image);
 	vkDestroyImage(devices->device, image, nullptr);
 	image = VK_NULL_HANDLE;
 }
@@ -26,8 +43,26 @@ void TextureBase::cleanup() {
 * @param path - texture file path
 */
 void Texture2D::load(VulkanDevice* devices, const std::string& path, VkFilter filter, VkSamplerAddressMode mode) {
+	load(devices, path, filter, mode, nullptr);
+}
+
+/*
+* load 2d texture from a file
+*
+* @param devices - abstracted vulkan device handle
+* @param path - texture file path
+* @param batch - upload batch recording the copy & mip generation, nullptr to submit immediately
+*/
+void Texture2D::load(VulkanDevice* devices, const std::string& path, VkFilter filter, VkSamplerAddressMode mode,
+	UploadBatch* batch) {
 	this->devices = devices;
 
+	//KTX2 / DDS - stored format & mip levels
+	if (vktools::compression::isContainerFile(path)) {
+		load(devices, vktools::compression::loadContainer(path), filter, mode, batch);
+		return;
+	}
+
 	//image load
 	int width, height, channels;
 	stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
@@ -37,7 +72,7 @@ void Texture2D::load(VulkanDevice* devices, const std::string& path, VkFilter fi
 		throw std::runtime_error("failed to load texture: " + path);
 	}
 
-	load(devices, pixels, width, height, imageSize, VK_FORMAT_R8G8B8A8_SRGB, filter, mode);
+	load(devices, pixels, width, height, imageSize, VK_FORMAT_R8G8B8A8_SRGB, filter, mode, batch);
 	stbi_image_free(pixels);
 }
 
@@ -50,10 +85,11 @@ void Texture2D::load(VulkanDevice* devices, const std::string& path, VkFilter fi
 * @param texHeight
 * @param imageSize - image size in bytes
 * @param format - image format
+* @param batch - upload batch recording the copy & mip generation, nullptr to submit immediately
 */
 void Texture2D::load(VulkanDevice* devices, unsigned char* data,
 	uint32_t texWidth, uint32_t texHeight, VkDeviceSize imageSize, VkFormat format,
-	VkFilter filter, VkSamplerAddressMode mode) {
+	VkFilter filter, VkSamplerAddressMode mode, UploadBatch* batch) {
 	//image creation
 	this->devices = devices;
 	cleanup();
@@ -62,14 +98,15 @@ void Texture2D::load(VulkanDevice* devices, unsigned char* data,
 	mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1; // +1 for original image
 
 	/*
-	* create image (empty)
+	* create image (empty) - transfer source of the mip blits & the defragmenter
 	*/
-	devices->createImage(image, { texWidth, texHeight, 1 },
+	imageInfo = vktools::initializers::imageCreateInfo({ texWidth, texHeight, 1 },
 		format,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		mipLevels,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		mipLevels);
+	devices->createImage(image, imageInfo.extent, imageInfo.format, imageInfo.tiling, imageInfo.usage,
+		imageInfo.mipLevels, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 	
 	/*
 	* create image view
@@ -78,22 +115,19 @@ void Texture2D::load(VulkanDevice* devices, unsigned char* data,
 		VK_IMAGE_VIEW_TYPE_2D, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 
 	/*
-	* staging - create starging buffer
+	* staging - copy pixels to a staging range
 	*/
-	VkBuffer stagingBuffer;
-	VkBufferCreateInfo stagingBufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &stagingBufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	MemoryAllocator::HostVisibleMemory hostVisibleMemory = devices->memoryAllocator.allocateBufferMemory(
-		stagingBuffer, properties);
-	hostVisibleMemory.mapData(devices->device, data);
+	UploadBatch localBatch;
+	if (batch == nullptr) {
+		localBatch.begin(devices);
+		batch = &localBatch;
+	}
+	StagingBufferPool::Allocation staging = batch->stage(data, imageSize);
 
 	/*
 	* undefined -> transfer dst optimal
 	*/
-	VkCommandBuffer cmdBuf = devices->beginCommandBuffer();
+	VkCommandBuffer cmdBuf = batch->getCommandBuffer();
 	vktools::setImageLayout(cmdBuf,
 		image,
 		VK_IMAGE_LAYOUT_UNDEFINED,
@@ -104,8 +138,9 @@ void Texture2D::load(VulkanDevice* devices, unsigned char* data,
 	* image copy from staging buffer to the iamge
 	*/
 	VkBufferImageCopy copy = vktools::initializers::bufferCopyRegion({ texWidth, texHeight, 1 });
+	copy.bufferOffset = staging.offset;
 	vkCmdCopyBufferToImage(cmdBuf,
-		stagingBuffer,
+		staging.buffer,
 		image,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 		1,
@@ -116,21 +151,184 @@ void Texture2D::load(VulkanDevice* devices, unsigned char* data,
 	* generate mipmaps
 	*/
 	vktools::generateMipmaps(cmdBuf, devices->physicalDevice, image, format, texWidth, texHeight, mipLevels, filter);
-	devices->endCommandBuffer(cmdBuf);
+	if (batch == &localBatch) {
+		localBatch.end();
+	}
 
 	/*
-	* cleanup
+	* shared sampler
 	*/
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer, properties);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
+	descriptor.sampler = getSampler(devices, filter, mode);
+	descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+/*
+* check if the stored levels of a compressed image can be copied as is
+*
+* @param devices - abstracted vulkan device handle
+* @param compressedImage - image with at least one stored level
+* @param baseLevel - first stored level uploaded
+*
+* @return bool - false if the image must be decoded to rgba8 & its mipmaps generated
+*/
+static bool isCopyable(VulkanDevice* devices, const CompressedImage& compressedImage, uint32_t baseLevel) {
+	VkFormat format = compressedImage.format;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(devices->physicalDevice, format, &formatProperties);
+	bool sampleable = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	bool blockCompressed = vktools::compression::isBlockCompressed(format);
+	return !((blockCompressed && !devices->textureCompressionBCSupported) || !sampleable ||
+		(!blockCompressed && compressedImage.levels.size() == baseLevel + 1));
+}
+
+/*
+* copy regions of the stored levels from baseLevel - bufferOffset is relative to the base level data
+*
+* @param compressedImage - image with at least one stored level
+* @param baseLevel - first stored level (mip level 0 of the copies)
+*
+* @return std::vector<VkBufferImageCopy> - one region per level
+*/
+static std::vector<VkBufferImageCopy> getLevelCopies(const CompressedImage& compressedImage, uint32_t baseLevel) {
+	const CompressedImage::Level& baseSrcLevel = compressedImage.levels[baseLevel];
+	std::vector<VkBufferImageCopy> copies(compressedImage.levels.size() - baseLevel);
+	for (uint32_t level = 0; level < copies.size(); ++level) {
+		const CompressedImage::Level& srcLevel = compressedImage.levels[baseLevel + level];
+		copies[level] = vktools::initializers::bufferCopyRegion({ srcLevel.width, srcLevel.height, 1 });
+		copies[level].imageSubresource.mipLevel = level;
+		copies[level].bufferOffset = srcLevel.offset - baseSrcLevel.offset;
+	}
+	return copies;
+}
+
+/*
+* load block compressed texture - stored mip levels are copied as is (no mip generation)
+* decoded to rgba8 if the device doesn't support the format
+*
+* @param devices - abstracted vulkan device handle
+* @param compressedImage - image with at least one stored level
+* @param batch - upload batch recording the copies, nullptr to submit immediately
+* @param baseLevel - first stored level uploaded (level 0 of the texture), finer levels are skipped
+*/
+void Texture2D::load(VulkanDevice* devices, const CompressedImage& compressedImage,
+	VkFilter filter, VkSamplerAddressMode mode, UploadBatch* batch, uint32_t baseLevel) {
+	if (baseLevel >= compressedImage.levels.size()) {
+		throw std::runtime_error("compressed image has no mip level " + std::to_string(baseLevel));
+	}
+	const CompressedImage::Level& baseSrcLevel = compressedImage.levels[baseLevel];
+	VkFormat format = compressedImage.format;
+
+	//fallback - decode the largest level & generate mipmaps
+	if (!isCopyable(devices, compressedImage, baseLevel)) {
+		std::vector<unsigned char> pixels = vktools::compression::decodeToRgba8(compressedImage, baseLevel);
+		VkFormat fallbackFormat = vktools::compression::isSrgb(format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		load(devices, pixels.data(), baseSrcLevel.width, baseSrcLevel.height,
+			pixels.size(), fallbackFormat, filter, mode, batch);
+		return;
+	}
+
+	this->devices = devices;
+	cleanup();
+	mipLevels = static_cast<uint32_t>(compressedImage.levels.size()) - baseLevel;
+
+	//transfer source for the defragmenter
+	imageInfo = vktools::initializers::imageCreateInfo({ baseSrcLevel.width, baseSrcLevel.height, 1 },
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		mipLevels);
+	devices->createImage(image, imageInfo.extent, imageInfo.format, imageInfo.tiling, imageInfo.usage,
+		imageInfo.mipLevels, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	descriptor.imageView = vktools::createImageView(devices->device, image,
+		VK_IMAGE_VIEW_TYPE_2D, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 
 	/*
-	* create sampler
+	* staging - every level from baseLevel at once, level offsets are 16 byte aligned
 	*/
-	VkSamplerCreateInfo samplerInfo = vktools::initializers::samplerCreateInfo(
-		devices->availableFeatures, devices->properties, filter, mode, mipLevels);
-	VK_CHECK_RESULT(vkCreateSampler(devices->device, &samplerInfo, nullptr, &descriptor.sampler));
+	UploadBatch localBatch;
+	if (batch == nullptr) {
+		localBatch.begin(devices);
+		batch = &localBatch;
+	}
+	StagingBufferPool::Allocation staging = batch->stage(compressedImage.data.data() + baseSrcLevel.offset,
+		compressedImage.data.size() - baseSrcLevel.offset);
+
+	VkCommandBuffer cmdBuf = batch->getCommandBuffer();
+	vktools::setImageLayout(cmdBuf,
+		image,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		mipLevels);
+
+	//one copy region per level
+	std::vector<VkBufferImageCopy> copies = getLevelCopies(compressedImage, baseLevel);
+	for (auto& copy : copies) {
+		copy.bufferOffset += staging.offset;
+	}
+	vkCmdCopyBufferToImage(cmdBuf,
+		staging.buffer,
+		image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		mipLevels,
+		copies.data()
+	);
+
+	descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vktools::setImageLayout(cmdBuf,
+		image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		descriptor.imageLayout,
+		mipLevels);
+	if (batch == &localBatch) {
+		localBatch.end();
+	}
+
+	descriptor.sampler = getSampler(devices, filter, mode);
+}
+
+/*
+* load the stored mip levels (from baseLevel) on devices->asyncUploadQueue - nothing is submitted
+* the image can't be sampled before the graphics queue acquired it (AsyncUploadQueue::recordAcquireBarriers)
+*
+* @param devices - abstracted vulkan device handle
+* @param compressedImage - image with at least one stored level
+* @param baseLevel - first stored level uploaded (level 0 of the texture), finer levels are skipped
+*
+* @return bool - false if the levels can't be copied as is (nothing is created, use load() with an upload batch)
+*/
+bool Texture2D::loadAsync(VulkanDevice* devices, const CompressedImage& compressedImage,
+	VkFilter filter, VkSamplerAddressMode mode, uint32_t baseLevel) {
+	if (baseLevel >= compressedImage.levels.size()) {
+		throw std::runtime_error("compressed image has no mip level " + std::to_string(baseLevel));
+	}
+	//decoding generates mipmaps on the graphics queue
+	if (!isCopyable(devices, compressedImage, baseLevel)) {
+		return false;
+	}
+	const CompressedImage::Level& baseSrcLevel = compressedImage.levels[baseLevel];
+
+	this->devices = devices;
+	cleanup();
+	mipLevels = static_cast<uint32_t>(compressedImage.levels.size()) - baseLevel;
+
+	imageInfo = vktools::initializers::imageCreateInfo({ baseSrcLevel.width, baseSrcLevel.height, 1 },
+		compressedImage.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		mipLevels);
+	devices->createImage(image, imageInfo.extent, imageInfo.format, imageInfo.tiling, imageInfo.usage,
+		imageInfo.mipLevels, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	descriptor.imageView = vktools::createImageView(devices->device, image,
+		VK_IMAGE_VIEW_TYPE_2D, compressedImage.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+
 	descriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+	devices->asyncUploadQueue.uploadImage(image, compressedImage.data.data() + baseSrcLevel.offset,
+		compressedImage.data.size() - baseSrcLevel.offset, getLevelCopies(compressedImage, baseLevel),
+		range, descriptor.imageLayout);
+
+	descriptor.sampler = getSampler(devices, filter, mode);
+	return true;
 }
 
 /*
@@ -150,7 +348,8 @@ void Texture2D::createEmptyTexture(VulkanDevice* devices,
 	//mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1; // +1 for original image
 
 	//create image
-	devices->createImage(image, { extent.width, extent.height, 1 }, format, tiling, usage, mipLevels, memProperties);
+	imageInfo = vktools::initializers::imageCreateInfo({ extent.width, extent.height, 1 }, format, tiling, usage, mipLevels);
+	devices->createImage(image, imageInfo.extent, format, tiling, usage, mipLevels, memProperties);
 
 	//check image aspect
 	VkImageAspectFlags imageAspect = 0;
@@ -176,8 +375,27 @@ void Texture2D::createEmptyTexture(VulkanDevice* devices,
 	devices->endCommandBuffer(cmdBuf);
 
 	//sampler
-	VkSamplerCreateInfo samplerInfo = vktools::initializers::samplerCreateInfo(devices->availableFeatures, devices->properties);
-	VK_CHECK_RESULT(vkCreateSampler(devices->device, &samplerInfo, nullptr, &descriptor.sampler));
+	descriptor.sampler = getSampler(devices, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+}
+
+/*
+* allow the defragmenter to move the loaded image - its content must not be written anymore
+* the image view is recreated for the new image before onMoved is called
+*
+* @param onMoved - called after the move, the owner rewrites descriptors of descriptor.imageView
+*/
+void Texture2D::registerMovable(std::function<void()> onMoved) {
+	devices->memoryAllocator.registerMovableImage(image, imageInfo, descriptor.imageLayout, VK_IMAGE_ASPECT_COLOR_BIT,
+		[this, onMoved](VkImage newImage) {
+			//old image is already destroyed by the allocator
+			vkDestroyImageView(devices->device, descriptor.imageView, nullptr);
+			image = newImage;
+			descriptor.imageView = vktools::createImageView(devices->device, image,
+				VK_IMAGE_VIEW_TYPE_2D, imageInfo.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+			if (onMoved) {
+				onMoved();
+			}
+		});
 }
 
 /*
@@ -233,24 +451,14 @@ void TextureCube::load(VulkanDevice* devices, const std::string& path, VkFilter
 	VK_CHECK_RESULT(vkCreateImage(devices->device, &imageInfo, nullptr, &image));
 	devices->memoryAllocator.allocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	//staging
-	VkBuffer stagingBuffer;
-	VkBufferCreateInfo stagingBufferCreateInfo = vktools::initializers::bufferCreateInfo(
-		imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-	VK_CHECK_RESULT(vkCreateBuffer(devices->device, &stagingBufferCreateInfo, nullptr, &stagingBuffer));
-
-	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	MemoryAllocator::HostVisibleMemory hostVisibleMemory = devices->memoryAllocator.allocateBufferMemory(
-		stagingBuffer, properties);
-
-	//map memory
-	unsigned char* data = reinterpret_cast<unsigned char*>(hostVisibleMemory.getHandle(devices->device));
+	//staging - copy faces to a staging range
+	StagingBufferPool::Allocation staging = devices->stagingBufferPool.allocate(imageSize);
+	unsigned char* data = static_cast<unsigned char*>(staging.data);
 	for (int i = 0; i < 6; ++i) {
 		memcpy(data, pixelData[i], layerSize);
 		stbi_image_free(pixelData[i]);
 		data += layerSize;
 	}
-	hostVisibleMemory.unmap(devices->device);
 
 
 	//set image layout & data copy
@@ -271,9 +479,10 @@ void TextureCube::load(VulkanDevice* devices, const std::string& path, VkFilter
 	VkBufferImageCopy copy = vktools::initializers::bufferCopyRegion(
 		{ static_cast<VkDeviceSize>(width), static_cast<VkDeviceSize>(height), 1 });
 	copy.imageSubresource.layerCount = 6;
+	copy.bufferOffset = staging.offset;
 
 	vkCmdCopyBufferToImage(cmdBuf,
-		stagingBuffer,
+		staging.buffer,
 		image,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 		1,
@@ -294,12 +503,8 @@ void TextureCube::load(VulkanDevice* devices, const std::string& path, VkFilter
 		image, VK_IMAGE_VIEW_TYPE_CUBE, VK_FORMAT_R8G8B8A8_UNORM, subresourceRange);
 	vkCreateImageView(devices->device, &imageViewInfo, nullptr, &descriptor.imageView);
 
-	//create sampler
-	VkSamplerCreateInfo samplerInfo = 
-		vktools::initializers::samplerCreateInfo(devices->availableFeatures, devices->properties, filter, mode);
-	samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
-	VK_CHECK_RESULT(vkCreateSampler(devices->device, &samplerInfo, nullptr, &descriptor.sampler));
+	//shared sampler
+	descriptor.sampler = getSampler(devices, filter, mode);
 
-	devices->memoryAllocator.freeBufferMemory(stagingBuffer, properties);
-	vkDestroyBuffer(devices->device, stagingBuffer, nullptr);
+	devices->stagingBufferPool.free(staging);
 }
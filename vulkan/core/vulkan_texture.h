@@ -1,13 +1,15 @@
 #pragma once
 #include "vulkan_device.h"
+#include "vulkan_upload_batch.h"
+#include "vulkan_texture_compression.h"
 
 class TextureBase {
 public:
-	/** @brief destroy image & imageView & sampler */
+	/** @brief destroy image & imageView - the sampler belongs to devices->samplerCache */
 	void cleanup();
 	/** @brief load texture from a file */
 	virtual void load(VulkanDevice* devices, const std::string& path, VkFilter filter, VkSamplerAddressMode mode) = 0;
-	/** @brief just get the handle from the user and init texture */
+	/** @brief just get the handle from the user and init texture - cleanup() doesn't destroy the sampler */
 	void init(VulkanDevice* devices, VkImage image, VkImageView imageView,
 		VkImageLayout imageLayout, VkSampler sampler = VK_NULL_HANDLE) {
 		this->devices = devices;
@@ -31,14 +33,31 @@ class Texture2D : public TextureBase {
 public:
 	/** @brief load texture from a file and create image & imageView & sampler */
 	virtual void load(VulkanDevice* devices, const std::string& path, VkFilter filter, VkSamplerAddressMode mode) override;
-	/** @brief load texture from a buffer */
+	/** @brief load texture from a file - upload & mip generation are recorded to the batch */
+	void load(VulkanDevice* devices, const std::string& path, VkFilter filter, VkSamplerAddressMode mode,
+		UploadBatch* batch);
+	/** @brief load texture from a buffer - submitted immediately if batch is nullptr */
 	void load(VulkanDevice* devices, unsigned char* data,
 		uint32_t texWidth, uint32_t texHeight, VkDeviceSize imageSize, VkFormat format,
-		VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+		VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		UploadBatch* batch = nullptr);
+	/** @brief load block compressed texture with its stored mip chain (from baseLevel) - decoded to rgba8 if BC isn't supported */
+	void load(VulkanDevice* devices, const CompressedImage& compressedImage,
+		VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		UploadBatch* batch = nullptr, uint32_t baseLevel = 0);
+	/** @brief copy the stored mip chain (from baseLevel) on devices->asyncUploadQueue - false if it must be decoded */
+	bool loadAsync(VulkanDevice* devices, const CompressedImage& compressedImage,
+		VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		uint32_t baseLevel = 0);
 	/** @brief create empty texture (mostly used as destination image) */
 	void createEmptyTexture(VulkanDevice* devices, VkExtent2D extent,
 		VkFormat format, VkImageTiling tiling,
 		VkImageUsageFlags usage, VkImageLayout layout, VkMemoryPropertyFlags memProperties);
+	/** @brief allow the defragmenter to move the image (TRANSFER_SRC usage) - onMoved is called with the new imageView */
+	void registerMovable(std::function<void()> onMoved);
+
+	/** create info of the image - the defragmenter creates the moved image from it */
+	VkImageCreateInfo imageInfo{};
 };
 
 class TextureCube : public TextureBase {
@@ -0,0 +1,747 @@
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include "vulkan_texture_compression.h"
+
+/** KTX2 file identifier */
+static const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+/*
+* read little endian value from a container
+*
+* @param data - container bytes
+* @param size - byte size of data
+* @param offset - byte offset of the value
+*
+* @return T - value
+*/
+template<typename T>
+static T readValue(const unsigned char* data, size_t size, size_t offset) {
+	if (offset + sizeof(T) > size) {
+		throw std::runtime_error("truncated texture container");
+	}
+	T value;
+	memcpy(&value, data + offset, sizeof(T));
+	return value;
+}
+
+/*
+* DDS four character code
+*/
+static uint32_t makeFourCC(const char* code) {
+	return static_cast<uint32_t>(code[0]) | (static_cast<uint32_t>(code[1]) << 8) |
+		(static_cast<uint32_t>(code[2]) << 16) | (static_cast<uint32_t>(code[3]) << 24);
+}
+
+/*
+* byte size of a mip level
+*/
+static VkDeviceSize getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	VkDeviceSize blockSize = vktools::compression::getBlockSize(format);
+	if (vktools::compression::isBlockCompressed(format)) {
+		return ((width + 3) / 4) * static_cast<VkDeviceSize>((height + 3) / 4) * blockSize;
+	}
+	return static_cast<VkDeviceSize>(width) * height * blockSize;
+}
+
+/*
+* reject images without texels or larger than any device supports (keeps level sizes far from overflowing)
+* & return the number of levels of a full mip chain
+*
+* @param width - width of level 0
+* @param height - height of level 0
+* @param container - container name for the error message
+*
+* @return uint32_t - floor(log2(max(width, height))) + 1
+*/
+static uint32_t getMaxLevelCount(uint32_t width, uint32_t height, const std::string& container) {
+	const uint32_t MAX_DIMENSION = 1u << 16;
+	if (width == 0 || height == 0 || width > MAX_DIMENSION || height > MAX_DIMENSION) {
+		throw std::runtime_error("invalid " + container + " size " + std::to_string(width) + " x " + std::to_string(height));
+	}
+	uint32_t levelCount = 1;
+	for (uint32_t extent = std::max(width, height); extent > 1; extent >>= 1) {
+		levelCount++;
+	}
+	return levelCount;
+}
+
+/*
+* copy a mip level to the image data - levels are 16 byte aligned (valid copy offset for any block size)
+*/
+static void appendLevel(CompressedImage& image, const unsigned char* src, uint32_t width, uint32_t height) {
+	CompressedImage::Level level{};
+	level.offset = (image.data.size() + 15) / 16 * 16;
+	level.size = getLevelSize(image.format, width, height);
+	level.width = width;
+	level.height = height;
+	image.data.resize(static_cast<size_t>(level.offset + level.size));
+	memcpy(image.data.data() + level.offset, src, static_cast<size_t>(level.size));
+	image.levels.push_back(level);
+}
+
+/*
+* parse KTX2 - no supercompression, single 2d image
+*/
+static CompressedImage loadKtx2(const unsigned char* data, size_t size) {
+	CompressedImage image{};
+	image.format = static_cast<VkFormat>(readValue<uint32_t>(data, size, 12));
+	image.width = readValue<uint32_t>(data, size, 20);
+	image.height = readValue<uint32_t>(data, size, 24);
+	uint32_t depth = readValue<uint32_t>(data, size, 28);
+	uint32_t layerCount = readValue<uint32_t>(data, size, 32);
+	uint32_t faceCount = readValue<uint32_t>(data, size, 36);
+	uint32_t levelCount = std::max(readValue<uint32_t>(data, size, 40), 1u);
+	uint32_t supercompressionScheme = readValue<uint32_t>(data, size, 44);
+
+	if (supercompressionScheme != 0) {
+		throw std::runtime_error("supercompressed KTX2 is not supported");
+	}
+	if (depth > 1 || layerCount > 1 || faceCount != 1 || image.height == 0) {
+		throw std::runtime_error("only 2d KTX2 textures are supported");
+	}
+	if (vktools::compression::getBlockSize(image.format) == 0) {
+		throw std::runtime_error("unsupported KTX2 format " + std::to_string(image.format));
+	}
+	if (levelCount > getMaxLevelCount(image.width, image.height, "KTX2")) {
+		throw std::runtime_error("invalid KTX2 level count " + std::to_string(levelCount));
+	}
+
+	//level index follows the 80 byte header
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		uint64_t byteOffset = readValue<uint64_t>(data, size, 80 + level * 24);
+		uint64_t byteLength = readValue<uint64_t>(data, size, 80 + level * 24 + 8);
+		uint32_t width = std::max(image.width >> level, 1u);
+		uint32_t height = std::max(image.height >> level, 1u);
+		if (byteOffset > size || byteLength > size - byteOffset || byteLength < getLevelSize(image.format, width, height)) {
+			throw std::runtime_error("truncated KTX2 level " + std::to_string(level));
+		}
+		appendLevel(image, data + byteOffset, width, height);
+	}
+	return image;
+}
+
+/*
+* parse DDS - legacy four cc (DXT1 / DXT5 / ATI1 / ATI2), DX10 header or 32 bit rgba, no cube maps / arrays
+*/
+static CompressedImage loadDds(const unsigned char* data, size_t size, bool srgb) {
+	const uint32_t DDPF_FOURCC = 0x4, DDPF_RGB = 0x40, DDSCAPS2_CUBEMAP = 0x200;
+
+	if (readValue<uint32_t>(data, size, 4) != 124) {
+		throw std::runtime_error("invalid DDS header");
+	}
+	CompressedImage image{};
+	image.height = readValue<uint32_t>(data, size, 12);
+	image.width = readValue<uint32_t>(data, size, 16);
+	uint32_t levelCount = std::max(readValue<uint32_t>(data, size, 28), 1u);
+	uint32_t pixelFormatFlags = readValue<uint32_t>(data, size, 80);
+	uint32_t fourCC = readValue<uint32_t>(data, size, 84);
+	uint32_t caps2 = readValue<uint32_t>(data, size, 112);
+	if (caps2 & DDSCAPS2_CUBEMAP) {
+		throw std::runtime_error("DDS cube maps are not supported");
+	}
+
+	size_t dataOffset = 128;
+	if ((pixelFormatFlags & DDPF_FOURCC) && fourCC == makeFourCC("DX10")) {
+		uint32_t dxgiFormat = readValue<uint32_t>(data, size, 128);
+		if (readValue<uint32_t>(data, size, 140) > 1) {
+			throw std::runtime_error("DDS texture arrays are not supported");
+		}
+		dataOffset = 148;
+		switch (dxgiFormat) {
+		case 28: image.format = VK_FORMAT_R8G8B8A8_UNORM; break;
+		case 29: image.format = VK_FORMAT_R8G8B8A8_SRGB; break;
+		case 71: image.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+		case 72: image.format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK; break;
+		case 77: image.format = VK_FORMAT_BC3_UNORM_BLOCK; break;
+		case 78: image.format = VK_FORMAT_BC3_SRGB_BLOCK; break;
+		case 80: image.format = VK_FORMAT_BC4_UNORM_BLOCK; break;
+		case 81: image.format = VK_FORMAT_BC4_SNORM_BLOCK; break;
+		case 83: image.format = VK_FORMAT_BC5_UNORM_BLOCK; break;
+		case 84: image.format = VK_FORMAT_BC5_SNORM_BLOCK; break;
+		case 98: image.format = VK_FORMAT_BC7_UNORM_BLOCK; break;
+		case 99: image.format = VK_FORMAT_BC7_SRGB_BLOCK; break;
+		default: throw std::runtime_error("unsupported DXGI format " + std::to_string(dxgiFormat));
+		}
+	}
+	else if (pixelFormatFlags & DDPF_FOURCC) {
+		//legacy header doesn't store the color space
+		if (fourCC == makeFourCC("DXT1")) {
+			image.format = srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		}
+		else if (fourCC == makeFourCC("DXT5")) {
+			image.format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+		}
+		else if (fourCC == makeFourCC("ATI1") || fourCC == makeFourCC("BC4U")) {
+			image.format = VK_FORMAT_BC4_UNORM_BLOCK;
+		}
+		else if (fourCC == makeFourCC("ATI2") || fourCC == makeFourCC("BC5U")) {
+			image.format = VK_FORMAT_BC5_UNORM_BLOCK;
+		}
+		else {
+			throw std::runtime_error("unsupported DDS four cc");
+		}
+	}
+	else if ((pixelFormatFlags & DDPF_RGB) && readValue<uint32_t>(data, size, 88) == 32 &&
+		readValue<uint32_t>(data, size, 92) == 0x000000ff && readValue<uint32_t>(data, size, 96) == 0x0000ff00 &&
+		readValue<uint32_t>(data, size, 100) == 0x00ff0000) {
+		image.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+	else {
+		throw std::runtime_error("unsupported DDS pixel format");
+	}
+
+	if (levelCount > getMaxLevelCount(image.width, image.height, "DDS")) {
+		throw std::runtime_error("invalid DDS level count " + std::to_string(levelCount));
+	}
+
+	//levels are stored contiguously
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		uint32_t width = std::max(image.width >> level, 1u);
+		uint32_t height = std::max(image.height >> level, 1u);
+		VkDeviceSize levelSize = getLevelSize(image.format, width, height);
+		if (dataOffset > size || levelSize > size - dataOffset) {
+			throw std::runtime_error("truncated DDS level " + std::to_string(level));
+		}
+		appendLevel(image, data + dataOffset, width, height);
+		dataOffset += static_cast<size_t>(levelSize);
+	}
+	return image;
+}
+
+/*
+* block encoders / decoders
+*/
+static uint16_t toRgb565(const unsigned char* color) {
+	return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 |
+		((color[2] * 31 + 127) / 255));
+}
+
+static void fromRgb565(uint16_t value, int* color) {
+	int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+/*
+* BC1 color block (4 color mode) - endpoints are the extremes along the principal axis of the block colors
+*/
+static void encodeBC1Block(const unsigned char block[16][4], unsigned char* dst) {
+	float mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			mean[c] += block[i][c] / 16.f;
+		}
+	}
+	float covariance[3][3] = {};
+	for (int i = 0; i < 16; ++i) {
+		float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				covariance[r][c] += d[r] * d[c];
+			}
+		}
+	}
+	//power iteration
+	float axis[3] = { 1, 1, 1 };
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		float next[3] = {};
+		for (int r = 0; r < 3; ++r) {
+			next[r] = covariance[r][0] * axis[0] + covariance[r][1] * axis[1] + covariance[r][2] * axis[2];
+		}
+		float length = std::max({ std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2]) });
+		if (length < 1e-6f) {
+			break;
+		}
+		for (int c = 0; c < 3; ++c) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	int minIndex = 0, maxIndex = 0;
+	float minProjection = FLT_MAX, maxProjection = -FLT_MAX;
+	for (int i = 0; i < 16; ++i) {
+		float projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+		if (projection < minProjection) {
+			minProjection = projection;
+			minIndex = i;
+		}
+		if (projection > maxProjection) {
+			maxProjection = projection;
+			maxIndex = i;
+		}
+	}
+
+	uint16_t color0 = toRgb565(block[maxIndex]);
+	uint16_t color1 = toRgb565(block[minIndex]);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		int palette[4][3];
+		fromRgb565(color0, palette[0]);
+		fromRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; ++i) {
+			int bestIndex = 0, bestDistance = INT_MAX;
+			for (int p = 0; p < 4; ++p) {
+				int distance = 0;
+				for (int c = 0; c < 3; ++c) {
+					int d = block[i][c] - palette[p][c];
+					distance += d * d;
+				}
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+		}
+	}
+	memcpy(dst, &color0, 2);
+	memcpy(dst + 2, &color1, 2);
+	memcpy(dst + 4, &indices, 4);
+}
+
+/*
+* BC4 palette of a block
+*/
+static void getBC4Palette(int value0, int value1, int* palette) {
+	palette[0] = value0;
+	palette[1] = value1;
+	if (value0 > value1) {
+		for (int i = 2; i < 8; ++i) {
+			palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+		}
+	}
+	else {
+		for (int i = 2; i < 6; ++i) {
+			palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+/*
+* BC4 single channel block (8 value mode)
+*/
+static void encodeBC4Block(const unsigned char block[16][4], int channel, unsigned char* dst) {
+	int minValue = 255, maxValue = 0;
+	for (int i = 0; i < 16; ++i) {
+		minValue = std::min<int>(minValue, block[i][channel]);
+		maxValue = std::max<int>(maxValue, block[i][channel]);
+	}
+
+	int palette[8];
+	getBC4Palette(maxValue, minValue, palette);
+	uint64_t indices = 0;
+	if (maxValue != minValue) {
+		for (int i = 0; i < 16; ++i) {
+			int bestIndex = 0, bestDistance = INT_MAX;
+			for (int p = 0; p < 8; ++p) {
+				int distance = std::abs(block[i][channel] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					bestIndex = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+		}
+	}
+	dst[0] = static_cast<unsigned char>(maxValue);
+	dst[1] = static_cast<unsigned char>(minValue);
+	for (int i = 0; i < 6; ++i) {
+		dst[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+	}
+}
+
+static void decodeBC1Block(const unsigned char* src, bool fourColorOnly, unsigned char block[16][4]) {
+	uint16_t color0, color1;
+	uint32_t indices;
+	memcpy(&color0, src, 2);
+	memcpy(&color1, src + 2, 2);
+	memcpy(&indices, src + 4, 4);
+
+	int palette[4][4];
+	fromRgb565(color0, palette[0]);
+	fromRgb565(color1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	for (int c = 0; c < 3; ++c) {
+		if (color0 > color1 || fourColorOnly) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if (!(color0 > color1 || fourColorOnly)) {
+		palette[3][3] = 0;
+	}
+	for (int i = 0; i < 16; ++i) {
+		int index = (indices >> (2 * i)) & 3;
+		for (int c = 0; c < 4; ++c) {
+			block[i][c] = static_cast<unsigned char>(palette[index][c]);
+		}
+	}
+}
+
+static void decodeBC4Block(const unsigned char* src, int channel, unsigned char block[16][4]) {
+	int palette[8];
+	getBC4Palette(src[0], src[1], palette);
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; ++i) {
+		indices |= static_cast<uint64_t>(src[2 + i]) << (8 * i);
+	}
+	for (int i = 0; i < 16; ++i) {
+		block[i][channel] = static_cast<unsigned char>(palette[(indices >> (3 * i)) & 7]);
+	}
+}
+
+/*
+* sRGB <-> linear for gamma correct mip generation
+*/
+static float srgbToLinear(unsigned char value) {
+	static const std::array<float, 256> table = []() {
+		std::array<float, 256> values{};
+		for (int i = 0; i < 256; ++i) {
+			float c = i / 255.f;
+			values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+	return table[value];
+}
+
+static unsigned char linearToSrgb(float value) {
+	float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+	return static_cast<unsigned char>(std::clamp(c * 255.f + 0.5f, 0.f, 255.f));
+}
+
+/*
+* 2x2 box filter - odd edges are clamped
+*/
+static std::vector<unsigned char> downsample(const std::vector<unsigned char>& src, uint32_t width, uint32_t height,
+	bool srgb) {
+	uint32_t dstWidth = std::max(width / 2, 1u), dstHeight = std::max(height / 2, 1u);
+	std::vector<unsigned char> dst(static_cast<size_t>(dstWidth) * dstHeight * 4);
+	for (uint32_t y = 0; y < dstHeight; ++y) {
+		for (uint32_t x = 0; x < dstWidth; ++x) {
+			const uint32_t xs[2] = { std::min(2 * x, width - 1), std::min(2 * x + 1, width - 1) };
+			const uint32_t ys[2] = { std::min(2 * y, height - 1), std::min(2 * y + 1, height - 1) };
+			for (int c = 0; c < 4; ++c) {
+				float sum = 0;
+				for (uint32_t sy : ys) {
+					for (uint32_t sx : xs) {
+						unsigned char value = src[(static_cast<size_t>(sy) * width + sx) * 4 + c];
+						sum += (srgb && c < 3) ? srgbToLinear(value) : value;
+					}
+				}
+				dst[(static_cast<size_t>(y) * dstWidth + x) * 4 + c] = (srgb && c < 3) ? linearToSrgb(sum / 4.f) :
+					static_cast<unsigned char>(sum / 4.f + 0.5f);
+			}
+		}
+	}
+	return dst;
+}
+
+namespace vktools {
+	namespace compression {
+		/*
+		* check container signature
+		*
+		* @param data - file bytes
+		* @param size - byte size of data
+		*
+		* @return bool - true if data is a KTX2 or DDS file
+		*/
+		bool isContainer(const unsigned char* data, size_t size) {
+			return (size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) ||
+				(size >= 4 && memcmp(data, "DDS ", 4) == 0);
+		}
+
+		/*
+		* check file extension
+		*
+		* @param path - file path
+		*
+		* @return bool - true for .ktx2 / .dds files
+		*/
+		bool isContainerFile(const std::string& path) {
+			std::string extension = path.substr(path.find_last_of('.') + 1);
+			std::transform(extension.begin(), extension.end(), extension.begin(),
+				[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return extension == "ktx2" || extension == "dds";
+		}
+
+		/*
+		* parse KTX2 / DDS file in memory
+		*
+		* @param data - file bytes
+		* @param size - byte size of data
+		* @param srgb - color space of legacy DDS files which don't store it
+		*
+		* @return CompressedImage - format & stored mip levels
+		*/
+		CompressedImage loadContainer(const unsigned char* data, size_t size, bool srgb) {
+			if (size >= sizeof(KTX2_IDENTIFIER) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+				return loadKtx2(data, size);
+			}
+			if (size >= 4 && memcmp(data, "DDS ", 4) == 0) {
+				return loadDds(data, size, srgb);
+			}
+			throw std::runtime_error("not a KTX2 / DDS file");
+		}
+
+		/*
+		* read & parse KTX2 / DDS file
+		*
+		* @param path - file path
+		* @param srgb - color space of legacy DDS files which don't store it
+		*
+		* @return CompressedImage - format & stored mip levels
+		*/
+		CompressedImage loadContainer(const std::string& path, bool srgb) {
+			std::vector<char> file = readFile(path);
+			try {
+				return loadContainer(reinterpret_cast<const unsigned char*>(file.data()), file.size(), srgb);
+			}
+			catch (const std::runtime_error& e) {
+				throw std::runtime_error(path + ": " + e.what());
+			}
+		}
+
+		/*
+		* bytes per 4x4 block (per texel for rgba8)
+		*
+		* @param format - image format
+		*
+		* @return uint32_t - block size, 0 if the format is not supported
+		*/
+		uint32_t getBlockSize(VkFormat format) {
+			switch (format) {
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+			case VK_FORMAT_BC4_SNORM_BLOCK:
+				return 8;
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+			case VK_FORMAT_BC5_SNORM_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				return 16;
+			case VK_FORMAT_R8G8B8A8_UNORM:
+			case VK_FORMAT_R8G8B8A8_SRGB:
+				return 4;
+			default:
+				return 0;
+			}
+		}
+
+		/*
+		* @return bool - true for BC formats
+		*/
+		bool isBlockCompressed(VkFormat format) {
+			return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+		}
+
+		/*
+		* @return bool - true for sRGB formats
+		*/
+		bool isSrgb(VkFormat format) {
+			return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+				format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK ||
+				format == VK_FORMAT_R8G8B8A8_SRGB;
+		}
+
+		/*
+		* build the mip chain & encode every level
+		* COLOR -> BC1 sRGB (BC3 sRGB if any alpha < 255), NORMAL -> BC5, MASK (red channel) -> BC4
+		*
+		* @param rgba - rgba8 pixels of the largest level
+		* @param width
+		* @param height
+		* @param role - how the texture is sampled
+		*
+		* @return CompressedImage - encoded image with full mip chain
+		*/
+		CompressedImage encode(const unsigned char* rgba, uint32_t width, uint32_t height, TextureRole role) {
+			CompressedImage image{};
+			image.width = width;
+			image.height = height;
+
+			size_t pixelCount = static_cast<size_t>(width) * height;
+			if (role == TextureRole::COLOR) {
+				bool hasAlpha = false;
+				for (size_t i = 0; i < pixelCount && !hasAlpha; ++i) {
+					hasAlpha = rgba[i * 4 + 3] != 255;
+				}
+				image.format = hasAlpha ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+			}
+			else {
+				image.format = role == TextureRole::NORMAL ? VK_FORMAT_BC5_UNORM_BLOCK : VK_FORMAT_BC4_UNORM_BLOCK;
+			}
+			uint32_t blockSize = getBlockSize(image.format);
+
+			std::vector<unsigned char> pixels(rgba, rgba + pixelCount * 4);
+			std::vector<unsigned char> blocks;
+			uint32_t levelWidth = width, levelHeight = height;
+			while (true) {
+				uint32_t blockCountX = (levelWidth + 3) / 4, blockCountY = (levelHeight + 3) / 4;
+				blocks.resize(static_cast<size_t>(blockCountX) * blockCountY * blockSize);
+				for (uint32_t by = 0; by < blockCountY; ++by) {
+					for (uint32_t bx = 0; bx < blockCountX; ++bx) {
+						//edge blocks repeat the last row / column
+						unsigned char block[16][4];
+						for (uint32_t i = 0; i < 16; ++i) {
+							uint32_t x = std::min(bx * 4 + i % 4, levelWidth - 1);
+							uint32_t y = std::min(by * 4 + i / 4, levelHeight - 1);
+							memcpy(block[i], &pixels[(static_cast<size_t>(y) * levelWidth + x) * 4], 4);
+						}
+
+						unsigned char* dst = &blocks[(static_cast<size_t>(by) * blockCountX + bx) * blockSize];
+						switch (image.format) {
+						case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+							encodeBC1Block(block, dst);
+							break;
+						case VK_FORMAT_BC3_SRGB_BLOCK:
+							encodeBC4Block(block, 3, dst);
+							encodeBC1Block(block, dst + 8);
+							break;
+						case VK_FORMAT_BC5_UNORM_BLOCK:
+							encodeBC4Block(block, 0, dst);
+							encodeBC4Block(block, 1, dst + 8);
+							break;
+						default:
+							encodeBC4Block(block, 0, dst);
+							break;
+						}
+					}
+				}
+				appendLevel(image, blocks.data(), levelWidth, levelHeight);
+
+				if (levelWidth == 1 && levelHeight == 1) {
+					break;
+				}
+				pixels = downsample(pixels, levelWidth, levelHeight, role == TextureRole::COLOR);
+				levelWidth = std::max(levelWidth / 2, 1u);
+				levelHeight = std::max(levelHeight / 2, 1u);
+			}
+			return image;
+		}
+
+		/*
+		* build the rgba8 mip chain of pixels - same box filter as encode()
+		*
+		* @param rgba - rgba8 pixels
+		* @param width
+		* @param height
+		* @param srgb - filter color channels in linear space & store as R8G8B8A8_SRGB
+		*
+		* @return CompressedImage - R8G8B8A8_SRGB / UNORM image with every mip level
+		*/
+		CompressedImage buildMipChain(const unsigned char* rgba, uint32_t width, uint32_t height, bool srgb) {
+			CompressedImage image{};
+			image.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+			image.width = width;
+			image.height = height;
+
+			std::vector<unsigned char> pixels(rgba, rgba + static_cast<size_t>(width) * height * 4);
+			uint32_t levelWidth = width, levelHeight = height;
+			while (true) {
+				appendLevel(image, pixels.data(), levelWidth, levelHeight);
+				if (levelWidth == 1 && levelHeight == 1) {
+					break;
+				}
+				pixels = downsample(pixels, levelWidth, levelHeight, srgb);
+				levelWidth = std::max(levelWidth / 2, 1u);
+				levelHeight = std::max(levelHeight / 2, 1u);
+			}
+			return image;
+		}
+
+		/*
+		* decode a mip level to rgba8 - BC4 / BC5 fill the missing channels with (0, 0, 1)
+		*
+		* @param image - BC1 / BC3 / BC4 / BC5 (unorm) or rgba8 image
+		* @param level - mip level to decode
+		*
+		* @return std::vector<unsigned char> - rgba8 pixels
+		*/
+		std::vector<unsigned char> decodeToRgba8(const CompressedImage& image, uint32_t level) {
+			const CompressedImage::Level& srcLevel = image.levels.at(level);
+			const unsigned char* src = image.data.data() + srcLevel.offset;
+			std::vector<unsigned char> pixels(static_cast<size_t>(srcLevel.width) * srcLevel.height * 4);
+
+			if (!isBlockCompressed(image.format)) {
+				memcpy(pixels.data(), src, pixels.size());
+				return pixels;
+			}
+			if (image.format == VK_FORMAT_BC4_SNORM_BLOCK || image.format == VK_FORMAT_BC5_SNORM_BLOCK ||
+				image.format == VK_FORMAT_BC7_UNORM_BLOCK || image.format == VK_FORMAT_BC7_SRGB_BLOCK) {
+				throw std::runtime_error("format " + std::to_string(image.format) + " can't be decoded on the cpu");
+			}
+
+			uint32_t blockSize = getBlockSize(image.format);
+			uint32_t blockCountX = (srcLevel.width + 3) / 4, blockCountY = (srcLevel.height + 3) / 4;
+			for (uint32_t by = 0; by < blockCountY; ++by) {
+				for (uint32_t bx = 0; bx < blockCountX; ++bx) {
+					const unsigned char* srcBlock = src + (static_cast<size_t>(by) * blockCountX + bx) * blockSize;
+					unsigned char block[16][4] = {};
+					for (int i = 0; i < 16; ++i) {
+						block[i][3] = 255;
+					}
+
+					switch (image.format) {
+					case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+					case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+						decodeBC1Block(srcBlock, false, block);
+						for (int i = 0; i < 16; ++i) {
+							block[i][3] = 255;
+						}
+						break;
+					case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+					case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+						decodeBC1Block(srcBlock, false, block);
+						break;
+					case VK_FORMAT_BC3_UNORM_BLOCK:
+					case VK_FORMAT_BC3_SRGB_BLOCK:
+						decodeBC1Block(srcBlock + 8, true, block);
+						decodeBC4Block(srcBlock, 3, block);
+						break;
+					case VK_FORMAT_BC5_UNORM_BLOCK:
+						decodeBC4Block(srcBlock, 0, block);
+						decodeBC4Block(srcBlock + 8, 1, block);
+						break;
+					default:
+						decodeBC4Block(srcBlock, 0, block);
+						break;
+					}
+
+					for (uint32_t i = 0; i < 16; ++i) {
+						uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+						if (x < srcLevel.width && y < srcLevel.height) {
+							memcpy(&pixels[(static_cast<size_t>(y) * srcLevel.width + x) * 4], block[i], 4);
+						}
+					}
+				}
+			}
+			return pixels;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include "vulkan_utils.h"
+
+/** what a texture is sampled for - selects the block compressed format of the encoder */
+enum class TextureRole {
+	/** base colour - BC1 (BC3 if the image has alpha) */
+	COLOR,
+	/** tangent space normal (x, y) - BC5 */
+	NORMAL,
+	/** single channel mask (r) - BC4 */
+	MASK
+};
+
+/** block compressed (or rgba8) image with its stored mip chain */
+struct CompressedImage {
+	/** mip level stored in data */
+	struct Level {
+		/** byte offset in data */
+		VkDeviceSize offset = 0;
+		/** byte size */
+		VkDeviceSize size = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+	};
+
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	/** level 0 is the largest */
+	std::vector<Level> levels;
+	std::vector<unsigned char> data;
+};
+
+/*
+* KTX2 / DDS ingestion & cpu BC1 / BC3 / BC4 / BC5 encoding - decoding is the fallback for devices
+* without textureCompressionBC (BC7 can't be decoded on the cpu)
+*/
+namespace vktools {
+	namespace compression {
+		/** @brief true if data starts with a KTX2 or DDS signature */
+		bool isContainer(const unsigned char* data, size_t size);
+		/** @brief true if the file extension is .ktx2 / .dds */
+		bool isContainerFile(const std::string& path);
+		/** @brief parse KTX2 / DDS file in memory */
+		CompressedImage loadContainer(const unsigned char* data, size_t size, bool srgb = true);
+		/** @brief read & parse KTX2 / DDS file */
+		CompressedImage loadContainer(const std::string& path, bool srgb = true);
+
+		/** @brief bytes per 4x4 block (per texel for rgba8), 0 if the format is not supported */
+		uint32_t getBlockSize(VkFormat format);
+		/** @brief true for BC formats */
+		bool isBlockCompressed(VkFormat format);
+		/** @brief true for sRGB formats */
+		bool isSrgb(VkFormat format);
+
+		/** @brief build the mip chain of rgba8 pixels & encode every level */
+		CompressedImage encode(const unsigned char* rgba, uint32_t width, uint32_t height, TextureRole role);
+		/** @brief build the rgba8 mip chain of pixels without encoding (kept on the cpu by the texture streamer) */
+		CompressedImage buildMipChain(const unsigned char* rgba, uint32_t width, uint32_t height, bool srgb);
+		/** @brief decode a mip level to rgba8 */
+		std::vector<unsigned char> decodeToRgba8(const CompressedImage& image, uint32_t level);
+	}
+}
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include "vulkan_texture_streamer.h"
+#include "vulkan_device.h"
+
+/*
+* set devices handle
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+*/
+void TextureStreamer::init(VulkanDevice* devices) {
+	this->devices = devices;
+	residentBytes = 0;
+	allocationLimit = VK_WHOLE_SIZE;
+	version = 0;
+	asyncUploads = devices->timelineSemaphoreSupported;
+	pendingUploadValue = 0;
+}
+
+/*
+* wait for pending uploads & release cpu mip chains
+* images of the textures are destroyed by their owner (Texture2D::cleanup)
+*/
+void TextureStreamer::cleanup() {
+	if (devices == nullptr) {
+		return;
+	}
+	for (UploadBatch& batch : pendingBatches) {
+		batch.end();
+	}
+	pendingBatches.clear();
+	devices->asyncUploadQueue.wait(pendingUploadValue);
+	pendingUploadValue = 0;
+	textures.clear();
+	residentBytes = 0;
+	devices = nullptr;
+}
+
+/*
+* keep the mip chain on the cpu & load the levels smaller than residentSize
+*
+* @param texture - texture whose image is replaced by the streamer, must outlive the streamer
+* @param mipChain - every mip level of the texture (rgba8 or block compressed)
+* @param filter - sampler filter
+* @param mode - sampler address mode
+* @param batch - upload batch recording the copy of the coarse levels
+*
+* @return uint32_t - index of the texture for requestLevel()
+*/
+uint32_t TextureStreamer::addTexture(Texture2D* texture, CompressedImage&& mipChain, VkFilter filter,
+	VkSamplerAddressMode mode, UploadBatch& batch) {
+	if (mipChain.levels.empty()) {
+		throw std::runtime_error("TextureStreamer::addTexture(): mip chain has no level");
+	}
+
+	StreamedTexture streamedTexture{};
+	streamedTexture.texture = texture;
+	streamedTexture.mipChain = std::move(mipChain);
+	streamedTexture.filter = filter;
+	streamedTexture.mode = mode;
+	streamedTexture.requestedLevel = NO_REQUEST;
+
+	//first level which fits in residentSize - it & smaller levels are never evicted
+	const std::vector<CompressedImage::Level>& levels = streamedTexture.mipChain.levels;
+	streamedTexture.coarsestLevel = static_cast<uint32_t>(levels.size()) - 1;
+	for (uint32_t level = 0; level < levels.size(); ++level) {
+		if (std::max(levels[level].width, levels[level].height) <= residentSize) {
+			streamedTexture.coarsestLevel = level;
+			break;
+		}
+	}
+
+	textures.push_back(std::move(streamedTexture));
+	if (!load(textures.back(), textures.back().coarsestLevel, batch)) {
+		textures.pop_back();
+		throw std::runtime_error("TextureStreamer::addTexture(): failed to allocate the coarse mip levels");
+	}
+	return static_cast<uint32_t>(textures.size()) - 1;
+}
+
+/*
+* request the finest mip level of a texture - requests are reset by update()
+*
+* @param index - index returned by addTexture()
+* @param level - finest level of the cpu mip chain the texture is sampled at
+*/
+void TextureStreamer::requestLevel(uint32_t index, uint32_t level) {
+	StreamedTexture& texture = textures.at(index);
+	texture.requestedLevel = std::min(texture.requestedLevel, level);
+}
+
+/*
+* stream in requested levels & evict the finest levels if the budget is exceeded
+* textures without a request keep their levels until memory is needed,
+* uploads are submitted without waiting - the graphics queue executes them (or acquires them from the async upload queue)
+* before the frame using the new images
+* must be called after the fence of the current frame is waited (descriptors of the frame are rewritten afterwards)
+*
+* @return bool - true if the image of any texture was replaced
+*/
+bool TextureStreamer::update() {
+	//release finished stream-in batches
+	for (auto it = pendingBatches.begin(); it != pendingBatches.end();) {
+		if (it->isComplete()) {
+			it->end();
+			it = pendingBatches.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	if (pendingUploadValue != 0 && devices->asyncUploadQueue.isComplete(pendingUploadValue)) {
+		pendingUploadValue = 0;
+	}
+
+	//target level - finer levels are streamed in if requested, nothing is evicted without memory pressure
+	std::vector<uint32_t> wantedLevels(textures.size());
+	std::vector<uint32_t> targetLevels(textures.size());
+	VkDeviceSize targetBytes = 0;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		StreamedTexture& texture = textures[i];
+		wantedLevels[i] = std::min(texture.requestedLevel, texture.coarsestLevel);
+		targetLevels[i] = std::min(wantedLevels[i], texture.residentLevel);
+		targetBytes += getChainSize(texture, targetLevels[i]);
+		texture.requestedLevel = NO_REQUEST;
+	}
+
+	/*
+	* evict one level at a time until the targets fit in the budget
+	* levels finer than requested go first, then the largest level - big textures degrade before small ones
+	*/
+	const VkDeviceSize effectiveBudget = getEffectiveBudget();
+	while (targetBytes > effectiveBudget) {
+		size_t evictedIndex = textures.size();
+		bool evictedUnneeded = false;
+		VkDeviceSize evictedSize = 0;
+		for (size_t i = 0; i < textures.size(); ++i) {
+			if (targetLevels[i] >= textures[i].coarsestLevel) {
+				continue;
+			}
+			bool unneeded = targetLevels[i] < wantedLevels[i];
+			VkDeviceSize levelSize = textures[i].mipChain.levels[targetLevels[i]].size;
+			if (evictedIndex == textures.size() || (unneeded && !evictedUnneeded) ||
+				(unneeded == evictedUnneeded && levelSize > evictedSize)) {
+				evictedIndex = i;
+				evictedUnneeded = unneeded;
+				evictedSize = levelSize;
+			}
+		}
+		//only the coarse levels are left - they stay resident regardless of the budget
+		if (evictedIndex == textures.size()) {
+			break;
+		}
+		targetBytes -= evictedSize;
+		targetLevels[evictedIndex]++;
+	}
+
+	//evictions first (they release memory), then stream-ins with the most missing levels
+	std::vector<size_t> evictions, streamIns;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		if (targetLevels[i] > textures[i].residentLevel) {
+			evictions.push_back(i);
+		}
+		else if (targetLevels[i] < textures[i].residentLevel) {
+			streamIns.push_back(i);
+		}
+	}
+	//one stream-in batch in flight at a time
+	if (!pendingBatches.empty() || pendingUploadValue != 0) {
+		streamIns.clear();
+	}
+	if (evictions.empty() && streamIns.empty()) {
+		return false;
+	}
+	std::sort(streamIns.begin(), streamIns.end(), [&](size_t a, size_t b) {
+		return textures[a].residentLevel - targetLevels[a] > textures[b].residentLevel - targetLevels[b];
+	});
+
+	//begun by load() if a texture can't be copied on the async upload queue
+	UploadBatch batch;
+	uint64_t oldVersion = version;
+	for (size_t index : evictions) {
+		load(textures[index], targetLevels[index], batch, asyncUploads);
+	}
+	VkDeviceSize uploadBytes = 0;
+	for (size_t index : streamIns) {
+		VkDeviceSize chainSize = getChainSize(textures[index], targetLevels[index]);
+		if (uploadBytes > 0 && uploadBytes + chainSize > maxUploadBytesPerUpdate) {
+			break;
+		}
+		if (!load(textures[index], targetLevels[index], batch, asyncUploads)) {
+			//out of device memory - stop growing at the current size
+			allocationLimit = residentBytes;
+			break;
+		}
+		uploadBytes += chainSize;
+	}
+
+	if (asyncUploads) {
+		uint64_t value = devices->asyncUploadQueue.submit();
+		pendingUploadValue = devices->asyncUploadQueue.isComplete(value) ? 0 : value;
+	}
+	if (batch.isRecording()) {
+		//copies & layout transitions are visible to every shader stage of the following submissions
+		VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(batch.getCommandBuffer(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		batch.submit();
+		pendingBatches.push_back(std::move(batch));
+	}
+	return version != oldVersion;
+}
+
+/*
+* estimated device memory size of a mip chain
+*
+* @param texture - streamed texture
+* @param level - finest level
+*
+* @return VkDeviceSize - byte size of the cpu levels [level, end)
+*/
+VkDeviceSize TextureStreamer::getChainSize(const StreamedTexture& texture, uint32_t level) {
+	VkDeviceSize size = 0;
+	for (size_t i = level; i < texture.mipChain.levels.size(); ++i) {
+		size += texture.mipChain.levels[i].size;
+	}
+	return size;
+}
+
+/*
+* budget of the streamed images
+* without a configured budget, the streamed images may use the part of the device local heap budget
+* which isn't used by other resources, except for heapReserve
+*
+* @return VkDeviceSize - bytes the streamed images can use
+*/
+VkDeviceSize TextureStreamer::getEffectiveBudget() const {
+	VkDeviceSize effectiveBudget = std::min<VkDeviceSize>(budget > 0 ? budget : VK_WHOLE_SIZE, allocationLimit);
+	if (budget > 0) {
+		return effectiveBudget;
+	}
+
+	VkDeviceSize heapBudget = 0;
+	MemoryAllocator::Statistics statistics = devices->memoryAllocator.getStatistics();
+	for (const MemoryAllocator::HeapStatistics& heap : statistics.heaps) {
+		if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) {
+			continue;
+		}
+		VkDeviceSize reserve = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * heapReserve);
+		VkDeviceSize otherUsage = heap.usage > residentBytes ? heap.usage - residentBytes : 0;
+		if (heap.budget > otherUsage + reserve) {
+			heapBudget = std::max(heapBudget, heap.budget - otherUsage - reserve);
+		}
+	}
+	return std::min(effectiveBudget, heapBudget);
+}
+
+/*
+* replace the image of a texture with the levels [level, end) of its mip chain
+* the old image & view are retired - frames in flight may still sample them (samplers are shared)
+*
+* @param streamedTexture - texture to reload
+* @param level - finest level of the new image
+* @param batch - upload batch recording the copy, begun if it isn't recording
+* @param async - copy on devices->asyncUploadQueue if the levels don't need decoding (batch isn't used)
+*
+* @return bool - false if the new image couldn't be allocated (the old image is kept)
+*/
+bool TextureStreamer::load(StreamedTexture& streamedTexture, uint32_t level, UploadBatch& batch, bool async) {
+	Texture2D newTexture;
+	try {
+		if (!async || !newTexture.loadAsync(devices, streamedTexture.mipChain, streamedTexture.filter,
+			streamedTexture.mode, level)) {
+			if (!batch.isRecording()) {
+				batch.begin(devices);
+			}
+			newTexture.load(devices, streamedTexture.mipChain, streamedTexture.filter, streamedTexture.mode, &batch, level);
+		}
+	}
+	catch (const std::runtime_error& error) {
+		//the allocation is the first thing which can fail - the image has no memory & no view yet
+		vkDestroyImage(devices->device, newTexture.image, nullptr);
+		LOG("texture streaming:\t" + std::string(error.what()));
+		return false;
+	}
+
+	Texture2D* texture = streamedTexture.texture;
+	devices->deletionQueue.retireImageView(texture->descriptor.imageView);
+	devices->deletionQueue.retireImage(texture->image);
+	*texture = newTexture;
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(devices->device, texture->image, &memRequirements);
+	residentBytes = residentBytes - streamedTexture.residentBytes + memRequirements.size;
+	streamedTexture.residentBytes = memRequirements.size;
+	streamedTexture.residentLevel = level;
+	version++;
+	return true;
+}
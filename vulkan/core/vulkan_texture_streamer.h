@@ -0,0 +1,92 @@
+#pragma once
+#include "vulkan_texture.h"
+
+struct VulkanDevice;
+
+/*
+* mip level streaming of 2d textures under a device memory budget
+* the whole mip chain of each texture stays on the cpu, only the coarse levels (<= residentSize) are uploaded at load time
+* owners request the finest level they need every update (distance / screen size heuristic),
+* finer levels are streamed in by non-blocking uploads & the finest levels are evicted when the budget is exceeded
+* uploads run on devices->asyncUploadQueue if timeline semaphores are supported - the frame using the new images
+* records their acquire barriers & waits on the upload queue (AsyncUploadQueue::recordAcquireBarriers)
+* a residency change replaces the image of the texture - the old image is retired through devices->deletionQueue
+* and the owner rewrites its descriptors when getVersion() changes
+*/
+class TextureStreamer {
+public:
+	/** @brief set devices handle */
+	void init(VulkanDevice* devices);
+	/** @brief wait for pending uploads & release cpu mip chains - textures are destroyed by their owner */
+	void cleanup();
+
+	/** @brief keep the mip chain on the cpu & load its coarse levels to the texture - returns index of the texture */
+	uint32_t addTexture(Texture2D* texture, CompressedImage&& mipChain, VkFilter filter, VkSamplerAddressMode mode,
+		UploadBatch& batch);
+	/** @brief request the finest mip level of a texture for the next update - the finest request is kept */
+	void requestLevel(uint32_t index, uint32_t level);
+	/** @brief stream in / evict mip levels to match the requests under the budget - returns true if a texture changed */
+	bool update();
+
+	/** @brief incremented whenever the image of a texture is replaced */
+	uint64_t getVersion() const { return version; }
+	/** @brief device memory size of every streamed image */
+	VkDeviceSize getResidentBytes() const { return residentBytes; }
+	/** @brief finest mip level of the texture in device memory (level of the cpu mip chain) */
+	uint32_t getResidentLevel(uint32_t index) const { return textures[index].residentLevel; }
+	/** @brief size of level 0 of the cpu mip chain */
+	VkExtent2D getExtent(uint32_t index) const { return { textures[index].mipChain.width, textures[index].mipChain.height }; }
+	/** @brief number of streamed textures */
+	uint32_t getTextureCount() const { return static_cast<uint32_t>(textures.size()); }
+
+	/** device memory budget of the streamed images - 0 to use the device local heap budget of the allocator */
+	VkDeviceSize budget = 0;
+	/** levels larger than this are streamed, smaller levels are always resident */
+	uint32_t residentSize = 128;
+	/** staged bytes of the textures streamed in by a single update (at least one texture per update) */
+	VkDeviceSize maxUploadBytesPerUpdate = 16 * 1024 * 1024;
+	/** fraction of the device local heap budget left to other resources if budget is 0 */
+	float heapReserve = 0.2f;
+
+private:
+	/** texture with its cpu mip chain */
+	struct StreamedTexture {
+		Texture2D* texture = nullptr;
+		CompressedImage mipChain;
+		VkFilter filter = VK_FILTER_LINEAR;
+		VkSamplerAddressMode mode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		/** finest level in device memory */
+		uint32_t residentLevel = 0;
+		/** finest level which is never evicted */
+		uint32_t coarsestLevel = 0;
+		/** finest level requested since the last update, NO_REQUEST if none */
+		uint32_t requestedLevel = 0;
+		/** memory requirement of the current image */
+		VkDeviceSize residentBytes = 0;
+	};
+	/** requestedLevel of a texture nobody asked for */
+	static constexpr uint32_t NO_REQUEST = UINT32_MAX;
+
+	/** @brief bytes of the mip chain from level to the end (estimated device memory size) */
+	static VkDeviceSize getChainSize(const StreamedTexture& texture, uint32_t level);
+	/** @brief budget of this update - configured budget limited by the heap budget & failed allocations */
+	VkDeviceSize getEffectiveBudget() const;
+	/** @brief replace the image of the texture with levels [level, end) - returns false if the allocation failed */
+	bool load(StreamedTexture& texture, uint32_t level, UploadBatch& batch, bool async = false);
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	std::vector<StreamedTexture> textures;
+	/** sum of residentBytes of every texture */
+	VkDeviceSize residentBytes = 0;
+	/** resident bytes when an allocation failed - streaming doesn't grow beyond it */
+	VkDeviceSize allocationLimit = VK_WHOLE_SIZE;
+	/** submitted stream-in batches waiting for their fences */
+	std::vector<UploadBatch> pendingBatches;
+	/** copy levels on devices->asyncUploadQueue instead of the graphics queue */
+	bool asyncUploads = false;
+	/** timeline value of the stream-in uploads in flight on devices->asyncUploadQueue, 0 if none */
+	uint64_t pendingUploadValue = 0;
+	/** incremented by every replaced image */
+	uint64_t version = 0;
+};
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <stdexcept>
+#include "vulkan_thread_pool.h"
+
+/*
+* start worker threads
+*
+* @param threadCount - number of worker threads, 0 to use the number of hardware threads
+*/
+void ThreadPool::init(uint32_t threadCount) {
+	if (!workers.empty()) {
+		throw std::runtime_error("ThreadPool::init() called multiple times");
+	}
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	stopping = false;
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+/*
+* finish queued tasks & join worker threads
+*/
+void ThreadPool::cleanup() {
+	if (workers.empty()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskQueued.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+/*
+* queue a task - executed by the first idle worker
+*
+* @param task - task to execute, must not throw
+*/
+void ThreadPool::submit(std::function<void()>&& task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	taskQueued.notify_one();
+}
+
+/*
+* block until every queued task is finished
+*/
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	taskFinished.wait(lock, [this]() { return tasks.empty() && runningTaskCount == 0; });
+}
+
+/*
+* worker thread loop - runs until cleanup() is called & the queue is empty
+*/
+void ThreadPool::work() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskQueued.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			if (tasks.empty()) {
+				return;
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+			runningTaskCount++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			runningTaskCount--;
+		}
+		taskFinished.notify_all();
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+* fixed number of worker threads executing submitted tasks in submission order
+* used for cpu-heavy loading work (image decode, mesh processing) - tasks must not throw
+*/
+class ThreadPool {
+public:
+	ThreadPool() {}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool() { cleanup(); }
+
+	/** @brief start worker threads - 0 uses the number of hardware threads */
+	void init(uint32_t threadCount = 0);
+	/** @brief finish queued tasks & join worker threads */
+	void cleanup();
+	/** @brief queue a task */
+	void submit(std::function<void()>&& task);
+	/** @brief block until every queued task is finished */
+	void wait();
+
+	/** @brief number of worker threads */
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+	/** @brief worker thread loop */
+	void work();
+
+	/** worker threads */
+	std::vector<std::thread> workers;
+	/** queued tasks */
+	std::deque<std::function<void()>> tasks;
+	/** number of tasks being executed */
+	size_t runningTaskCount = 0;
+	/** set by cleanup() */
+	bool stopping = false;
+	std::mutex mutex;
+	/** signaled when a task is queued or the pool is stopping */
+	std::condition_variable taskQueued;
+	/** signaled when a task is finished */
+	std::condition_variable taskFinished;
+};
@@ -0,0 +1,142 @@
+#include "vulkan_upload_batch.h"
+#include "vulkan_device.h"
+
+/*
+* start recording
+*
+* @param devices - abstracted vulkan device (physical / logical) pointer
+*/
+void UploadBatch::begin(VulkanDevice* devices) {
+	if (isRecording()) {
+		throw std::runtime_error("UploadBatch::begin(): batch is already recording");
+	}
+	this->devices = devices;
+	submitCount = 0;
+	stagedBytes = 0;
+	commandBuffer = devices->beginCommandBuffer();
+}
+
+/*
+* submit the remaining commands, wait for every submission of the batch & release its staging ranges
+* uploaded resources are ready to use after this call
+* can also be called after submit() - only waits for the submitted command buffers then
+*/
+void UploadBatch::end() {
+	if (!isRecording() && fences.empty()) {
+		throw std::runtime_error("UploadBatch::end(): batch is not recording");
+	}
+	if (isRecording()) {
+		flush(false);
+	}
+
+	VK_CHECK_RESULT(vkWaitForFences(devices->device, static_cast<uint32_t>(fences.size()), fences.data(),
+		VK_TRUE, UINT64_MAX));
+	//every fence is signaled - staging ranges are recycled before the fences are destroyed
+	devices->stagingBufferPool.collect();
+
+	vkFreeCommandBuffers(devices->device, devices->commandPool,
+		static_cast<uint32_t>(submittedCommandBuffers.size()), submittedCommandBuffers.data());
+	for (VkFence fence : fences) {
+		vkDestroyFence(devices->device, fence, nullptr);
+	}
+	submittedCommandBuffers.clear();
+	fences.clear();
+}
+
+/*
+* submit the remaining commands without waiting for them
+* commands submitted later to the graphics queue are ordered after the batch by its barriers,
+* end() must still be called to release staging ranges & command buffers (once isComplete() returns true)
+*/
+void UploadBatch::submit() {
+	if (!isRecording()) {
+		throw std::runtime_error("UploadBatch::submit(): batch is not recording");
+	}
+	flush(false);
+}
+
+/*
+* check the fences of the batch without blocking
+*
+* @return bool - true if every submission is finished
+*/
+bool UploadBatch::isComplete() const {
+	for (VkFence fence : fences) {
+		if (vkGetFenceStatus(devices->device, fence) != VK_SUCCESS) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+* copy data to a staging range - the range is released after the fence of the submission using it
+* submits the recorded commands first if the staging buffer pool can't hold more data
+*
+* @param data - data to be copied
+* @param size - byte size of data
+* @param alignment - offset alignment, 0 to use the default alignment of the pool
+*
+* @return StagingBufferPool::Allocation - copy source of the recorded command
+*/
+StagingBufferPool::Allocation UploadBatch::stage(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+	if (stagedBytes > 0 && stagedBytes + size > devices->stagingBufferPool.getCapacity()) {
+		flush(true);
+	}
+	StagingBufferPool::Allocation allocation = devices->stagingBufferPool.upload(data, size, alignment);
+	stagingRanges.push_back(allocation);
+	stagedBytes += size;
+	return allocation;
+}
+
+/*
+* create device local buffer & record copy of data to it
+*
+* @param buffer - return buffer handle
+* @param data - data to be copied
+* @param size - byte size of data
+* @param usage - buffer usage (TRANSFER_DST is added)
+*/
+void UploadBatch::uploadBuffer(VkBuffer& buffer, const void* data, VkDeviceSize size, VkBufferUsageFlags usage) {
+	StagingBufferPool::Allocation staging = stage(data, size);
+
+	devices->createBuffer(buffer, size,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	);
+
+	VkBufferCopy bufferCopyRegion{};
+	bufferCopyRegion.srcOffset = staging.offset;
+	bufferCopyRegion.dstOffset = 0;
+	bufferCopyRegion.size = size;
+	vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer, 1, &bufferCopyRegion);
+}
+
+/*
+* submit recorded commands with a new fence - staging ranges are handed back to the pool with that fence
+*
+* @param restart - begin a new command buffer after the submission
+*/
+void UploadBatch::flush(bool restart) {
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+	VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	VkFence fence = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateFence(devices->device, &fenceInfo, nullptr, &fence));
+
+	VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	VK_CHECK_RESULT(vkQueueSubmit(devices->graphicsQueue, 1, &submitInfo, fence));
+
+	for (const auto& stagingRange : stagingRanges) {
+		devices->stagingBufferPool.free(stagingRange, fence);
+	}
+	stagingRanges.clear();
+	stagedBytes = 0;
+	submittedCommandBuffers.push_back(commandBuffer);
+	fences.push_back(fence);
+	submitCount++;
+
+	commandBuffer = restart ? devices->beginCommandBuffer() : VK_NULL_HANDLE;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "vulkan_staging_buffer_pool.h"
+
+struct VulkanDevice;
+
+/*
+* records many uploads (buffer / image copies, layout transitions, mip generation) into one command buffer
+* the batch is submitted with a single fence & staging ranges are released only after that fence
+* if the staged data outgrows the staging buffer pool, the recorded part is submitted early & recording continues
+*/
+class UploadBatch {
+public:
+	/** @brief start recording */
+	void begin(VulkanDevice* devices);
+	/** @brief submit the remaining commands, wait for every submission & release staging ranges */
+	void end();
+	/** @brief submit the remaining commands without waiting - end() releases the batch later */
+	void submit();
+	/** @brief true if every submission of the batch is finished (end() won't block) */
+	bool isComplete() const;
+	/** @brief true between begin() & end() */
+	bool isRecording() const { return commandBuffer != VK_NULL_HANDLE; }
+
+	/** @brief command buffer of the batch - record layout transitions, mip generation etc. */
+	VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+	/** @brief copy data to a staging range released when the batch is finished */
+	StagingBufferPool::Allocation stage(const void* data, VkDeviceSize size, VkDeviceSize alignment = 0);
+	/** @brief create device local buffer & record copy of data to it */
+	void uploadBuffer(VkBuffer& buffer, const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
+
+	/** number of submissions of the last batch */
+	uint32_t submitCount = 0;
+
+private:
+	/** @brief submit recorded commands with a new fence & start a new command buffer */
+	void flush(bool restart);
+
+	/** devices handle */
+	VulkanDevice* devices = nullptr;
+	/** command buffer being recorded */
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	/** staging ranges used by the command buffer being recorded */
+	std::vector<StagingBufferPool::Allocation> stagingRanges;
+	/** bytes staged by the command buffer being recorded */
+	VkDeviceSize stagedBytes = 0;
+	/** submitted command buffers & their fences */
+	std::vector<VkCommandBuffer> submittedCommandBuffers;
+	std::vector<VkFence> fences;
+};
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <string>
 #include "vulkan_utils.h"
 
@@ -695,4 +696,42 @@ namespace vktools {
 		scissor.extent = extent;
 		vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
 	}
+
+	/*
+	* fast non-cryptographic hash - 8 bytes per step & murmur3 finalizer
+	* equal hashes don't guarantee equal data, callers compare the bytes of matching keys
+	*
+	* @param data - bytes to hash
+	* @param size - byte size of data
+	* @param seed - initial value, e.g. hash of another part of the key
+	*
+	* @return uint64_t - hash of the bytes
+	*/
+	uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+		const uint64_t PRIME0 = 0x9E3779B97F4A7C15ull, PRIME1 = 0xC2B2AE3D27D4EB4Full;
+		auto rotl = [](uint64_t value, int shift) { return (value << shift) | (value >> (64 - shift)); };
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+		uint64_t hash = seed ^ (static_cast<uint64_t>(size) * PRIME1);
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, bytes + i, 8);
+			hash ^= rotl(word * PRIME1, 31) * PRIME0;
+			hash = rotl(hash, 27) * 5 + 0x52DCE729;
+		}
+		//remaining 0-7 bytes
+		uint64_t tail = 0;
+		for (size_t shift = 0; i < size; ++i, shift += 8) {
+			tail |= static_cast<uint64_t>(bytes[i]) << shift;
+		}
+		hash ^= rotl(tail * PRIME1, 31) * PRIME0;
+
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
 }
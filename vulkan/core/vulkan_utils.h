@@ -168,6 +168,8 @@ namespace vktools {
 	VkDeviceAddress getBufferDeviceAddress(VkDevice device, VkBuffer buffer);
 	/** @brief convert glm mat4 to VkTransformMatrixKHR */
 	VkTransformMatrixKHR toTransformMatrixKHR(const glm::mat4& mat);
+	/** @brief fast non-cryptographic 64 bit hash of bytes (content keys of caches) */
+	uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
 
 	namespace initializers {
 		inline VkBufferCreateInfo bufferCreateInfo(VkDeviceSize size,
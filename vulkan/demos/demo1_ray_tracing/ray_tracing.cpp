@@ -27,6 +27,7 @@ public:
 		}
 
 		ImGui::End();
+		drawMemoryStatistics();
 		ImGui::Render();
 	}
 
@@ -63,8 +64,7 @@ public:
 		imguiBase->cleanup();
 		delete imguiBase;
 
-		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer);
 		vkDestroyBuffer(devices.device, rtSBTBuffer, nullptr);
 		vkDestroyPipeline(devices.device, offscreenPipeline, nullptr);
 		vkDestroyPipelineLayout(devices.device, offscreenPipelineLayout, nullptr);
@@ -74,7 +74,7 @@ public:
 		vkDestroyPipelineLayout(devices.device, postPipelineLayout, nullptr);
 		vkDestroyRenderPass(devices.device, postRenderPass, nullptr);
 
-		devices.memoryAllocator.freeBufferMemory(sceneBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(sceneBuffer);
 		vkDestroyBuffer(devices.device, sceneBuffer, nullptr);
 
 		//BLAS
@@ -84,23 +84,19 @@ public:
 			vkDestroyBuffer(devices.device, as.buffer, nullptr);
 		}
 
-		//instance buffer
-		devices.memoryAllocator.freeBufferMemory(instanceBuffer);
-		vkDestroyBuffer(devices.device, instanceBuffer, nullptr);
-
 		//TLAS
 		vkfp::vkDestroyAccelerationStructureKHR(devices.device, tlas.accel, nullptr);
 		devices.memoryAllocator.freeBufferMemory(tlas.buffer);
 		vkDestroyBuffer(devices.device, tlas.buffer, nullptr);
 
 		//vertex & index buffers
-		devices.memoryAllocator.freeBufferMemory(bunnyVertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(bunnyVertexBuffer);
 		vkDestroyBuffer(devices.device, bunnyVertexBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(bunnyIndexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(bunnyIndexBuffer);
 		vkDestroyBuffer(devices.device, bunnyIndexBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(teapotVertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(teapotVertexBuffer);
 		vkDestroyBuffer(devices.device, teapotVertexBuffer, nullptr);
-		devices.memoryAllocator.freeBufferMemory(teapotIndexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(teapotIndexBuffer);
 		vkDestroyBuffer(devices.device, teapotIndexBuffer, nullptr);
 
 		//swapchain framebuffers
@@ -126,13 +122,6 @@ public:
 		vkDestroyDescriptorSetLayout(devices.device, rtDescriptorSetLayout, nullptr);
 		vkDestroyDescriptorPool(devices.device, postDescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(devices.device, postDescriptorSetLayout, nullptr);
-
-		//uniform buffers
-		for (auto& uniformBuffer : uniformBuffers) {
-			devices.memoryAllocator.freeBufferMemory(uniformBuffer,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			vkDestroyBuffer(devices.device, uniformBuffer, nullptr);
-		}
 	}
 
 	/*
@@ -158,12 +147,6 @@ public:
 		//create & build top-level acceleration structure
 		createTopLevelAccelerationStructure();
 
-		//uniform buffers
-		createUniformbuffer();
-		for (size_t i = 0; i < static_cast<int>(MAX_FRAMES_IN_FLIGHT); ++i) {
-			updateUniformBuffer(i);
-		}
-
 		//push bunny obj instance
 		objInstances.push_back({ glm::mat4(1.f), glm::mat4(1.f),
 			vktools::getBufferDeviceAddress(devices.device, bunnyVertexBuffer),
@@ -217,20 +200,29 @@ public:
 		createPostPipeline();
 
 		//imgui
-		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT);
+		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT, &frameRingBuffer);
 		//framebuffer
 		createFramebuffers();
 		//command buffer
 		recordCommandBuffer();
 	}
 
+	/*
+	* update - reserve the camera matrices before the ui geometry
+	* pre-recorded command buffers bind them at the beginning of the frame region
+	*/
+	virtual void update() override {
+		cameraMatricesAllocation = frameRingBuffer.allocate(sizeof(CameraMatrices));
+		VulkanAppBase::update();
+	}
+
 	/*
 	* draw
 	*/
 	virtual void draw() override {
 		uint32_t imageIndex = prepareFrame();
 
-		updateUniformBuffer(currentFrame);
+		updateUniformBuffer();
 
 		//render
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT };
@@ -373,12 +365,8 @@ private:
 	std::vector<AccelKHR> blasHandles;
 	/** top-level acceleration structure */
 	AccelKHR tlas{};
-	/** instance buffer for tlas */
-	VkBuffer instanceBuffer = VK_NULL_HANDLE;
-	/** uniform buffers for camera matrices */
-	std::vector<VkBuffer> uniformBuffers;
-	/** uniform buffer memories */
-	std::vector<MemoryAllocator::HostVisibleMemory> uniformBufferMemories;
+	/** camera matrices of the current frame - first allocation of the frame in frameRingBuffer */
+	FrameRingBuffer::Allocation cameraMatricesAllocation{};
 
 
 	/*
@@ -513,7 +501,7 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, buffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeBufferMemory(stagingBuffer);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -589,7 +577,7 @@ private:
 			instance.mask = 0xFF;
 			instances.push_back(instance);
 		}
-		buildTlas(&devices, instances, tlas, instanceBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+		buildTlas(&devices, instances, tlas, &frameRingBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
 	}
 
 	/*
@@ -676,8 +664,8 @@ private:
 	* create (normal) descriptor set - set camera matrix uniform buffer & scene description buffer
 	*/
 	void createDescriptorSet() {
-		//camera matrix
-		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+		//camera matrix - dynamic offset in frameRingBuffer
+		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR);
 		//scene description
 		descriptorSetBindings.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
@@ -689,7 +677,7 @@ private:
 		descriptorSets = vktools::allocateDescriptorSets(devices.device, descriptorSetLayout, descriptorPool, nbDescriptorSet);
 
 		for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++i) {
-			VkDescriptorBufferInfo camMatricesInfo{ uniformBuffers[i], 0, sizeof(CameraMatrices) };
+			VkDescriptorBufferInfo camMatricesInfo{ frameRingBuffer.getBuffer(), 0, sizeof(CameraMatrices) };
 			VkDescriptorBufferInfo sceneBufferInfo{ sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance) };
 
 			std::vector<VkWriteDescriptorSet> writes;
@@ -870,7 +858,7 @@ private:
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 		//map data
-		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle(devices.device));
+		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle());
 		for (uint32_t g = 0; g < groupCount; ++g) {
 			memcpy(pData, shaderHandleStorage.data() + g * groupHandleSize, groupHandleSize);
 			pData += groupSizeAligned;
@@ -923,31 +911,12 @@ private:
 		vkUpdateDescriptorSets(devices.device, 1, &wd, 0, nullptr);
 	}
 
-	/*
-	* create uniform buffers - camera matrices
-	*/
-	void createUniformbuffer() {
-		VkDeviceSize size = sizeof(CameraMatrices);
-		uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-		uniformBufferMemories.resize(MAX_FRAMES_IN_FLIGHT);
-
-		VkBufferCreateInfo info = vktools::initializers::bufferCreateInfo(size,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkCreateBuffer(devices.device, &info, nullptr, &uniformBuffers[i]));
-			uniformBufferMemories[i] = devices.memoryAllocator.allocateBufferMemory(uniformBuffers[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		}
-	}
-
 	/*
 	* update uniform buffer - camera matrices
-	* 
-	* @param currentFrame - index of uniform buffer (0 <= currentFrame < MAX_FRAMES_IN_FLIGHT)
+	* written to the range reserved in update()
 	*/
-	void updateUniformBuffer(size_t currentFrame) {
-		uniformBufferMemories[currentFrame].mapData(devices.device, &cameraMatrices);
+	void updateUniformBuffer() {
+		memcpy(cameraMatricesAllocation.data, &cameraMatrices, sizeof(CameraMatrices));
 	}
 
 	/*
@@ -960,8 +929,10 @@ private:
 		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipeline);
 
 		std::vector<VkDescriptorSet> descSets{ rtDescriptorSets[descriptorSetIndex], descriptorSets[descriptorSetIndex] };
+		//camera matrices are the first allocation of the frame
+		uint32_t cameraMatricesOffset = static_cast<uint32_t>(frameRingBuffer.getFrameOffset(descriptorSetIndex));
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipelineLayout,
-			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 1, &cameraMatricesOffset);
 		vkCmdPushConstants(cmdBuf, rtPipelineLayout,
 			VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR,
 			0, sizeof(RtPushConstant), &rtPushConstants);
@@ -993,8 +964,9 @@ private:
 	void rasterize(VkCommandBuffer cmdBuf, size_t resourceIndex) {
 		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
 		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
+		uint32_t cameraMatricesOffset = static_cast<uint32_t>(frameRingBuffer.getFrameOffset(resourceIndex));
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout,
-			0, 1, &descriptorSets[resourceIndex], 0, nullptr);
+			0, 1, &descriptorSets[resourceIndex], 1, &cameraMatricesOffset);
 
 		VkDeviceSize offsets[1] = { 0 };
 		for (auto& obj : objInstances) {
@@ -77,6 +77,7 @@ public:
 		}
 
 		ImGui::End();
+		drawMemoryStatistics();
 		ImGui::Render();
 	}
 
@@ -133,8 +134,7 @@ public:
 		imguiBase->cleanup();
 		delete imguiBase;
 
-		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer);
 		vkDestroyBuffer(devices.device, rtSBTBuffer, nullptr);
 		vkDestroyPipeline(devices.device, offscreenPipeline, nullptr);
 		vkDestroyPipelineLayout(devices.device, offscreenPipelineLayout, nullptr);
@@ -144,7 +144,7 @@ public:
 		vkDestroyPipelineLayout(devices.device, postPipelineLayout, nullptr);
 		vkDestroyRenderPass(devices.device, postRenderPass, nullptr);
 
-		devices.memoryAllocator.freeBufferMemory(sceneBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(sceneBuffer);
 		vkDestroyBuffer(devices.device, sceneBuffer, nullptr);
 
 		//BLAS
@@ -154,10 +154,6 @@ public:
 			vkDestroyBuffer(devices.device, as.buffer, nullptr);
 		}
 
-		//instance buffer
-		devices.memoryAllocator.freeBufferMemory(instanceBuffer);
-		vkDestroyBuffer(devices.device, instanceBuffer, nullptr);
-
 		//TLAS
 		vkfp::vkDestroyAccelerationStructureKHR(devices.device, tlas.accel, nullptr);
 		devices.memoryAllocator.freeBufferMemory(tlas.buffer);
@@ -187,13 +183,6 @@ public:
 		vkDestroyDescriptorPool(devices.device, postDescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(devices.device, postDescriptorSetLayout, nullptr);
 
-		//uniform buffers
-		for (auto& uniformBuffer : matricesUniformBuffer) {
-			devices.memoryAllocator.freeBufferMemory(uniformBuffer,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			vkDestroyBuffer(devices.device, uniformBuffer, nullptr);
-		}
-
 		//models
 		gltfDioramaModel.cleanup();
 	}
@@ -221,12 +210,6 @@ public:
 		//create & build top-level acceleration structure
 		createTopLevelAccelerationStructure();
 
-		//uniform buffers
-		createUniformbuffer();
-		for (size_t i = 0; i < static_cast<int>(MAX_FRAMES_IN_FLIGHT); ++i) {
-			updateUniformBuffer(i);
-		}
-
 		//push bunny obj instance
 		objInstances.push_back({ glm::mat4(1.f), glm::mat4(1.f),
 			vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.vertexBuffer),
@@ -284,7 +267,7 @@ public:
 		createPostPipeline();
 
 		//imgui
-		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT);
+		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT, &frameRingBuffer);
 		//framebuffer
 		createFramebuffers();
 		//command buffer
@@ -297,18 +280,27 @@ public:
 	virtual void draw() override {
 		uint32_t imageIndex = prepareFrame();
 
-		updateUniformBuffer(currentFrame);
+		updateUniformBuffer();
 
-		//render
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT };
+		//fence of this frame is waited in prepareFrame() - its command buffer is no longer pending
+		buildCommandBuffer(imageIndex);
+
+		//render - waits on image acquisition (& streamed textures acquired by the command buffer)
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+		std::array<VkSemaphore, 2> waitSemaphores = { presentCompleteSemaphores[currentFrame],
+			devices.asyncUploadQueue.getTimelineSemaphore() };
+		std::array<uint64_t, 2> waitValues = { 0, asyncUploadWaitValue }; //binary semaphore value is ignored
+		VkTimelineSemaphoreSubmitInfo timelineInfo{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
+		submitInfo.pNext = asyncUploadWaitValue > 0 ? &timelineInfo : nullptr;
+		submitInfo.waitSemaphoreCount = asyncUploadWaitValue > 0 ? 2 : 1;
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
 		submitInfo.pWaitDstStageMask = waitStages;
 		submitInfo.commandBufferCount = 1;
-		size_t commandBufferIndex = imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
+		submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
 		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
@@ -318,16 +310,25 @@ public:
 
 	virtual void update() override {
 		VulkanAppBase::update();
+		//model buffers / images moved by memory defragmentation
+		if (sceneResourceVersion != gltfDioramaModel.getResourceVersion()) {
+			updateMovedSceneResources();
+		}
 		Imgui* imgui = static_cast<Imgui*>(imguiBase);
-		if (oldViewMatrix != cameraMatrices.view || imgui->frameReset) {
+		//texture streaming - image descriptors of this frame are rewritten once the images changed
+		gltfDioramaModel.updateTextureStreaming(camera.camPos, cameraMatrices.proj, swapchain.extent.height);
+		bool imagesChanged = imageDescriptorVersions[currentFrame] != gltfDioramaModel.textureStreamer.getVersion();
+		if (imagesChanged) {
+			updateImageDescriptors(currentFrame);
+		}
+
+		if (oldViewMatrix != cameraMatrices.view || imgui->frameReset || imagesChanged) {
 			rtPushConstants.frame = -1;
 			oldViewMatrix = cameraMatrices.view;
 			if (imgui->frameReset)
 				imgui->frameReset = false;
 		}
 		rtPushConstants.frame++;
-
-		buildCommandBuffer();
 	}
 
 	/*
@@ -363,9 +364,11 @@ public:
 	virtual void recordCommandBuffer() override { }
 
 	/*
-	* record command buffer every frame
+	* record command buffer of the current frame every frame
+	*
+	* @param imageIndex - index of the acquired swapchain image
 	*/
-	void buildCommandBuffer() {
+	void buildCommandBuffer(uint32_t imageIndex) {
 		VkCommandBufferBeginInfo cmdBufBeginInfo{};
 		cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		cmdBufBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -396,43 +399,62 @@ public:
 		postRenderPassBeginInfo.renderPass = postRenderPass;
 		postRenderPassBeginInfo.renderArea = { {0, 0},swapchain.extent };
 
-		for (size_t i = 0; i < framebuffers.size(); ++i) {
-			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
+		VkCommandBuffer cmdBuf = commandBuffers[currentFrame];
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuf, &cmdBufBeginInfo));
+
+		//textures streamed in on the transfer queue - ownership transfer before their first use
+		asyncUploadWaitValue = devices.asyncUploadQueue.recordAcquireBarriers(cmdBuf);
+
+		//scene description of the moved buffers - written before any shader of this frame reads it
+		if (sceneBufferOutdated) {
+			vkCmdUpdateBuffer(cmdBuf, sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance), objInstances.data());
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+				VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+				0,
+				1, &barrier,
+				0, nullptr,
+				0, nullptr
+			);
+			sceneBufferOutdated = false;
+		}
 
-			//#1 raytracing
-			if (static_cast<Imgui*>(imguiBase)->userInput.renderMode == Imgui::RENDER_MODE::RAYRACE) {
-				vkdebug::marker::beginLabel(commandBuffers[i], "raytrace");
-				raytrace(commandBuffers[i], currentFrame);
-				vkdebug::marker::endLabel(commandBuffers[i]);
-			}
-			//#1 or rasterization
-			else {
-				vkdebug::marker::beginLabel(commandBuffers[i], "rasterize");
-				offscreenRenderPassBeginInfo.framebuffer = offscreenFramebuffers[currentFrame].framebuffer;
-				vkCmdBeginRenderPass(commandBuffers[i], &offscreenRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-				rasterize(commandBuffers[i], currentFrame);
-				vkCmdEndRenderPass(commandBuffers[i]);
-				vkdebug::marker::endLabel(commandBuffers[i]);
-			}
+		//#1 raytracing
+		if (static_cast<Imgui*>(imguiBase)->userInput.renderMode == Imgui::RENDER_MODE::RAYRACE) {
+			vkdebug::marker::beginLabel(cmdBuf, "raytrace");
+			raytrace(cmdBuf, currentFrame);
+			vkdebug::marker::endLabel(cmdBuf);
+		}
+		//#1 or rasterization
+		else {
+			vkdebug::marker::beginLabel(cmdBuf, "rasterize");
+			offscreenRenderPassBeginInfo.framebuffer = offscreenFramebuffers[currentFrame].framebuffer;
+			vkCmdBeginRenderPass(cmdBuf, &offscreenRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			rasterize(cmdBuf, currentFrame);
+			vkCmdEndRenderPass(cmdBuf);
+			vkdebug::marker::endLabel(cmdBuf);
+		}
 
-			//#2 full screen quad
-			vkdebug::marker::beginLabel(commandBuffers[i], "full screen quad");
-			size_t framebufferIndex = i % framebuffers.size();
-			postRenderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
-			vkCmdBeginRenderPass(commandBuffers[i], &postRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		//#2 full screen quad
+		vkdebug::marker::beginLabel(cmdBuf, "full screen quad");
+		postRenderPassBeginInfo.framebuffer = framebuffers[imageIndex];
+		vkCmdBeginRenderPass(cmdBuf, &postRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1,
-				&postDescriptorSet[currentFrame], 0, nullptr);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0); //full screen triangle
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1,
+			&postDescriptorSet[currentFrame], 0, nullptr);
+		vkCmdDraw(cmdBuf, 3, 1, 0, 0); //full screen triangle
 
-			imguiBase->drawFrame(commandBuffers[i], currentFrame);
+		imguiBase->drawFrame(cmdBuf, currentFrame);
 
-			vkCmdEndRenderPass(commandBuffers[i]);
-			vkdebug::marker::endLabel(commandBuffers[i]);
-			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
-		}
+		vkCmdEndRenderPass(cmdBuf);
+		vkdebug::marker::endLabel(cmdBuf);
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuf));
 	}
 
 	/*
@@ -463,12 +485,8 @@ private:
 	std::vector<AccelKHR> blasHandles;
 	/** top-level acceleration structure */
 	AccelKHR tlas{};
-	/** instance buffer for tlas */
-	VkBuffer instanceBuffer = VK_NULL_HANDLE;
-	/** uniform buffers for camera matrices */
-	std::vector<VkBuffer> matricesUniformBuffer;
-	/** uniform buffer memories */
-	std::vector<MemoryAllocator::HostVisibleMemory> matricesUniformBufferMemory;
+	/** dynamic offset of the camera matrices of the current frame in frameRingBuffer */
+	uint32_t cameraMatricesOffset = 0;
 	/** gltf model */
 	VulkanGLTF gltfDioramaModel;
 	/** view matrix of previous frame */
@@ -495,6 +513,10 @@ private:
 	std::vector<ObjInstance> objInstances;
 	/** obj instances buffer */
 	VkBuffer sceneBuffer = VK_NULL_HANDLE;
+	/** VulkanGLTF::getResourceVersion() of the addresses in objInstances & the scene descriptors */
+	uint64_t sceneResourceVersion = 0;
+	/** objInstances rewritten after a defragmentation move - copied to sceneBuffer by the next command buffer */
+	bool sceneBufferOutdated = false;
 
 
 	/*
@@ -510,6 +532,10 @@ private:
 	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 	/** descriptor sets */
 	std::vector<VkDescriptorSet> descriptorSets;
+	/** texture streamer version of the images written to each descriptor set */
+	std::vector<uint64_t> imageDescriptorVersions;
+	/** async upload timeline value the submission of the frame waits on, 0 if none */
+	uint64_t asyncUploadWaitValue = 0;
 
 
 	/*
@@ -624,7 +650,7 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, buffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeBufferMemory(stagingBuffer);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -636,6 +662,7 @@ private:
 		VkBufferUsageFlags rtFlags = 
 			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
 			VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+		gltfDioramaModel.streamTextures = true;
 		gltfDioramaModel.loadScene(&devices, "../../meshes/pica_pica_mini_diorama/scene.gltf", rtFlags);
 
 		std::vector<BlasGeometries> allBlas{}; //array of blas
@@ -671,7 +698,7 @@ private:
 			instance.mask = 0xFF;
 			instances.push_back(instance);
 		}
-		buildTlas(&devices, instances, tlas, instanceBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+		buildTlas(&devices, instances, tlas, &frameRingBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
 	}
 
 	/*
@@ -764,8 +791,8 @@ private:
 	* create (normal) descriptor set - set camera matrix uniform buffer & scene description buffer
 	*/
 	void createDescriptorSet() {
-		//camera matrix
-		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+		//camera matrix - dynamic offset in frameRingBuffer
+		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR);
 		//scene description
 		descriptorSetBindings.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
@@ -778,21 +805,61 @@ private:
 		descriptorPool = descriptorSetBindings.createDescriptorPool(devices.device, nbDescriptorSet);
 		descriptorSets = vktools::allocateDescriptorSets(devices.device, descriptorSetLayout, descriptorPool, nbDescriptorSet);
 
-		std::vector<VkDescriptorImageInfo> imageInfos{};
-		for (auto& image : gltfDioramaModel.images) {
-			imageInfos.emplace_back(image.descriptor);
-		}
-
 		for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++i) {
-			VkDescriptorBufferInfo camMatricesInfo{ matricesUniformBuffer[i], 0, sizeof(CameraMatrices) };
+			VkDescriptorBufferInfo camMatricesInfo{ frameRingBuffer.getBuffer(), 0, sizeof(CameraMatrices) };
 			VkDescriptorBufferInfo sceneBufferInfo{ sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance) };
 
 			std::vector<VkWriteDescriptorSet> writes;
 			writes.emplace_back(descriptorSetBindings.makeWrite(descriptorSets[i], 0, &camMatricesInfo));
 			writes.emplace_back(descriptorSetBindings.makeWrite(descriptorSets[i], 1, &sceneBufferInfo));
-			writes.emplace_back(descriptorSetBindings.makeWriteArray(descriptorSets[i], 2, imageInfos.data()));
 			vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 		}
+
+		imageDescriptorVersions.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++i) {
+			updateImageDescriptors(i);
+		}
+	}
+
+	/*
+	* write the current images of the model (replaced by texture streaming) to a descriptor set
+	*
+	* @param currentFrame - index of descriptor set (0 <= currentFrame < MAX_FRAMES_IN_FLIGHT)
+	*/
+	void updateImageDescriptors(size_t currentFrame) {
+		std::vector<VkDescriptorImageInfo> imageInfos{};
+		for (auto& image : gltfDioramaModel.images) {
+			imageInfos.emplace_back(image.descriptor);
+		}
+		VkWriteDescriptorSet write = descriptorSetBindings.makeWriteArray(descriptorSets[currentFrame], 2, imageInfos.data());
+		vkUpdateDescriptorSets(devices.device, 1, &write, 0, nullptr);
+		imageDescriptorVersions[currentFrame] = gltfDioramaModel.textureStreamer.getVersion();
+	}
+
+	/*
+	* rewrite device addresses & descriptors of the model buffers / images moved by memory defragmentation
+	* every frame in flight was waited by defragmentMemory(), so all descriptor sets are rewritten at once
+	*/
+	void updateMovedSceneResources() {
+		ObjInstance& instance = objInstances[0];
+		instance.vertexAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.vertexBuffer);
+		instance.IndexAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.indexBuffer);
+		instance.normalAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.normalBuffer);
+		instance.uvAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.uvBuffer);
+		instance.colorAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.colorBuffer);
+		instance.tangentAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.tangentBuffer);
+		instance.materialIndicesAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.materialIndicesBuffer);
+		instance.materialAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.materialBuffer);
+		instance.primitiveAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.primitiveBuffer);
+		sceneBufferOutdated = true;
+
+		VkDescriptorBufferInfo primitiveInfo{ gltfDioramaModel.primitiveBuffer, 0, VK_WHOLE_SIZE };
+		for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++i) {
+			updateImageDescriptors(i);
+			VkWriteDescriptorSet write = rtDescriptorSetBindings.makeWrite(rtDescriptorSets[i], 2, &primitiveInfo);
+			vkUpdateDescriptorSets(devices.device, 1, &write, 0, nullptr);
+		}
+		sceneResourceVersion = gltfDioramaModel.getResourceVersion();
 	}
 
 	/*
@@ -983,7 +1050,7 @@ private:
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 		//map data
-		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle(devices.device));
+		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle());
 		for (uint32_t g = 0; g < groupCount; ++g) {
 			memcpy(pData, shaderHandleStorage.data() + g * groupHandleSize, groupHandleSize);
 			pData += groupSizeAligned;
@@ -1036,31 +1103,12 @@ private:
 		vkUpdateDescriptorSets(devices.device, 1, &wd, 0, nullptr);
 	}
 
-	/*
-	* create uniform buffers - camera matrices
-	*/
-	void createUniformbuffer() {
-		VkDeviceSize size = sizeof(CameraMatrices);
-		matricesUniformBuffer.resize(MAX_FRAMES_IN_FLIGHT);
-		matricesUniformBufferMemory.resize(MAX_FRAMES_IN_FLIGHT);
-
-		VkBufferCreateInfo info = vktools::initializers::bufferCreateInfo(size,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkCreateBuffer(devices.device, &info, nullptr, &matricesUniformBuffer[i]));
-			matricesUniformBufferMemory[i] = devices.memoryAllocator.allocateBufferMemory(matricesUniformBuffer[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		}
-	}
-
 	/*
 	* update uniform buffer - camera matrices
-	*
-	* @param currentFrame - index of uniform buffer (0 <= currentFrame < MAX_FRAMES_IN_FLIGHT)
+	* copied to the frame ring buffer of the current frame, bound with cameraMatricesOffset
 	*/
-	void updateUniformBuffer(size_t currentFrame) {
-		matricesUniformBufferMemory[currentFrame].mapData(devices.device, &cameraMatrices);
+	void updateUniformBuffer() {
+		cameraMatricesOffset = static_cast<uint32_t>(frameRingBuffer.upload(&cameraMatrices, sizeof(CameraMatrices)).offset);
 	}
 
 	/*
@@ -1078,7 +1126,7 @@ private:
 
 		std::vector<VkDescriptorSet> descSets{ rtDescriptorSets[descriptorSetIndex], descriptorSets[descriptorSetIndex] };
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipelineLayout,
-			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 1, &cameraMatricesOffset);
 		vkCmdPushConstants(cmdBuf, rtPipelineLayout,
 			VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR,
 			0, sizeof(RtPushConstant), &rtPushConstants);
@@ -1111,7 +1159,7 @@ private:
 		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
 		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout,
-			0, 1, &descriptorSets[resourceIndex], 0, nullptr);
+			0, 1, &descriptorSets[resourceIndex], 1, &cameraMatricesOffset);
 
 		//bind vertex / index buffers
 		VkDeviceSize offsets[3] = { 0, 0, 0 };
@@ -73,6 +73,7 @@ public:
 		}
 
 		ImGui::End();
+		drawMemoryStatistics();
 		ImGui::Render();
 	}
 
@@ -123,8 +124,7 @@ public:
 		imguiBase->cleanup();
 		delete imguiBase;
 
-		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer);
 		vkDestroyBuffer(devices.device, rtSBTBuffer, nullptr);
 		vkDestroyPipeline(devices.device, rtPipeline, nullptr);
 		vkDestroyPipelineLayout(devices.device, rtPipelineLayout, nullptr);
@@ -135,7 +135,7 @@ public:
 		vkDestroyPipelineLayout(devices.device, imageFilteringPipelineLayout, nullptr);
 		vkDestroyRenderPass(devices.device, imageFilteringRenderPass, nullptr);
 
-		devices.memoryAllocator.freeBufferMemory(sceneBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(sceneBuffer);
 		vkDestroyBuffer(devices.device, sceneBuffer, nullptr);
 
 		//BLAS
@@ -145,10 +145,6 @@ public:
 			vkDestroyBuffer(devices.device, as.buffer, nullptr);
 		}
 
-		//instance buffer
-		devices.memoryAllocator.freeBufferMemory(instanceBuffer);
-		vkDestroyBuffer(devices.device, instanceBuffer, nullptr);
-
 		//TLAS
 		vkfp::vkDestroyAccelerationStructureKHR(devices.device, tlas.accel, nullptr);
 		devices.memoryAllocator.freeBufferMemory(tlas.buffer);
@@ -180,13 +176,6 @@ public:
 		vkDestroyDescriptorPool(devices.device, imageFilteringDescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(devices.device, imageFilteringDescriptorSetLayout, nullptr);
 
-		//uniform buffers
-		for (auto& uniformBuffer : uniformBuffers) {
-			devices.memoryAllocator.freeBufferMemory(uniformBuffer,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			vkDestroyBuffer(devices.device, uniformBuffer, nullptr);
-		}
-
 		//models
 		gltfDioramaModel.cleanup();
 	}
@@ -214,12 +203,6 @@ public:
 		//create & build top-level acceleration structure
 		createTopLevelAccelerationStructure();
 
-		//uniform buffers
-		createUniformbuffer();
-		for (size_t i = 0; i < static_cast<int>(MAX_FRAMES_IN_FLIGHT); ++i) {
-			updateUniformBuffer(i);
-		}
-
 		//push bunny obj instance
 		objInstances.push_back({ glm::mat4(1.f), glm::mat4(1.f),
 			vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.vertexBuffer),
@@ -282,7 +265,7 @@ public:
 		createPostPipeline();
 
 		//imgui
-		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT);
+		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT, &frameRingBuffer);
 		//framebuffer
 		createFramebuffers();
 		//command buffer
@@ -295,7 +278,10 @@ public:
 	virtual void draw() override {
 		uint32_t imageIndex = prepareFrame();
 
-		updateUniformBuffer(currentFrame);
+		updateUniformBuffer();
+
+		//fence of this frame is waited in prepareFrame() - its command buffer is no longer pending
+		buildCommandBuffer(imageIndex);
 
 		//render
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT };
@@ -305,8 +291,7 @@ public:
 		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
 		submitInfo.pWaitDstStageMask = waitStages;
 		submitInfo.commandBufferCount = 1;
-		size_t commandBufferIndex = imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
+		submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
 		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
@@ -316,6 +301,10 @@ public:
 
 	virtual void update() override {
 		VulkanAppBase::update();
+		//model buffers / images moved by memory defragmentation
+		if (sceneResourceVersion != gltfDioramaModel.getResourceVersion()) {
+			updateMovedSceneResources();
+		}
 		Imgui* imgui = static_cast<Imgui*>(imguiBase);
 		if (oldViewMatrix != cameraMatrices.view || imgui->frameReset) {
 			rtPushConstants.frame = -1;
@@ -324,8 +313,6 @@ public:
 				imgui->frameReset = false;
 		}
 		rtPushConstants.frame++;
-
-		buildCommandBuffer();
 	}
 
 	/*
@@ -361,9 +348,11 @@ public:
 	virtual void recordCommandBuffer() override { }
 
 	/*
-	* record command buffer every frame
+	* record command buffer of the current frame every frame
+	*
+	* @param imageIndex - index of the acquired swapchain image
 	*/
-	void buildCommandBuffer() {
+	void buildCommandBuffer(uint32_t imageIndex) {
 		VkCommandBufferBeginInfo cmdBufBeginInfo{};
 		cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		cmdBufBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -396,60 +385,76 @@ public:
 		postRenderPassBeginInfo.renderArea = { {0, 0},swapchain.extent };
 
 		const int imageFilteringIteration = 5;
-		for (size_t i = 0; i < framebuffers.size(); ++i) {
-			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
-
-			//#1 raytracing
-			raytrace(commandBuffers[i], currentFrame);
-
-			//#2 image filtering
-			for (int currenrtFilter = 1; currenrtFilter <= imageFilteringIteration; ++currenrtFilter) {
-				size_t pingpongFramebufferIndex = currentFrame * MAX_FRAMES_IN_FLIGHT + (currenrtFilter + 1) % 2;
-				iamgeFileringRenderPassBeginInfo.framebuffer = pingpongFramebuffer[pingpongFramebufferIndex].framebuffer;
-				vkCmdBeginRenderPass(commandBuffers[i], &iamgeFileringRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-				vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-
-				imageFilteringPushConstant.x = static_cast<float>(currenrtFilter - 1);
-				imageFilteringPushConstant.y = imgui->userInput.scale.x;
-				imageFilteringPushConstant.z = imgui->userInput.scale.y;
-				imageFilteringPushConstant.w = imgui->userInput.scale.z;
-
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, imageFilteringPipeline);
-				vkCmdPushConstants(commandBuffers[i], imageFilteringPipelineLayout,
-					VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::vec4), &imageFilteringPushConstant);
-
-				size_t descriptorIndex = currentFrame * MAX_FRAMES_IN_FLIGHT;
-				if (currenrtFilter != 1) {//2, 3, 4, 5
-					if (currenrtFilter % 2 == 0) {//2, 4
-						descriptorIndex = currentFrame * MAX_FRAMES_IN_FLIGHT + 1;
-					}
-					else {//3, 5
-						descriptorIndex = currentFrame * MAX_FRAMES_IN_FLIGHT + 2;
-					}
-				}
+		VkCommandBuffer cmdBuf = commandBuffers[currentFrame];
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuf, &cmdBufBeginInfo));
+
+		//scene description of the moved buffers - written before any shader of this frame reads it
+		if (sceneBufferOutdated) {
+			vkCmdUpdateBuffer(cmdBuf, sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance), objInstances.data());
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+				VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+				0,
+				1, &barrier,
+				0, nullptr,
+				0, nullptr
+			);
+			sceneBufferOutdated = false;
+		}
 
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, imageFilteringPipelineLayout, 0, 1,
-					&imageFilteringDescriptorSets[descriptorIndex], 0, nullptr);
-				vkCmdDraw(commandBuffers[i], 3, 1, 0, 0); //full screen triangle
-				vkCmdEndRenderPass(commandBuffers[i]);
+		//#1 raytracing
+		raytrace(cmdBuf, currentFrame);
+
+		//#2 image filtering
+		for (int currenrtFilter = 1; currenrtFilter <= imageFilteringIteration; ++currenrtFilter) {
+			size_t pingpongFramebufferIndex = currentFrame * MAX_FRAMES_IN_FLIGHT + (currenrtFilter + 1) % 2;
+			iamgeFileringRenderPassBeginInfo.framebuffer = pingpongFramebuffer[pingpongFramebufferIndex].framebuffer;
+			vkCmdBeginRenderPass(cmdBuf, &iamgeFileringRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+
+			imageFilteringPushConstant.x = static_cast<float>(currenrtFilter - 1);
+			imageFilteringPushConstant.y = imgui->userInput.scale.x;
+			imageFilteringPushConstant.z = imgui->userInput.scale.y;
+			imageFilteringPushConstant.w = imgui->userInput.scale.z;
+
+			vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, imageFilteringPipeline);
+			vkCmdPushConstants(cmdBuf, imageFilteringPipelineLayout,
+				VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glm::vec4), &imageFilteringPushConstant);
+
+			size_t descriptorIndex = currentFrame * MAX_FRAMES_IN_FLIGHT;
+			if (currenrtFilter != 1) {//2, 3, 4, 5
+				if (currenrtFilter % 2 == 0) {//2, 4
+					descriptorIndex = currentFrame * MAX_FRAMES_IN_FLIGHT + 1;
+				}
+				else {//3, 5
+					descriptorIndex = currentFrame * MAX_FRAMES_IN_FLIGHT + 2;
+				}
 			}
 
-			//#3 full screen quad
-			size_t framebufferIndex = i % framebuffers.size();
-			postRenderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
-			vkCmdBeginRenderPass(commandBuffers[i], &postRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, imageFilteringPipelineLayout, 0, 1,
+				&imageFilteringDescriptorSets[descriptorIndex], 0, nullptr);
+			vkCmdDraw(cmdBuf, 3, 1, 0, 0); //full screen triangle
+			vkCmdEndRenderPass(cmdBuf);
+		}
 
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1,
-				&postDescriptorSets[currentFrame], 0, nullptr);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0); //full screen triangle
+		//#3 full screen quad
+		postRenderPassBeginInfo.framebuffer = framebuffers[imageIndex];
+		vkCmdBeginRenderPass(cmdBuf, &postRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			imguiBase->drawFrame(commandBuffers[i], currentFrame);
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1,
+			&postDescriptorSets[currentFrame], 0, nullptr);
+		vkCmdDraw(cmdBuf, 3, 1, 0, 0); //full screen triangle
 
-			vkCmdEndRenderPass(commandBuffers[i]);
-			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
-		}
+		imguiBase->drawFrame(cmdBuf, currentFrame);
+
+		vkCmdEndRenderPass(cmdBuf);
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuf));
 	}
 
 	/*
@@ -482,12 +487,8 @@ private:
 	std::vector<AccelKHR> blasHandles;
 	/** top-level acceleration structure */
 	AccelKHR tlas{};
-	/** instance buffer for tlas */
-	VkBuffer instanceBuffer = VK_NULL_HANDLE;
-	/** uniform buffers for camera matrices */
-	std::vector<VkBuffer> uniformBuffers;
-	/** uniform buffer memories */
-	std::vector<MemoryAllocator::HostVisibleMemory> uniformBufferMemories;
+	/** dynamic offset of the camera matrices of the current frame in frameRingBuffer */
+	uint32_t cameraMatricesOffset = 0;
 	/** gltf model */
 	VulkanGLTF gltfDioramaModel;
 	/** view matrix of previous frame */
@@ -514,6 +515,10 @@ private:
 	std::vector<ObjInstance> objInstances;
 	/** obj instances buffer */
 	VkBuffer sceneBuffer = VK_NULL_HANDLE;
+	/** VulkanGLTF::getResourceVersion() of the addresses in objInstances & the scene descriptors */
+	uint64_t sceneResourceVersion = 0;
+	/** objInstances rewritten after a defragmentation move - copied to sceneBuffer by the next command buffer */
+	bool sceneBufferOutdated = false;
 
 
 	/*
@@ -651,7 +656,7 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, buffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeBufferMemory(stagingBuffer);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -698,7 +703,7 @@ private:
 			instance.mask = 0xFF;
 			instances.push_back(instance);
 		}
-		buildTlas(&devices, instances, tlas, instanceBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+		buildTlas(&devices, instances, tlas, &frameRingBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
 	}
 
 	/*
@@ -863,8 +868,8 @@ private:
 	* create (normal) descriptor set - set camera matrix uniform buffer & scene description buffer
 	*/
 	void createDescriptorSet() {
-		//camera matrix
-		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+		//camera matrix - dynamic offset in frameRingBuffer
+		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR);
 		//scene description
 		descriptorSetBindings.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
@@ -883,7 +888,7 @@ private:
 		}
 
 		for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++i) {
-			VkDescriptorBufferInfo camMatricesInfo{ uniformBuffers[i], 0, sizeof(CameraMatrices) };
+			VkDescriptorBufferInfo camMatricesInfo{ frameRingBuffer.getBuffer(), 0, sizeof(CameraMatrices) };
 			VkDescriptorBufferInfo sceneBufferInfo{ sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance) };
 
 			std::vector<VkWriteDescriptorSet> writes;
@@ -894,6 +899,37 @@ private:
 		}
 	}
 
+	/*
+	* rewrite device addresses & descriptors of the model buffers / images moved by memory defragmentation
+	* every frame in flight was waited by defragmentMemory(), so all descriptor sets are rewritten at once
+	*/
+	void updateMovedSceneResources() {
+		ObjInstance& instance = objInstances[0];
+		instance.vertexAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.vertexBuffer);
+		instance.IndexAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.indexBuffer);
+		instance.normalAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.normalBuffer);
+		instance.uvAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.uvBuffer);
+		instance.colorAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.colorBuffer);
+		instance.tangentAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.tangentBuffer);
+		instance.materialIndicesAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.materialIndicesBuffer);
+		instance.materialAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.materialBuffer);
+		instance.primitiveAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.primitiveBuffer);
+		sceneBufferOutdated = true;
+
+		std::vector<VkDescriptorImageInfo> imageInfos{};
+		for (auto& image : gltfDioramaModel.images) {
+			imageInfos.emplace_back(image.descriptor);
+		}
+		VkDescriptorBufferInfo primitiveInfo{ gltfDioramaModel.primitiveBuffer, 0, VK_WHOLE_SIZE };
+		for (size_t i = 0; i < static_cast<size_t>(MAX_FRAMES_IN_FLIGHT); ++i) {
+			std::vector<VkWriteDescriptorSet> writes;
+			writes.emplace_back(descriptorSetBindings.makeWriteArray(descriptorSets[i], 2, imageInfos.data()));
+			writes.emplace_back(rtDescriptorSetBindings.makeWrite(rtDescriptorSets[i], 5, &primitiveInfo));
+			vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+		sceneResourceVersion = gltfDioramaModel.getResourceVersion();
+	}
+
 	/*
 	* create raytrace descriptor set - acceleration structure & raytracing pipeline destination image
 	*/
@@ -1102,7 +1138,7 @@ private:
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 		//map data
-		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle(devices.device));
+		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle());
 		for (uint32_t g = 0; g < groupCount; ++g) {
 			memcpy(pData, shaderHandleStorage.data() + g * groupHandleSize, groupHandleSize);
 			pData += groupSizeAligned;
@@ -1156,31 +1192,12 @@ private:
 		vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
 	}
 
-	/*
-	* create uniform buffers - camera matrices
-	*/
-	void createUniformbuffer() {
-		VkDeviceSize size = sizeof(CameraMatrices);
-		uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-		uniformBufferMemories.resize(MAX_FRAMES_IN_FLIGHT);
-
-		VkBufferCreateInfo info = vktools::initializers::bufferCreateInfo(size,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-			VK_CHECK_RESULT(vkCreateBuffer(devices.device, &info, nullptr, &uniformBuffers[i]));
-			uniformBufferMemories[i] = devices.memoryAllocator.allocateBufferMemory(uniformBuffers[i],
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		}
-	}
-
 	/*
 	* update uniform buffer - camera matrices
-	*
-	* @param currentFrame - index of uniform buffer (0 <= currentFrame < MAX_FRAMES_IN_FLIGHT)
+	* copied to the frame ring buffer of the current frame, bound with cameraMatricesOffset
 	*/
-	void updateUniformBuffer(size_t currentFrame) {
-		uniformBufferMemories[currentFrame].mapData(devices.device, &cameraMatrices);
+	void updateUniformBuffer() {
+		cameraMatricesOffset = static_cast<uint32_t>(frameRingBuffer.upload(&cameraMatrices, sizeof(CameraMatrices)).offset);
 	}
 
 	/*
@@ -1194,7 +1211,7 @@ private:
 
 		std::vector<VkDescriptorSet> descSets{ rtDescriptorSets[descriptorSetIndex], descriptorSets[descriptorSetIndex] };
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipelineLayout,
-			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 1, &cameraMatricesOffset);
 		vkCmdPushConstants(cmdBuf, rtPipelineLayout,
 			VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR,
 			0, sizeof(RtPushConstant), &rtPushConstants);
@@ -83,6 +83,7 @@ public:
 		}
 
 		ImGui::End();
+		drawMemoryStatistics();
 		ImGui::Render();
 	}
 
@@ -135,8 +136,7 @@ public:
 		imguiBase->cleanup();
 		delete imguiBase;
 
-		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		devices.memoryAllocator.freeBufferMemory(rtSBTBuffer);
 		vkDestroyBuffer(devices.device, rtSBTBuffer, nullptr);
 		vkDestroyPipeline(devices.device, gbufferPipeline, nullptr);
 		vkDestroyPipelineLayout(devices.device, gbufferPipelineLayout, nullptr);
@@ -152,7 +152,7 @@ public:
 		vkDestroyPipeline(devices.device, atrousComputePipeline, nullptr);
 		vkDestroyPipelineLayout(devices.device, atrousComputePipelineLayout, nullptr);
 
-		devices.memoryAllocator.freeBufferMemory(sceneBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeBufferMemory(sceneBuffer);
 		vkDestroyBuffer(devices.device, sceneBuffer, nullptr);
 
 		//BLAS
@@ -162,56 +162,52 @@ public:
 			vkDestroyBuffer(devices.device, as.buffer, nullptr);
 		}
 
-		//instance buffer
-		devices.memoryAllocator.freeBufferMemory(instanceBuffer);
-		vkDestroyBuffer(devices.device, instanceBuffer, nullptr);
-
 		//TLAS
 		vkfp::vkDestroyAccelerationStructureKHR(devices.device, tlas.accel, nullptr);
 		devices.memoryAllocator.freeBufferMemory(tlas.buffer);
 		vkDestroyBuffer(devices.device, tlas.buffer, nullptr);
 
 		//raytrace destination image
-		devices.memoryAllocator.freeImageMemory(rtDirectDestinationImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(rtDirectDestinationImage);
 		vkDestroyImage(devices.device, rtDirectDestinationImage, nullptr);
 		vkDestroyImageView(devices.device, rtDirectDestinationImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(rtIndirectDestinationImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(rtIndirectDestinationImage);
 		vkDestroyImage(devices.device, rtIndirectDestinationImage, nullptr);
 		vkDestroyImageView(devices.device, rtIndirectDestinationImageView, nullptr);
 
 		//history images & integrated images
-		devices.memoryAllocator.freeImageMemory(historyLengthImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(historyLengthImage);
 		vkDestroyImage(devices.device, historyLengthImage, nullptr);
 		vkDestroyImageView(devices.device, historyLengthImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(updatedHistoryLengthImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(updatedHistoryLengthImage);
 		vkDestroyImage(devices.device, updatedHistoryLengthImage, nullptr);
 		vkDestroyImageView(devices.device, updatedHistoryLengthImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(momentHistoryImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(momentHistoryImage);
 		vkDestroyImage(devices.device, momentHistoryImage, nullptr);
 		vkDestroyImageView(devices.device, momentHistoryImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(directColorHistoryImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(directColorHistoryImage);
 		vkDestroyImage(devices.device, directColorHistoryImage, nullptr);
 		vkDestroyImageView(devices.device, directColorHistoryImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(indirectColorHistoryImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(indirectColorHistoryImage);
 		vkDestroyImage(devices.device, indirectColorHistoryImage, nullptr);
 		vkDestroyImageView(devices.device, indirectColorHistoryImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(directIntegratedColorImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(directIntegratedColorImage);
 		vkDestroyImage(devices.device, directIntegratedColorImage, nullptr);
 		vkDestroyImageView(devices.device, directIntegratedColorImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(indirectIntegratedColorImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(indirectIntegratedColorImage);
 		vkDestroyImage(devices.device, indirectIntegratedColorImage, nullptr);
 		vkDestroyImageView(devices.device, indirectIntegratedColorImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(integratedMomentsImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(integratedMomentsImage);
 		vkDestroyImage(devices.device, integratedMomentsImage, nullptr);
 		vkDestroyImageView(devices.device, integratedMomentsImageView, nullptr);
 		for (int i = 0; i < 2; ++i) {
-			devices.memoryAllocator.freeImageMemory(varianceImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			devices.memoryAllocator.freeImageMemory(varianceImages[i]);
 			vkDestroyImage(devices.device, varianceImages[i], nullptr);
 			vkDestroyImageView(devices.device, varianceImageViews[i], nullptr);
-			devices.memoryAllocator.freeImageMemory(directFilteredImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			devices.memoryAllocator.freeImageMemory(directFilteredImages[i]);
 			vkDestroyImage(devices.device, directFilteredImages[i], nullptr);
 			vkDestroyImageView(devices.device, directFilteredImageViews[i], nullptr);
-			devices.memoryAllocator.freeImageMemory(indirectFilteredImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			devices.memoryAllocator.freeImageMemory(indirectFilteredImages[i]);
 			vkDestroyImage(devices.device, indirectFilteredImages[i], nullptr);
 			vkDestroyImageView(devices.device, indirectFilteredImageViews[i], nullptr);
 		}
@@ -246,11 +242,6 @@ public:
 		vkDestroyDescriptorPool(devices.device, atrousDescPool, nullptr);
 		vkDestroyDescriptorSetLayout(devices.device, atrousDescLayout, nullptr);
 
-		//uniform buffers
-		devices.memoryAllocator.freeBufferMemory(matricesUniformBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		vkDestroyBuffer(devices.device, matricesUniformBuffer, nullptr);
-
 		//models
 		gltfDioramaModel.cleanup();
 	}
@@ -278,10 +269,6 @@ public:
 		//create & build top-level acceleration structure
 		createTopLevelAccelerationStructure();
 
-		//uniform buffers
-		createUniformbuffer();
-		updateUniformBuffer();
-
 		//push bunny obj instance
 		objInstances.push_back({ glm::mat4(1.f), glm::mat4(1.f),
 			vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.vertexBuffer),
@@ -364,7 +351,7 @@ public:
 		createPostPipeline();
 
 		//imgui
-		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT);
+		imguiBase->init(&devices, swapchain.extent.width, swapchain.extent.height, postRenderPass, MAX_FRAMES_IN_FLIGHT, VK_SAMPLE_COUNT_1_BIT, &frameRingBuffer);
 		//framebuffer
 		createFramebuffers();
 		//command buffer
@@ -379,6 +366,9 @@ public:
 
 		updateUniformBuffer();
 
+		//fence of this frame is waited in prepareFrame() - its command buffer is no longer pending
+		buildCommandBuffer(imageIndex);
+
 		//render
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT };
 		VkSubmitInfo submitInfo{};
@@ -387,8 +377,7 @@ public:
 		submitInfo.pWaitSemaphores = &presentCompleteSemaphores[currentFrame];
 		submitInfo.pWaitDstStageMask = waitStages;
 		submitInfo.commandBufferCount = 1;
-		size_t commandBufferIndex = imageIndex;
-		submitInfo.pCommandBuffers = &commandBuffers[commandBufferIndex];
+		submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = &renderCompleteSemaphores[currentFrame];
 		VK_CHECK_RESULT(vkQueueSubmit(devices.graphicsQueue, 1, &submitInfo, frameLimitFences[currentFrame]));
@@ -401,6 +390,10 @@ public:
 
 	virtual void update() override {
 		VulkanAppBase::update();
+		//model buffers / images moved by memory defragmentation
+		if (sceneResourceVersion != gltfDioramaModel.getResourceVersion()) {
+			updateMovedSceneResources();
+		}
 		updateRtDescriptorSet();
 		updateComputeDescSet();
 		updatePostDescriptorSet();
@@ -413,8 +406,6 @@ public:
 				imgui->frameReset = false;
 		}
 		rtPushConstants.frame++;*/
-
-		buildCommandBuffer();
 	}
 
 	/*
@@ -445,9 +436,11 @@ public:
 	virtual void recordCommandBuffer() override { }
 
 	/*
-	* record command buffer every frame
+	* record command buffer of the current frame every frame
+	*
+	* @param imageIndex - index of the acquired swapchain image
 	*/
-	void buildCommandBuffer() {
+	void buildCommandBuffer(uint32_t imageIndex) {
 		VkCommandBufferBeginInfo cmdBufBeginInfo{};
 		cmdBufBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		cmdBufBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -490,216 +483,232 @@ public:
 		atrousPushConstant.oldViewMat = oldViewMatrix;
 		atrousPushConstant.proj = cameraMatrices.proj;
 
-		for (size_t i = 0; i < framebuffers.size(); ++i) {
-			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &cmdBufBeginInfo));
+		VkCommandBuffer cmdBuf = commandBuffers[currentFrame];
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuf, &cmdBufBeginInfo));
+
+		//scene description of the moved buffers - written before any shader of this frame reads it
+		if (sceneBufferOutdated) {
+			vkCmdUpdateBuffer(cmdBuf, sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance), objInstances.data());
+			VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+				VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+				0,
+				1, &barrier,
+				0, nullptr,
+				0, nullptr
+			);
+			sceneBufferOutdated = false;
+		}
+
+		/*
+		* #1 gbuffer pass
+		*/
+		vkdebug::marker::beginLabel(cmdBuf, "gbuffer pass");
+		gbufferRenderPassBeginInfo.framebuffer = gbuffers[currentGBufferIndex].framebuffer;
+		vkCmdBeginRenderPass(cmdBuf, &gbufferRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		rasterize(cmdBuf);
+		vkCmdEndRenderPass(cmdBuf);
+		vkdebug::marker::endLabel(cmdBuf);
+
+		/*
+		* #2 raytracing
+		*/
+		vkdebug::marker::beginLabel(cmdBuf, "raytrace");
+		raytrace(cmdBuf);
+		vkdebug::marker::endLabel(cmdBuf);
 
+		if (imgui->userInput.denoise) {
 			/*
-			* #1 gbuffer pass
+			* #3 reprojection
 			*/
-			vkdebug::marker::beginLabel(commandBuffers[i], "gbuffer pass");
-			gbufferRenderPassBeginInfo.framebuffer = gbuffers[currentGBufferIndex].framebuffer;
-			vkCmdBeginRenderPass(commandBuffers[i], &gbufferRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-			rasterize(commandBuffers[i]);
-			vkCmdEndRenderPass(commandBuffers[i]);
-			vkdebug::marker::endLabel(commandBuffers[i]);
+			vkdebug::marker::beginLabel(cmdBuf, "reproject");
+			vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, reprojectionComputePipeline);
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, reprojectionComputePipelineLayout, 0, 1, &reprojectionDescSet, 0, nullptr);
+			vkCmdPushConstants(cmdBuf, reprojectionComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(glm::mat4) * 2, &cam);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / 32, swapchain.extent.height / 32, 1);
+
+			std::array<VkImageMemoryBarrier, 5> barriers5{};
+			barriers5[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barriers5[0].pNext = nullptr;
+			barriers5[0].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barriers5[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barriers5[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			barriers5[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barriers5[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barriers5[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barriers5[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barriers5[0].image = directIntegratedColorImage;
+			barriers5[1] = barriers5[0];
+			barriers5[1].image = indirectIntegratedColorImage;
+			barriers5[2] = barriers5[0];
+			barriers5[2].image = integratedMomentsImage;
+			barriers5[3] = barriers5[0];
+			barriers5[3].image = updatedHistoryLengthImage;
+			barriers5[4] = barriers5[0];
+			barriers5[4].image = varianceImages[0];
+
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				static_cast<uint32_t>(barriers5.size()), barriers5.data()
+			);
+			vkdebug::marker::endLabel(cmdBuf);
 
 			/*
-			* #2 raytracing
+			* #4 update history
 			*/
-			vkdebug::marker::beginLabel(commandBuffers[i], "raytrace");
-			raytrace(commandBuffers[i]);
-			vkdebug::marker::endLabel(commandBuffers[i]);
-
-			if (imgui->userInput.denoise) {
-				/*
-				* #3 reprojection
-				*/
-				vkdebug::marker::beginLabel(commandBuffers[i], "reproject");
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, reprojectionComputePipeline);
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, reprojectionComputePipelineLayout, 0, 1, &reprojectionDescSet, 0, nullptr);
-				vkCmdPushConstants(commandBuffers[i], reprojectionComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(glm::mat4) * 2, &cam);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / 32, swapchain.extent.height / 32, 1);
-
-				std::array<VkImageMemoryBarrier, 5> barriers5{};
-				barriers5[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-				barriers5[0].pNext = nullptr;
-				barriers5[0].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-				barriers5[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
-				barriers5[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-				barriers5[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-				barriers5[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-				barriers5[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-				barriers5[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-				barriers5[0].image = directIntegratedColorImage;
-				barriers5[1] = barriers5[0];
-				barriers5[1].image = indirectIntegratedColorImage;
-				barriers5[2] = barriers5[0];
-				barriers5[2].image = integratedMomentsImage;
-				barriers5[3] = barriers5[0];
-				barriers5[3].image = updatedHistoryLengthImage;
-				barriers5[4] = barriers5[0];
-				barriers5[4].image = varianceImages[0];
-
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					static_cast<uint32_t>(barriers5.size()), barriers5.data()
-				);
-				vkdebug::marker::endLabel(commandBuffers[i]);
-
-				/*
-				* #4 update history
-				*/
-				vkdebug::marker::beginLabel(commandBuffers[i], "update history");
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, updateHistoryComputePipeline);
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, updateHistoryComputePipelineLayout, 0, 1, &updateHistoryDescSet, 0, nullptr);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / 32, swapchain.extent.height / 32, 1);
-
-				std::vector<VkImageMemoryBarrier> barriers = { barriers5[0], barriers5[3] };
-				barriers5[0].image = integratedMomentsImage;
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					2, barriers.data()
-				);
-				vkdebug::marker::endLabel(commandBuffers[i]);
-
-				/*
-				* #5 atrous filtering
-				*/
-				vkdebug::marker::beginLabel(commandBuffers[i], "atrous filtering #1");
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipeline);
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[0], 0, nullptr);
-				atrousPushConstant.iteration = 0;
-				vkCmdPushConstants(commandBuffers[i], atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
-
-				barriers = { barriers5[0], barriers5[0], barriers5[0] };
-				barriers[0].image = directFilteredImages[0];
-				barriers[1].image = indirectFilteredImages[0];
-				barriers[2].image = varianceImages[1];
-
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					3, barriers.data()
-				);
+			vkdebug::marker::beginLabel(cmdBuf, "update history");
+			vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, updateHistoryComputePipeline);
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, updateHistoryComputePipelineLayout, 0, 1, &updateHistoryDescSet, 0, nullptr);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / 32, swapchain.extent.height / 32, 1);
+
+			std::vector<VkImageMemoryBarrier> barriers = { barriers5[0], barriers5[3] };
+			barriers5[0].image = integratedMomentsImage;
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				2, barriers.data()
+			);
+			vkdebug::marker::endLabel(cmdBuf);
 
-				vkdebug::marker::endLabel(commandBuffers[i]);
-
-				vkdebug::marker::beginLabel(commandBuffers[i], "atrous filtering #2");
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[1], 0, nullptr);
-				atrousPushConstant.iteration = 1;
-				vkCmdPushConstants(commandBuffers[i], atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
-
-				barriers[0].image = directFilteredImages[1];
-				barriers[1].image = indirectFilteredImages[1];
-				barriers[2].image = varianceImages[0];
-
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					3, barriers.data()
-				);
+			/*
+			* #5 atrous filtering
+			*/
+			vkdebug::marker::beginLabel(cmdBuf, "atrous filtering #1");
+			vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipeline);
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[0], 0, nullptr);
+			atrousPushConstant.iteration = 0;
+			vkCmdPushConstants(cmdBuf, atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
+
+			barriers = { barriers5[0], barriers5[0], barriers5[0] };
+			barriers[0].image = directFilteredImages[0];
+			barriers[1].image = indirectFilteredImages[0];
+			barriers[2].image = varianceImages[1];
+
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				3, barriers.data()
+			);
 
-				vkdebug::marker::endLabel(commandBuffers[i]);
-
-				vkdebug::marker::beginLabel(commandBuffers[i], "atrous filtering #3");
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[2], 0, nullptr);
-				atrousPushConstant.iteration = 2;
-				vkCmdPushConstants(commandBuffers[i], atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
-
-				barriers[0].image = directFilteredImages[0];
-				barriers[1].image = indirectFilteredImages[0];
-				barriers[2].image = varianceImages[1];
-
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					3, barriers.data()
-				);
+			vkdebug::marker::endLabel(cmdBuf);
+
+			vkdebug::marker::beginLabel(cmdBuf, "atrous filtering #2");
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[1], 0, nullptr);
+			atrousPushConstant.iteration = 1;
+			vkCmdPushConstants(cmdBuf, atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
+
+			barriers[0].image = directFilteredImages[1];
+			barriers[1].image = indirectFilteredImages[1];
+			barriers[2].image = varianceImages[0];
+
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				3, barriers.data()
+			);
 
-				vkdebug::marker::endLabel(commandBuffers[i]);
-
-				vkdebug::marker::beginLabel(commandBuffers[i], "atrous filtering #4");
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[1], 0, nullptr);
-				atrousPushConstant.iteration = 3;
-				vkCmdPushConstants(commandBuffers[i], atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
-
-				barriers[0].image = directFilteredImages[1];
-				barriers[1].image = indirectFilteredImages[1];
-				barriers[2].image = varianceImages[0];
-
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					3, barriers.data()
-				);
+			vkdebug::marker::endLabel(cmdBuf);
+
+			vkdebug::marker::beginLabel(cmdBuf, "atrous filtering #3");
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[2], 0, nullptr);
+			atrousPushConstant.iteration = 2;
+			vkCmdPushConstants(cmdBuf, atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
+
+			barriers[0].image = directFilteredImages[0];
+			barriers[1].image = indirectFilteredImages[0];
+			barriers[2].image = varianceImages[1];
+
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				3, barriers.data()
+			);
 
-				vkdebug::marker::endLabel(commandBuffers[i]);
+			vkdebug::marker::endLabel(cmdBuf);
+
+			vkdebug::marker::beginLabel(cmdBuf, "atrous filtering #4");
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[1], 0, nullptr);
+			atrousPushConstant.iteration = 3;
+			vkCmdPushConstants(cmdBuf, atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
+
+			barriers[0].image = directFilteredImages[1];
+			barriers[1].image = indirectFilteredImages[1];
+			barriers[2].image = varianceImages[0];
+
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				3, barriers.data()
+			);
 
-				vkdebug::marker::beginLabel(commandBuffers[i], "atrous filtering #5");
-				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[2], 0, nullptr);
-				atrousPushConstant.iteration = 4;
-				vkCmdPushConstants(commandBuffers[i], atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
-				vkCmdDispatch(commandBuffers[i], swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
+			vkdebug::marker::endLabel(cmdBuf);
 
-				barriers[0].image = directFilteredImages[0];
+			vkdebug::marker::beginLabel(cmdBuf, "atrous filtering #5");
+			vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, atrousComputePipelineLayout, 0, 1, &atrousDescSet[2], 0, nullptr);
+			atrousPushConstant.iteration = 4;
+			vkCmdPushConstants(cmdBuf, atrousComputePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AtrousPushConstant), &atrousPushConstant);
+			vkCmdDispatch(cmdBuf, swapchain.extent.width / SHADER_INVOCATION_LOCAL_SIZE, swapchain.extent.height / SHADER_INVOCATION_LOCAL_SIZE, 1);
 
-				vkCmdPipelineBarrier(commandBuffers[i],
-					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					1, barriers.data()
-				);
+			barriers[0].image = directFilteredImages[0];
 
-				vkdebug::marker::endLabel(commandBuffers[i]);
-			}
+			vkCmdPipelineBarrier(cmdBuf,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				0,
+				0, nullptr,
+				0, nullptr,
+				1, barriers.data()
+			);
 
-			/*
-			* #6 full screen quad
-			*/
-			vkdebug::marker::beginLabel(commandBuffers[i], "full screen quad");
-			size_t framebufferIndex = i % framebuffers.size();
-			postRenderPassBeginInfo.framebuffer = framebuffers[framebufferIndex];
-			vkCmdBeginRenderPass(commandBuffers[i], &postRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			vktools::setViewportScissorDynamicStates(commandBuffers[i], swapchain.extent);
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1,
-				&postDescriptorSet, 0, nullptr);
-			vkCmdPushConstants(commandBuffers[i], postPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &imgui->userInput.denoise);
-			vkCmdDraw(commandBuffers[i], 3, 1, 0, 0); //full screen triangle
-
-			imguiBase->drawFrame(commandBuffers[i], currentFrame);
-
-			vkCmdEndRenderPass(commandBuffers[i]);
-			vkdebug::marker::endLabel(commandBuffers[i]);
-			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]));
+			vkdebug::marker::endLabel(cmdBuf);
 		}
+
+		/*
+		* #6 full screen quad
+		*/
+		vkdebug::marker::beginLabel(cmdBuf, "full screen quad");
+		postRenderPassBeginInfo.framebuffer = framebuffers[imageIndex];
+		vkCmdBeginRenderPass(cmdBuf, &postRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
+		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipeline);
+		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, postPipelineLayout, 0, 1,
+			&postDescriptorSet, 0, nullptr);
+		vkCmdPushConstants(cmdBuf, postPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &imgui->userInput.denoise);
+		vkCmdDraw(cmdBuf, 3, 1, 0, 0); //full screen triangle
+
+		imguiBase->drawFrame(cmdBuf, currentFrame);
+
+		vkCmdEndRenderPass(cmdBuf);
+		vkdebug::marker::endLabel(cmdBuf);
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuf));
 	}
 
 	/*
@@ -748,12 +757,8 @@ private:
 	std::vector<AccelKHR> blasHandles;
 	/** top-level acceleration structure */
 	AccelKHR tlas{};
-	/** instance buffer for tlas */
-	VkBuffer instanceBuffer = VK_NULL_HANDLE;
-	/** uniform buffers for camera matrices */
-	VkBuffer matricesUniformBuffer;
-	/** uniform buffer memories */
-	MemoryAllocator::HostVisibleMemory matricesUniformBufferMemory;
+	/** dynamic offset of the camera matrices of the current frame in frameRingBuffer */
+	uint32_t cameraMatricesOffset = 0;
 	/** gltf model */
 	VulkanGLTF gltfDioramaModel;
 	/** view matrix of previous frame */
@@ -780,6 +785,10 @@ private:
 	std::vector<ObjInstance> objInstances;
 	/** obj instances buffer */
 	VkBuffer sceneBuffer = VK_NULL_HANDLE;
+	/** VulkanGLTF::getResourceVersion() of the addresses in objInstances & the scene descriptors */
+	uint64_t sceneResourceVersion = 0;
+	/** objInstances rewritten after a defragmentation move - copied to sceneBuffer by the next command buffer */
+	bool sceneBufferOutdated = false;
 
 
 	/*
@@ -1006,7 +1015,7 @@ private:
 		//host visible -> device local
 		devices.copyBuffer(devices.commandPool, stagingBuffer, buffer, bufferSize);
 
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeBufferMemory(stagingBuffer);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -1053,7 +1062,7 @@ private:
 			instance.mask = 0xFF;
 			instances.push_back(instance);
 		}
-		buildTlas(&devices, instances, tlas, instanceBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
+		buildTlas(&devices, instances, tlas, &frameRingBuffer, VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR);
 	}
 
 	/*
@@ -1127,7 +1136,7 @@ private:
 	*/
 	void createStorageImage(VkImage& historyImage, VkImageView& historyImageView, VkFormat format, VkFlags usage = 0) {
 		/** destroy */
-		devices.memoryAllocator.freeImageMemory(historyImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(historyImage);
 		vkDestroyImage(devices.device, historyImage, nullptr);
 		vkDestroyImageView(devices.device, historyImageView, nullptr);
 
@@ -1138,7 +1147,9 @@ private:
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | usage,
 			1,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_SAMPLE_COUNT_1_BIT,
+			MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT
 		);
 
 		/** image view */
@@ -1219,7 +1230,7 @@ private:
 		/*
 		* cleanup
 		*/
-		devices.memoryAllocator.freeBufferMemory(stagingBuffer, properties);
+		devices.memoryAllocator.freeBufferMemory(stagingBuffer);
 		vkDestroyBuffer(devices.device, stagingBuffer, nullptr);
 	}
 
@@ -1526,8 +1537,8 @@ private:
 	* create (normal) descriptor set - set camera matrix uniform buffer & scene description buffer
 	*/
 	void createDescriptorSet() {
-		//camera matrix
-		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+		//camera matrix - dynamic offset in frameRingBuffer
+		descriptorSetBindings.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_RAYGEN_BIT_KHR);
 		//scene description
 		descriptorSetBindings.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
@@ -1545,7 +1556,7 @@ private:
 			imageInfos.emplace_back(image.descriptor);
 		}
 
-		VkDescriptorBufferInfo camMatricesInfo{ matricesUniformBuffer, 0, sizeof(CameraMatrices) };
+		VkDescriptorBufferInfo camMatricesInfo{ frameRingBuffer.getBuffer(), 0, sizeof(CameraMatrices) };
 		VkDescriptorBufferInfo sceneBufferInfo{ sceneBuffer, 0, objInstances.size() * sizeof(ObjInstance) };
 
 		std::vector<VkWriteDescriptorSet> writes;
@@ -1560,10 +1571,10 @@ private:
 	*/
 	void createRaytraceDestinationImage() {
 		//delete resources
-		devices.memoryAllocator.freeImageMemory(rtDirectDestinationImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(rtDirectDestinationImage);
 		vkDestroyImage(devices.device, rtDirectDestinationImage, nullptr);
 		vkDestroyImageView(devices.device, rtDirectDestinationImageView, nullptr);
-		devices.memoryAllocator.freeImageMemory(rtIndirectDestinationImage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		devices.memoryAllocator.freeImageMemory(rtIndirectDestinationImage);
 		vkDestroyImage(devices.device, rtIndirectDestinationImage, nullptr);
 		vkDestroyImageView(devices.device, rtIndirectDestinationImageView, nullptr);
 
@@ -1574,7 +1585,9 @@ private:
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			1,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_SAMPLE_COUNT_1_BIT,
+			MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT
 		);
 		devices.createImage(rtIndirectDestinationImage,
 			{ swapchain.extent.width, swapchain.extent.height, 1 },
@@ -1582,7 +1595,9 @@ private:
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			1,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_SAMPLE_COUNT_1_BIT,
+			MemoryAllocator::MemoryLifetime::RESOLUTION_DEPENDENT
 		);
 
 		//create image view
@@ -1618,6 +1633,35 @@ private:
 		devices.endCommandBuffer(cmdBuf);
 	}
 
+	/*
+	* rewrite device addresses & descriptors of the model buffers / images moved by memory defragmentation
+	* every frame in flight was waited by defragmentMemory(), so all descriptor sets are rewritten at once
+	*/
+	void updateMovedSceneResources() {
+		ObjInstance& instance = objInstances[0];
+		instance.vertexAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.vertexBuffer);
+		instance.IndexAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.indexBuffer);
+		instance.normalAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.normalBuffer);
+		instance.uvAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.uvBuffer);
+		instance.colorAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.colorBuffer);
+		instance.tangentAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.tangentBuffer);
+		instance.materialIndicesAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.materialIndicesBuffer);
+		instance.materialAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.materialBuffer);
+		instance.primitiveAddress = vktools::getBufferDeviceAddress(devices.device, gltfDioramaModel.primitiveBuffer);
+		sceneBufferOutdated = true;
+
+		std::vector<VkDescriptorImageInfo> imageInfos{};
+		for (auto& image : gltfDioramaModel.images) {
+			imageInfos.emplace_back(image.descriptor);
+		}
+		VkDescriptorBufferInfo primitiveInfo{ gltfDioramaModel.primitiveBuffer, 0, VK_WHOLE_SIZE };
+		std::vector<VkWriteDescriptorSet> writes;
+		writes.emplace_back(descriptorSetBindings.makeWriteArray(descriptorSet, 2, imageInfos.data()));
+		writes.emplace_back(rtDescriptorSetBindings.makeWrite(rtDescriptorSet, 3, &primitiveInfo));
+		vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		sceneResourceVersion = gltfDioramaModel.getResourceVersion();
+	}
+
 	/*
 	* create raytrace descriptor set - acceleration structure & raytracing pipeline destination image
 	*/
@@ -1819,7 +1863,7 @@ private:
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
 		//map data
-		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle(devices.device));
+		uint8_t* pData = reinterpret_cast<uint8_t*>(memory.getHandle());
 		for (uint32_t g = 0; g < groupCount; ++g) {
 			memcpy(pData, shaderHandleStorage.data() + g * groupHandleSize, groupHandleSize);
 			pData += groupSizeAligned;
@@ -1898,25 +1942,12 @@ private:
 		vkUpdateDescriptorSets(devices.device, static_cast<uint32_t>(wd.size()), wd.data(), 0, nullptr);
 	}
 
-	/*
-	* create uniform buffers - camera matrices
-	*/
-	void createUniformbuffer() {
-		VkBufferCreateInfo info = vktools::initializers::bufferCreateInfo(sizeof(CameraMatrices),
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
-
-		VK_CHECK_RESULT(vkCreateBuffer(devices.device, &info, nullptr, &matricesUniformBuffer));
-		matricesUniformBufferMemory = devices.memoryAllocator.allocateBufferMemory(matricesUniformBuffer,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	}
-
 	/*
 	* update uniform buffer - camera matrices
-	*
-	* @param currentFrame - index of uniform buffer (0 <= currentFrame < MAX_FRAMES_IN_FLIGHT)
+	* copied to the frame ring buffer of the current frame, bound with cameraMatricesOffset
 	*/
 	void updateUniformBuffer() {
-		matricesUniformBufferMemory.mapData(devices.device, &cameraMatrices);
+		cameraMatricesOffset = static_cast<uint32_t>(frameRingBuffer.upload(&cameraMatrices, sizeof(CameraMatrices)).offset);
 	}
 
 	/*
@@ -1934,7 +1965,7 @@ private:
 
 		std::vector<VkDescriptorSet> descSets{ rtDescriptorSet, descriptorSet };
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, rtPipelineLayout,
-			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 0, nullptr);
+			0, static_cast<uint32_t>(descSets.size()), descSets.data(), 1, &cameraMatricesOffset);
 		vkCmdPushConstants(cmdBuf, rtPipelineLayout,
 			VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR,
 			0, sizeof(RtPushConstant), &rtPushConstants);
@@ -1967,7 +1998,7 @@ private:
 		vktools::setViewportScissorDynamicStates(cmdBuf, swapchain.extent);
 		vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, gbufferPipeline);
 		vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, gbufferPipelineLayout,
-			0, 1, &descriptorSet, 0, nullptr);
+			0, 1, &descriptorSet, 1, &cameraMatricesOffset);
 
 		//bind vertex / index buffers
 		VkDeviceSize offsets[3] = { 0, 0, 0 };
@@ -0,0 +1,285 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include "core/vulkan_memory_allocator.h"
+
+/*
+* offline allocator benchmark
+* replays an allocation trace recorded with --memory-trace <path> against FakeMemoryBackend
+* for each placement policy (chunk size x chunk search strategy) and reports
+* throughput, peak chunk count, peak device memory & fragmentation of the remaining free memory
+*
+* usage : allocator_replay <trace file>
+*/
+
+/** single allocation / free / rename / release record of the trace */
+struct TraceRecord {
+	enum class Type { ALLOCATE, FREE, RENAME, RELEASE_EMPTY_CHUNKS } type = Type::ALLOCATE;
+	bool image = false;
+	uint64_t handle = 0;
+	/** new handle of a moved resource - RENAME only */
+	uint64_t newHandle = 0;
+	VkMemoryRequirements memRequirements{};
+	VkMemoryPropertyFlags properties = 0;
+	/** ALLOCATE & RELEASE_EMPTY_CHUNKS */
+	MemoryAllocator::MemoryLifetime lifetime = MemoryAllocator::MemoryLifetime::STATIC;
+	bool linear = true;
+	bool prefersDedicated = false;
+	bool requiresDedicated = false;
+};
+
+/** memory properties & records of a trace file */
+struct Trace {
+	VkPhysicalDeviceMemoryProperties memProperties{};
+	VkDeviceSize bufferImageGranularity = 1;
+	VkDeviceSize nonCoherentAtomSize = 1;
+	std::vector<TraceRecord> records;
+};
+
+/** placement policy to replay */
+struct Policy {
+	uint32_t chunkSize = 0;
+	MemoryAllocator::ChunkSearchStrategy strategy = MemoryAllocator::ChunkSearchStrategy::FIRST_FIT;
+};
+
+/** result of a single replay */
+struct ReplayResult {
+	double opsPerSecond = 0;
+	size_t peakChunkCount = 0;
+	VkDeviceSize peakAllocatedBytes = 0;
+	VkDeviceSize peakLiveBytes = 0;
+	/** 1 - largest free range / free bytes, summed over all chunks at the end of the trace */
+	double fragmentation = 0;
+};
+
+/*
+* read trace file written by MemoryAllocator::startTrace
+*
+* @param path - trace file path
+*
+* @return Trace - memory properties & records
+*/
+Trace loadTrace(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open " + path);
+	}
+
+	Trace trace{};
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream stream(line);
+		std::string tag;
+		stream >> tag;
+
+		if (tag == "heap") {
+			uint32_t index = 0;
+			stream >> index;
+			stream >> trace.memProperties.memoryHeaps[index].size >> trace.memProperties.memoryHeaps[index].flags;
+			trace.memProperties.memoryHeapCount = std::max(trace.memProperties.memoryHeapCount, index + 1);
+		}
+		else if (tag == "type") {
+			uint32_t index = 0;
+			stream >> index;
+			stream >> trace.memProperties.memoryTypes[index].heapIndex >> trace.memProperties.memoryTypes[index].propertyFlags;
+			trace.memProperties.memoryTypeCount = std::max(trace.memProperties.memoryTypeCount, index + 1);
+		}
+		else if (tag == "granularity") {
+			stream >> trace.bufferImageGranularity >> trace.nonCoherentAtomSize;
+		}
+		else if (tag == "e") {
+			TraceRecord record{};
+			uint32_t lifetime = 0;
+			stream >> lifetime;
+			record.type = TraceRecord::Type::RELEASE_EMPTY_CHUNKS;
+			record.lifetime = static_cast<MemoryAllocator::MemoryLifetime>(lifetime);
+			trace.records.push_back(record);
+		}
+		else if (tag == "a" || tag == "f" || tag == "r") {
+			TraceRecord record{};
+			std::string resourceType;
+			stream >> resourceType >> record.handle;
+			record.image = resourceType == "i";
+			if (tag == "a") {
+				uint32_t lifetime = 0;
+				int linear = 0, prefersDedicated = 0, requiresDedicated = 0;
+				stream >> record.memRequirements.size >> record.memRequirements.alignment >>
+					record.memRequirements.memoryTypeBits >> record.properties >> lifetime >>
+					linear >> prefersDedicated >> requiresDedicated;
+				record.type = TraceRecord::Type::ALLOCATE;
+				record.lifetime = static_cast<MemoryAllocator::MemoryLifetime>(lifetime);
+				record.linear = linear != 0;
+				record.prefersDedicated = prefersDedicated != 0;
+				record.requiresDedicated = requiresDedicated != 0;
+			}
+			else if (tag == "f") {
+				record.type = TraceRecord::Type::FREE;
+			}
+			else {
+				record.type = TraceRecord::Type::RENAME;
+				stream >> record.newHandle;
+			}
+			if (stream.fail()) {
+				throw std::runtime_error("malformed trace record : " + line);
+			}
+			trace.records.push_back(record);
+		}
+		else {
+			throw std::runtime_error("unknown trace record : " + line);
+		}
+	}
+
+	if (trace.memProperties.memoryTypeCount == 0) {
+		throw std::runtime_error(path + " has no memory type records");
+	}
+	return trace;
+}
+
+/*
+* replay the trace with a single policy
+*
+* @param trace - loaded trace
+* @param policy - chunk size & chunk search strategy
+*
+* @return ReplayResult
+*/
+ReplayResult replay(const Trace& trace, const Policy& policy) {
+	FakeMemoryBackend backend;
+	MemoryAllocator allocator;
+	allocator.init(&backend, trace.bufferImageGranularity, trace.nonCoherentAtomSize,
+		trace.memProperties, 0, policy.chunkSize);
+	allocator.setChunkSearchStrategy(policy.strategy);
+
+	//fake handles are created up front so that only the allocator is timed
+	std::vector<uint64_t> fakeHandles(trace.records.size(), 0);
+	for (size_t i = 0; i < trace.records.size(); ++i) {
+		const TraceRecord& record = trace.records[i];
+		if (record.type != TraceRecord::Type::ALLOCATE) {
+			continue;
+		}
+		fakeHandles[i] = record.image ?
+			reinterpret_cast<uint64_t>(backend.createFakeImage(record.memRequirements,
+				record.prefersDedicated, record.requiresDedicated)) :
+			reinterpret_cast<uint64_t>(backend.createFakeBuffer(record.memRequirements,
+				record.prefersDedicated, record.requiresDedicated));
+	}
+
+	//traced handle -> fake handle & size of live resources
+	std::unordered_map<uint64_t, std::pair<uint64_t, VkDeviceSize>> liveBuffers, liveImages;
+	VkDeviceSize liveBytes = 0;
+	ReplayResult result{};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < trace.records.size(); ++i) {
+		const TraceRecord& record = trace.records[i];
+		auto& live = record.image ? liveImages : liveBuffers;
+
+		if (record.type == TraceRecord::Type::RELEASE_EMPTY_CHUNKS) {
+			allocator.releaseEmptyChunks(record.lifetime);
+			continue;
+		}
+
+		if (record.type == TraceRecord::Type::ALLOCATE) {
+			if (record.image) {
+				allocator.allocateImageMemory(reinterpret_cast<VkImage>(fakeHandles[i]), record.properties,
+					record.lifetime, record.linear ? VK_IMAGE_TILING_LINEAR : VK_IMAGE_TILING_OPTIMAL);
+			}
+			else {
+				allocator.allocateBufferMemory(reinterpret_cast<VkBuffer>(fakeHandles[i]), record.properties,
+					record.lifetime);
+			}
+			live[record.handle] = { fakeHandles[i], record.memRequirements.size };
+			liveBytes += record.memRequirements.size;
+			result.peakLiveBytes = std::max(result.peakLiveBytes, liveBytes);
+			continue;
+		}
+
+		auto it = live.find(record.handle);
+		if (it == live.end()) {
+			throw std::runtime_error("trace frees / moves a resource which is not allocated");
+		}
+		if (record.type == TraceRecord::Type::RENAME) {
+			//the defragmenter moved the resource - its placement is not replayed
+			auto resource = it->second;
+			live.erase(it);
+			live[record.newHandle] = resource;
+			continue;
+		}
+		if (record.image) {
+			allocator.freeImageMemory(reinterpret_cast<VkImage>(it->second.first));
+		}
+		else {
+			allocator.freeBufferMemory(reinterpret_cast<VkBuffer>(it->second.first));
+		}
+		liveBytes -= it->second.second;
+		live.erase(it);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double seconds = std::chrono::duration<double>(end - start).count();
+	result.opsPerSecond = seconds > 0 ? trace.records.size() / seconds : 0;
+	result.peakChunkCount = backend.peakAllocationCount;
+	result.peakAllocatedBytes = backend.peakAllocatedBytes;
+
+	//fragmentation of the memory left at the end of the trace
+	MemoryAllocator::Statistics statistics = allocator.getStatistics();
+	VkDeviceSize freeBytes = 0, largestFreeRanges = 0;
+	for (const auto& pool : statistics.pools) {
+		for (const auto& chunk : pool.chunks) {
+			freeBytes += chunk.freeBytes;
+			largestFreeRanges += chunk.largestFreeRange;
+		}
+	}
+	result.fragmentation = freeBytes > 0 ? 1.0 - double(largestFreeRanges) / freeBytes : 0;
+
+	for (const auto& buffer : liveBuffers) {
+		allocator.freeBufferMemory(reinterpret_cast<VkBuffer>(buffer.second.first));
+	}
+	for (const auto& image : liveImages) {
+		allocator.freeImageMemory(reinterpret_cast<VkImage>(image.second.first));
+	}
+	allocator.cleanup();
+	return result;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "usage : allocator_replay <trace file>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	try {
+		Trace trace = loadTrace(argv[1]);
+		std::cout << argv[1] << " : " << trace.records.size() << " records" << std::endl << std::endl;
+
+		const uint32_t chunkSizes[] = { 64 * 1024 * 1024, 128 * 1024 * 1024, 268435000 };
+		const char* strategyNames[] = { "first fit", "fullest fit" };
+		std::cout << std::left << std::setw(12) << "chunk MiB" << std::setw(14) << "strategy" <<
+			std::setw(14) << "Mops/s" << std::setw(14) << "peak chunks" << std::setw(14) << "peak MiB" <<
+			std::setw(14) << "efficiency" << "fragmentation" << std::endl;
+
+		for (uint32_t chunkSize : chunkSizes) {
+			for (uint32_t strategy = 0; strategy < static_cast<uint32_t>(MemoryAllocator::ChunkSearchStrategy::COUNT); ++strategy) {
+				Policy policy{ chunkSize, static_cast<MemoryAllocator::ChunkSearchStrategy>(strategy) };
+				ReplayResult result = replay(trace, policy);
+				double efficiency = result.peakAllocatedBytes > 0 ?
+					double(result.peakLiveBytes) / result.peakAllocatedBytes : 0;
+				std::cout << std::left << std::fixed << std::setprecision(3) <<
+					std::setw(12) << chunkSize / (1024 * 1024) << std::setw(14) << strategyNames[strategy] <<
+					std::setw(14) << result.opsPerSecond / 1000000 << std::setw(14) << result.peakChunkCount <<
+					std::setw(14) << result.peakAllocatedBytes / double(1024 * 1024) <<
+					std::setw(14) << efficiency << result.fragmentation << std::endl;
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}